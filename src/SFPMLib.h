@@ -15,6 +15,42 @@
 #include <vector>
 #include <initializer_list>
 #include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <cmath>
+#include <system_error>
+#include <limits>
+#include <new>
+#include <algorithm>
+#if !defined(SFPML_NO_THREADS)
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <functional>
+#endif
+
+#if (defined(_MSVC_LANG) && (_MSVC_LANG >= 201703L)) || (__cplusplus >= 201703L)
+#define SFPML_STRING_VIEW
+#include <string_view>
+#endif
+
+// SIMD support (x86 only). Define SFPML_NO_SIMD to build the scalar code paths only.
+// The SSE2 kernels need a target with SSE2; the AVX2 and AVX-512 kernels are always
+// compiled (SFPML_TARGET enables the instruction set for a single function) and
+// selected at run time from the CPU features.
+#if !defined(SFPML_NO_SIMD) && (defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__))
+#define SFPML_SSE2
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SFPML_TARGET(isa)
+#else
+#include <cpuid.h>
+#define SFPML_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
 
 namespace sfpmlib
 {
@@ -27,6 +63,54 @@ namespace sfpmlib
 		const char* what() const noexcept { return message.c_str(); }
 	};
 
+	// Tag used to construct FixedPoint, Vec and Mat objects without zeroing them
+	// (e.g. large buffers that are going to be filled immediately).
+	struct UninitializedTag {};
+	static const UninitializedTag Uninitialized{};
+
+	// Result of the Format methods (same meaning as std::to_chars_result):
+	// ptr is one past the last written character, ec is std::errc::value_too_large
+	// (and ptr is the end of the buffer) when the buffer is too small.
+	struct FormatResult
+	{
+		char* ptr;
+		std::errc ec;
+	};
+
+	// Result of the Parse methods (same meaning as std::from_chars_result)
+	struct ParseResult
+	{
+		const char* ptr;
+		std::errc ec;
+	};
+
+	// Non-owning view over a contiguous sequence of objects, used by the bulk APIs.
+	template <class E>
+	class Span
+	{
+		E* data;
+		size_t size;
+
+	public:
+		Span() : data(nullptr), size(0) {}
+		Span(E* data, size_t size) : data(data), size(size) {}
+		template <size_t N>
+		Span(E (&values)[N]) : data(values), size(N) {}
+		template <class A>
+		Span(std::vector<typename std::remove_const<E>::type, A>& values) : data(values.data()), size(values.size()) {}
+		template <class A, class C = E, class = typename std::enable_if<std::is_const<C>::value>::type>
+		Span(std::vector<typename std::remove_const<E>::type, A> const& values) : data(values.data()), size(values.size()) {}
+		template <class F, class = typename std::enable_if<std::is_convertible<F(*)[], E(*)[]>::value>::type>
+		Span(Span<F> const& other) : data(other.Data()), size(other.Size()) {}
+
+		E* Data() const { return data; }
+		size_t Size() const { return size; }
+		bool Empty() const { return size == 0; }
+		E& operator[](size_t index) const { return data[index]; }
+		E* begin() const { return data; }
+		E* end() const { return data + size; }
+	};
+
 	template <typename T>
 	class FixedPoint
 	{
@@ -36,14 +120,15 @@ namespace sfpmlib
 		using Integer = Fractional;
 		using Whole = typename std::make_unsigned<T>::type;
 
+		// fixedPoint comes first so that constexpr constructors can initialize it
 		typedef union
 		{
+			Whole fixedPoint;
 			struct
 			{
 				Fractional fractional;
 				Integer integer;
 			};
-			Whole fixedPoint;
 		} Value;
 
 		typedef struct
@@ -54,24 +139,33 @@ namespace sfpmlib
 
 	protected:
 		FixedPointNumber number;
-		static const uint32_t table[32];
 
 		FixedPoint<T> Log10() const;
 		void Split(Whole&, Whole&) const;
 
-	public:
-		using IntegerPart = typename Integer;
-		using FractionalPart = typename Fractional;
-		using Number = typename FixedPointNumber;
+		template <typename U>
+		static constexpr Whole ConvertMagnitude(typename FixedPoint<U>::Whole);
 
-		FixedPoint()
-		{
-			::memset(&number, 0, sizeof(number));
-		}
-		FixedPoint(FixedPoint<T> const&);
-		FixedPoint(bool, Integer, Fractional);
-		FixedPoint(bool, Whole);
-		FixedPoint(FixedPointNumber);
+		template <typename U>
+		friend class FixedPoint;
+
+	public:
+		using IntegerPart = Integer;
+		using FractionalPart = Fractional;
+		using Number = FixedPointNumber;
+
+		// Longest text written by Format: sign, integer digits, point and 9 decimals
+		enum { MaxFormatLength = 1 + ((sizeof(Integer) == 1) ? 3 : ((sizeof(Integer) == 2) ? 5 : 10)) + 1 + 9 };
+
+		// No user-provided copy constructor/destructor: FixedPoint must stay
+		// trivially copyable so it can be passed in registers and memcpy'd.
+		FixedPoint() : number() {}
+		explicit FixedPoint(UninitializedTag) {}
+		constexpr FixedPoint(bool, Integer, Fractional);
+		constexpr FixedPoint(bool, Whole);
+		constexpr FixedPoint(FixedPointNumber);
+		template <typename U>
+		constexpr explicit FixedPoint(FixedPoint<U> const&);
 
 		FixedPoint<T> operator+(FixedPoint<T> const&);
 		FixedPoint<T>& operator+=(FixedPoint<T> const&);
@@ -87,12 +181,17 @@ namespace sfpmlib
 		bool operator<=(FixedPoint<T> const&) const;
 		bool operator>(FixedPoint<T> const&) const;
 		bool operator>=(FixedPoint<T> const&) const;
-		operator T() const { return number.value.fixedPoint; }
-		operator Number() const { return number; }
+		constexpr operator T() const { return number.value.fixedPoint; }
+		constexpr operator Number() const { return number; }
 
 		std::string ToString() const;
+		FormatResult Format(char*, char*) const;
+		double ToDouble() const;
+		float ToFloat() const;
 
 		static FixedPoint<T> Sqrt(FixedPoint<T> const&);
+		static void Sqrt(Span<FixedPoint<T> const>, Span<FixedPoint<T>>);
+		static void RSqrt(Span<FixedPoint<T> const>, Span<FixedPoint<T>>);
 		static FixedPoint<T> Pow(FixedPoint<T> const&, int);
 		static FixedPoint<T> Pow(FixedPoint<T> const&, FixedPoint<T> const&);
 		static FixedPoint<T> Exp(FixedPoint<T> const&);
@@ -100,7 +199,24 @@ namespace sfpmlib
 		static FixedPoint<T> Sin(FixedPoint<T> const&);
 		static FixedPoint<T> Cos(FixedPoint<T> const&);
 		static FixedPoint<T> Tan(FixedPoint<T> const&);
+		static void Sin(Span<FixedPoint<T> const>, Span<FixedPoint<T>>);
+		static void Cos(Span<FixedPoint<T> const>, Span<FixedPoint<T>>);
+		static void SinCos(Span<FixedPoint<T> const>, Span<FixedPoint<T>>, Span<FixedPoint<T>>);
+		static void Exp(Span<FixedPoint<T> const>, Span<FixedPoint<T>>);
+		static void Log(Span<FixedPoint<T> const>, Span<FixedPoint<T>>, FixedPoint<T> const& = FixedPoint<T>(false, 10, 0));
+		static void Log2(Span<FixedPoint<T> const>, Span<FixedPoint<T>>);
+		static void Pow(Span<FixedPoint<T> const>, Span<FixedPoint<T> const>, Span<FixedPoint<T>>);
 		static FixedPoint<T> FromString(std::string const&);
+		static ParseResult Parse(const char*, const char*, FixedPoint<T>&);
+#if defined(SFPML_STRING_VIEW)
+		static ParseResult Parse(std::string_view, FixedPoint<T>&);
+#endif
+		static FixedPoint<T> FromDouble(double);
+		static FixedPoint<T> FromFloat(float);
+		static void FromDouble(Span<double const>, Span<FixedPoint<T>>);
+		static void FromFloat(Span<float const>, Span<FixedPoint<T>>);
+		static void ToDouble(Span<FixedPoint<T> const>, Span<double>);
+		static void ToFloat(Span<FixedPoint<T> const>, Span<float>);
 		static bool IsNegative(FixedPoint<T> const&);
 		static FixedPoint<T> Abs(FixedPoint<T> const&);
 		static FixedPoint<T> Radians(FixedPoint<T> const&);
@@ -118,67 +234,64 @@ namespace sfpmlib
 	};
 
 	template <typename T>
-	const uint32_t
-	FixedPoint<T>::table[32]{
-		500000000,
-		250000000,
-		125000000,
-		62500000,
-		31250000,
-		15625000,
-		7812500,
-		3906250,
-		1953125,
-		976562,
-		488281,
-		244140,
-		122070,
-		61035,
-		30517,
-		15258,
-		7629,
-		3814,
-		1907,
-		953,
-		476,
-		238,
-		119,
-		59,
-		29,
-		14,
-		7,
-		3,
-		1,
-		0,
-		0,
-		0
-	};
+	constexpr
+	FixedPoint<T>::FixedPoint(bool sign, Integer integer, Fractional fractional)
+	: number{ sign, { static_cast<Whole>((static_cast<Whole>(integer) << (sizeof(Fractional) * 8)) | fractional) } }
+	{
+	}
 
 	template <typename T>
-	FixedPoint<T>::FixedPoint(FixedPoint<T> const& other)
+	constexpr
+	FixedPoint<T>::FixedPoint(bool sign, Whole _number)
+	: number{ sign, { _number } }
 	{
-		number = other.number;
 	}
 
 	template <typename T>
-	FixedPoint<T>::FixedPoint(bool sign, Integer integer, Fractional fractional)
+	constexpr
+	FixedPoint<T>::FixedPoint(FixedPointNumber fixedPointNumber)
+	: number(fixedPointNumber)
 	{
-		number.sign = sign;
-		number.value.integer = integer;
-		number.value.fractional = fractional;
 	}
 
+	// Conversion between widths
+	// Widening (e.g. Q8.8 => Q16.16) is exact: the magnitude is shifted left.
+	// Narrowing (e.g. Q32.32 => Q16.16) rounds half away from zero and saturates
+	// to the largest magnitude of the destination type.
+	// A value that rounds to zero loses its sign.
+
 	template <typename T>
-	FixedPoint<T>::FixedPoint(bool sign, Whole _number)
+	template <typename U>
+	constexpr
+	FixedPoint<T>::FixedPoint(FixedPoint<U> const& other)
+	: number{ other.number.sign && (ConvertMagnitude<U>(other.number.value.fixedPoint) != 0), { ConvertMagnitude<U>(other.number.value.fixedPoint) } }
 	{
-		number.sign = sign;
-		number.value.fixedPoint = _number;
 	}
 
 	template <typename T>
-	FixedPoint<T>::FixedPoint(FixedPointNumber fixedPointNumber)
+	template <typename U>
+	constexpr typename FixedPoint<T>::Whole
+	FixedPoint<T>::ConvertMagnitude(typename FixedPoint<U>::Whole magnitude)
 	{
-		number = fixedPointNumber;
+		using Source = typename FixedPoint<U>::Whole;
+		const int sourceBits = sizeof(typename FixedPoint<U>::Fractional) * 8;
+		const int bits = sizeof(Fractional) * 8;
+
+		if (bits >= sourceBits)
+		{
+			// Widening
+			return static_cast<Whole>(static_cast<Whole>(magnitude) << ((bits >= sourceBits) ? (bits - sourceBits) : 0));
+		}
+
+		// Narrowing
+		const int shift = (sourceBits > bits) ? (sourceBits - bits) : 1;
+		Source rounded = static_cast<Source>((magnitude >> shift) + ((magnitude >> (shift - 1)) & 1));
+		if (rounded > static_cast<Source>(static_cast<Whole>(~static_cast<Whole>(0))))
+		{
+			return static_cast<Whole>(~static_cast<Whole>(0));
+		}
+
+		return static_cast<Whole>(rounded);
 	}
 
 	template <typename T>
@@ -195,7 +308,7 @@ namespace sfpmlib
 		FixedPoint<T> number(val);
 		if (IsNegative(number))
 		{
-			number.sign = false;
+			number.number.sign = false;
 		}
 
 		return number;
@@ -511,145 +624,372 @@ namespace sfpmlib
 		return *this == other;
 	}
 
-	template <typename T>
-	FixedPoint<T>
-	FixedPoint<T>::FromString(std::string const& s)
+	// Parse helpers
+	// Runs of eight digits are validated and converted at once inside a 64-bit
+	// register (SWAR). Like the FixedPoint layout, this assumes a little-endian target.
+
+	static inline bool
+	IsDigit(char c)
+	{
+		return (c >= '0') && (c <= '9');
+	}
+
+	static inline uint64_t
+	LoadEightChars(const char* p)
+	{
+		uint64_t chunk;
+		memcpy(&chunk, p, sizeof(chunk));
+		return chunk;
+	}
+
+	static inline bool
+	IsEightDigits(uint64_t chunk)
+	{
+		return (((chunk + 0x4646464646464646ull) | (chunk - 0x3030303030303030ull)) & 0x8080808080808080ull) == 0;
+	}
+
+	static inline uint32_t
+	ParseEightDigits(uint64_t chunk)
+	{
+		const uint64_t mask = 0x000000FF000000FFull;
+		const uint64_t mul1 = 100 + (1000000ull << 32);
+		const uint64_t mul2 = 1 + (10000ull << 32);
+
+		chunk -= 0x3030303030303030ull;
+		chunk = (chunk * 10) + (chunk >> 8);
+		return static_cast<uint32_t>((((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32);
+	}
+
+	// Accumulators for the decimal digits of the fractional part
+	// (up to 17 digits for Q16.16, up to 33 digits for Q32.32)
+
+	struct DecimalAccumulator64
+	{
+		uint64_t value = 0;
+
+		void MulAdd(uint32_t multiplier, uint32_t addend) { value = (value * multiplier) + addend; }
+		void Divide(uint32_t divisor) { value /= divisor; }
+		uint64_t Low() const { return value; }
+	};
+
+	struct DecimalAccumulator128
 	{
-		std::string s2;
-		std::string value;
-		std::string::size_type t = s.find(".");
+		uint32_t limbs[4] = { 0, 0, 0, 0 };
 
-		if (t != std::string::npos)
+		void MulAdd(uint32_t multiplier, uint32_t addend)
 		{
-			value = s.substr(0, t);
-			if ((t + 1) < s.size())
+			uint64_t carry = addend;
+			for(int i = 0; i < 4; ++i)
 			{
-				s2 = s.substr(t + 1);
+				uint64_t t = (static_cast<uint64_t>(limbs[i]) * multiplier) + carry;
+				limbs[i] = static_cast<uint32_t>(t);
+				carry = t >> 32;
 			}
 		}
-		else
-		{
-			value = s;
-		}
 
-		if (s2.size() > 9)
+		void Divide(uint32_t divisor)
 		{
-			// Maximum 9 digits after decimal point.
-			s2 = s2.substr(0, 9);
-		}
-		s2.append(9 - s2.size(), '0');
-
-		uint32_t fractionalPart = 0;
-		uint32_t rightPart = atoi(s2.c_str());
-		for(int i = 0; i < 32; ++i)
-		{
-			if ((rightPart >= table[i]) && (table[i] != 0))
+			uint64_t remainder = 0;
+			for(int i = 3; i >= 0; --i)
 			{
-				fractionalPart |= (1 << (31 - i));
-				rightPart -= table[i];
+				uint64_t t = (remainder << 32) | limbs[i];
+				limbs[i] = static_cast<uint32_t>(t / divisor);
+				remainder = t % divisor;
 			}
 		}
 
-		fractionalPart >>= (32 - (sizeof(Fractional) * 8));
-		FixedPoint<T> res((value[0] == '-' ? true : false), static_cast<Integer>(abs(atoi(value.c_str()))), static_cast<Fractional>(fractionalPart));
+		uint64_t Low() const { return (static_cast<uint64_t>(limbs[1]) << 32) | limbs[0]; }
+	};
 
-		return res;
-	}
+	// Parse
+	// Reads [+|-]digits[.digits] from [first, last) without allocating any memory
+	// (same contract as std::from_chars): ptr is one past the last character of
+	// the number; ec is std::errc::invalid_argument when there are no digits and
+	// std::errc::result_out_of_range when the value does not fit. On error the
+	// value is left unchanged.
+	// The result is correctly rounded (half away from zero) for any number of
+	// decimals: x * 2^(F+1) = D / 5^(F+1), where D holds the first F+1 decimals,
+	// so the digits after them never change the rounding.
 
 	template <typename T>
-	std::string
-	FixedPoint<T>::ToString() const
+	ParseResult
+	FixedPoint<T>::Parse(const char* first, const char* last, FixedPoint<T>& value)
 	{
-		std::stringstream ss;
-		Fractional fractional = 0;
-
-		if (number.sign)
+		using Accumulator = typename std::conditional<sizeof(Fractional) == 4, DecimalAccumulator128, DecimalAccumulator64>::type;
+		static const uint32_t powersOf10[10] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+		static const uint32_t powersOf5[14] = { 1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125, 9765625, 48828125, 244140625, 1220703125 };
+		const int bits = sizeof(Fractional) * 8;
+		const int decimals = bits + 1;
+		const uint64_t maxInteger = static_cast<Integer>(~static_cast<Integer>(0));
+
+		if (!first || (last < first))
 		{
-			ss << "-";
+			return { first, std::errc::invalid_argument };
 		}
-		ss << (uint32_t)number.value.integer;
-		ss << ".";
 
-		fractional = number.value.fractional;
+		const char* p = first;
+		bool sign = false;
+		if ((p != last) && ((*p == '-') || (*p == '+')))
+		{
+			sign = (*p == '-');
+			++p;
+		}
 
-		uint32_t offset = 0;
-		switch(sizeof(Integer))
+		// Integer part
+		const char* integerDigits = p;
+		uint64_t integer = 0;
+		bool overflow = false;
+		while ((p != last) && (*p == '0'))
 		{
-			case 1:
-				// 8 bit
-				offset = 8;
-				break;
-			case 2:
-				// 16 bit
-				offset = 16;
-				break;
-			case 4:
-				// 32 bit
-				offset = 32;
-				break;
-			default:
-				throw FPException("Invalid size");
+			++p;
 		}
-		// Compute the decimal part
-		uint32_t value = 0;
-		for(int i = (sizeof(Fractional) * 8) - 1; i >= 0; --i)
+		while (((last - p) >= 8) && IsEightDigits(LoadEightChars(p)))
+		{
+			if (!overflow)
+			{
+				integer = (integer * 100000000) + ParseEightDigits(LoadEightChars(p));
+				overflow = integer > maxInteger;
+			}
+			p += 8;
+		}
+		while ((p != last) && IsDigit(*p))
+		{
+			if (!overflow)
+			{
+				integer = (integer * 10) + static_cast<uint64_t>(*p - '0');
+				overflow = integer > maxInteger;
+			}
+			++p;
+		}
+		bool digits = (p != integerDigits);
+
+		// Fractional part
+		Accumulator accumulator;
+		int count = 0;
+		if ((p != last) && (*p == '.'))
 		{
-			uint32_t bit = 1 << i;
-			if (fractional & bit)
+			const char* fractionalDigits = ++p;
+			while (((decimals - count) >= 8) && ((last - p) >= 8) && IsEightDigits(LoadEightChars(p)))
+			{
+				accumulator.MulAdd(100000000, ParseEightDigits(LoadEightChars(p)));
+				count += 8;
+				p += 8;
+			}
+			while ((count < decimals) && (p != last) && IsDigit(*p))
+			{
+				accumulator.MulAdd(10, static_cast<uint32_t>(*p - '0'));
+				++count;
+				++p;
+			}
+			while (((last - p) >= 8) && IsEightDigits(LoadEightChars(p)))
+			{
+				p += 8;
+			}
+			while ((p != last) && IsDigit(*p))
 			{
-				value += table[offset - i - 1];
+				++p;
 			}
+			digits = digits || (p != fractionalDigits);
+		}
+
+		if (!digits)
+		{
+			return { first, std::errc::invalid_argument };
+		}
+
+		for(; count < decimals; count += 9)
+		{
+			accumulator.MulAdd(powersOf10[((decimals - count) < 9) ? (decimals - count) : 9], 0);
+		}
+		for(int remaining = decimals; remaining > 0; remaining -= 13)
+		{
+			accumulator.Divide(powersOf5[(remaining < 13) ? remaining : 13]);
+		}
+
+		uint64_t fractional = (accumulator.Low() + 1) >> 1;
+		if ((fractional >> bits) != 0)
+		{
+			fractional = 0;
+			integer += 1;
+			overflow = overflow || (integer > maxInteger);
+		}
+
+		if (overflow)
+		{
+			return { p, std::errc::result_out_of_range };
 		}
-		// Compute pads
-		uint8_t pads = 0;
 
-		if (value < 10)
+		value = FixedPoint<T>(sign && ((integer != 0) || (fractional != 0)), static_cast<Integer>(integer), static_cast<Fractional>(fractional));
+		return { p, std::errc() };
+	}
+
+#if defined(SFPML_STRING_VIEW)
+	template <typename T>
+	ParseResult
+	FixedPoint<T>::Parse(std::string_view text, FixedPoint<T>& value)
+	{
+		return Parse(text.data(), text.data() + text.size(), value);
+	}
+#endif
+
+	// FromString
+	// Throws if the whole string is not a valid number.
+
+	template <typename T>
+	FixedPoint<T>
+	FixedPoint<T>::FromString(std::string const& s)
+	{
+		FixedPoint<T> res;
+		const char* last = s.data() + s.size();
+		ParseResult result = Parse(s.data(), last, res);
+		if (result.ec == std::errc::result_out_of_range)
+		{
+			throw FPException("Out of range");
+		}
+		if ((result.ec != std::errc()) || (result.ptr != last))
 		{
-			pads = 8;
+			throw FPException("Invalid argument");
 		}
-		else if (value < 100)
+
+		return res;
+	}
+
+	// Decimal digit pairs ("00", "01", ... "99") used by the Format methods
+	static const char digitPairs[201] =
+		"0001020304050607080910111213141516171819"
+		"2021222324252627282930313233343536373839"
+		"4041424344454647484950515253545556575859"
+		"6061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+
+	// Format
+	// Writes the number as [-]integer.fractional with 9 decimal digits, without
+	// allocating any memory. The 9 decimal digits are the fractional part times
+	// 10^9, computed by a single widening multiply (truncated like the 9th digit
+	// of the exact decimal expansion).
+
+	template <typename T>
+	FormatResult
+	FixedPoint<T>::Format(char* first, char* last) const
+	{
+		// Integer part (at most 10 digits), written backwards
+		char integerDigits[10];
+		char* p = integerDigits + sizeof(integerDigits);
+		uint32_t integer = number.value.integer;
+		while(integer >= 100)
 		{
-			pads = 7;
+			uint32_t pair = (integer % 100) * 2;
+			integer /= 100;
+			*--p = digitPairs[pair + 1];
+			*--p = digitPairs[pair];
 		}
-		else if (value < 1000)
+		if (integer >= 10)
 		{
-			pads = 6;
+			*--p = digitPairs[(integer * 2) + 1];
+			*--p = digitPairs[integer * 2];
 		}
-		else if (value < 10000)
+		else
 		{
-			pads = 5;
+			*--p = static_cast<char>('0' + integer);
 		}
-		else if (value < 100000L)
+		size_t integerLength = static_cast<size_t>((integerDigits + sizeof(integerDigits)) - p);
+
+		size_t length = (number.sign ? 1 : 0) + integerLength + 1 + 9;
+		if (!first || (last < first) || (static_cast<size_t>(last - first) < length))
 		{
-			pads = 4;
+			return FormatResult{ last, std::errc::value_too_large };
 		}
-		else if (value < 1000000L)
+
+		if (number.sign)
 		{
-			pads = 3;
+			*first++ = '-';
 		}
-		else if (value < 10000000L)
+		::memcpy(first, p, integerLength);
+		first += integerLength;
+		*first++ = '.';
+
+		// Compute the decimal part
+		uint32_t fractional = static_cast<uint32_t>((static_cast<uint64_t>(number.value.fractional) * 1000000000ull) >> (sizeof(Fractional) * 8));
+		first[8] = static_cast<char>('0' + (fractional % 10));
+		fractional /= 10;
+		for(int i = 6; i >= 0; i -= 2)
 		{
-			pads = 2;
+			uint32_t pair = (fractional % 100) * 2;
+			fractional /= 100;
+			first[i] = digitPairs[pair];
+			first[i + 1] = digitPairs[pair + 1];
 		}
-		else if (value < 100000000L)
+
+		return FormatResult{ first + 9, std::errc() };
+	}
+
+	template <typename T>
+	std::string
+	FixedPoint<T>::ToString() const
+	{
+		char buffer[MaxFormatLength];
+		return std::string(buffer, Format(buffer, buffer + sizeof(buffer)).ptr);
+	}
+
+	// Floating point conversions
+	// The magnitude is rounded to the nearest FixedPoint value (ties away from zero)
+	// and saturated to the largest magnitude. NaN converts to zero.
+
+	template <typename T>
+	FixedPoint<T>
+	FixedPoint<T>::FromDouble(double value)
+	{
+		const double scale = static_cast<double>(static_cast<Whole>(1) << (sizeof(Fractional) * 8));
+		const double limit = scale * static_cast<double>(static_cast<Whole>(1) << (sizeof(Integer) * 8));	// 2^(bits of Whole)
+		const Whole maximum = static_cast<Whole>(~static_cast<Whole>(0));
+
+		if (value != value)
 		{
-			pads = 1;
+			// NaN
+			return FixedPoint<T>(false, 0);
 		}
 
-		// Left pad with zeroes
-		if (pads)
+		double magnitude = std::fabs(value) * scale;
+		Whole result = maximum;
+		if (magnitude < limit)
 		{
-			std::string s;
-			for(uint8_t i = 0; i < pads; ++i)
+			double integral = std::floor(magnitude);
+			result = static_cast<Whole>(integral);
+			if (((magnitude - integral) >= 0.5) && (result != maximum))
 			{
-				s += "0";
+				++result;
 			}
-			ss << s;
 		}
-		// Append the decimal part
-		ss << value;
 
-		return ss.str();
+		return FixedPoint<T>((value < 0) && (result != 0), result);
+	}
+
+	template <typename T>
+	FixedPoint<T>
+	FixedPoint<T>::FromFloat(float value)
+	{
+		// float => double is exact
+		return FromDouble(static_cast<double>(value));
+	}
+
+	template <typename T>
+	double
+	FixedPoint<T>::ToDouble() const
+	{
+		const double scale = 1.0 / static_cast<double>(static_cast<Whole>(1) << (sizeof(Fractional) * 8));
+		double value = static_cast<double>(number.value.fixedPoint) * scale;
+
+		return number.sign ? -value : value;
+	}
+
+	template <typename T>
+	float
+	FixedPoint<T>::ToFloat() const
+	{
+		const float scale = 1.0f / static_cast<float>(static_cast<Whole>(1) << (sizeof(Fractional) * 8));
+		float value = static_cast<float>(number.value.fixedPoint) * scale;
+
+		return number.sign ? -value : value;
 	}
 
 	// https://en.wikipedia.org/wiki/Methods_of_computing_square_roots#Babylonian_method
@@ -690,23 +1030,23 @@ namespace sfpmlib
 		}
 		else if (number.value.integer <= 1000000ul)
 		{
-			guess = FixedPoint<T>(false, 700, 0);
+			guess = FixedPoint<T>(false, static_cast<Integer>(700), 0);
 		}
 		else if (number.value.integer <= 10000000ul)
 		{
-			guess = FixedPoint<T>(false, 2000, 0);
+			guess = FixedPoint<T>(false, static_cast<Integer>(2000), 0);
 		}
 		else if (number.value.integer <= 100000000ul)
 		{
-			guess = FixedPoint<T>(false, 7000, 0);
+			guess = FixedPoint<T>(false, static_cast<Integer>(7000), 0);
 		}
 		else if (number.value.integer <= 1000000000ul)
 		{
-			guess = FixedPoint<T>(false, 20000, 0);
+			guess = FixedPoint<T>(false, static_cast<Integer>(20000), 0);
 		}
 		else
 		{
-			guess = FixedPoint<T>(false, static_cast<FixedPoint<T>::Integer>(56000), 0);
+			guess = FixedPoint<T>(false, static_cast<Integer>(56000), 0);
 		}
 
 		FixedPoint<T> x(guess);
@@ -790,14 +1130,14 @@ namespace sfpmlib
 			throw FPException("Invalid Taylor terms");
 		}
 
-		typename FixedPoint<T>::Number fpNumber = static_cast<FixedPoint<T>::Number>(initialValue);
+		typename FixedPoint<T>::Number fpNumber = static_cast<typename FixedPoint<T>::Number>(initialValue);
 		uint32_t fractional = fpNumber.value.fractional;
-		fractional <<= (32 - sizeof(FixedPoint<T>::FractionalPart) * 8);
+		fractional <<= (32 - sizeof(typename FixedPoint<T>::FractionalPart) * 8);
 		FixedPoint<uint64_t> res(fpNumber.sign, fpNumber.value.integer, fractional);
 
-		fpNumber = static_cast<FixedPoint<T>::Number>(exp);
+		fpNumber = static_cast<typename FixedPoint<T>::Number>(exp);
 		fractional = fpNumber.value.fractional;
-		fractional <<= (32 - sizeof(FixedPoint<T>::FractionalPart) * 8);
+		fractional <<= (32 - sizeof(typename FixedPoint<T>::FractionalPart) * 8);
 
 		for(uint8_t i = 0; i < elements; i++)
 		{
@@ -808,9 +1148,9 @@ namespace sfpmlib
 			res += v;
 		}
 
-		typename FixedPoint<uint64_t>::Number number = static_cast<FixedPoint<uint64_t>::Number>(res);
+		typename FixedPoint<uint64_t>::Number number = static_cast<typename FixedPoint<uint64_t>::Number>(res);
 		fractional = number.value.fractional;
-		fractional >>= (32 - (sizeof(FixedPoint<T>::FractionalPart) * 8));
+		fractional >>= (32 - (sizeof(typename FixedPoint<T>::FractionalPart) * 8));
 
 		return FixedPoint<T>(number.sign, number.value.integer, fractional);
 	}
@@ -1146,762 +1486,9150 @@ namespace sfpmlib
 	typedef FixedPoint<uint32_t> FixedPointMedium;
 	typedef FixedPoint<uint64_t> FixedPointLarge;
 
-	// std::conditional
-	template <typename T>
-	class MyTest
-	{
-		using Other = typename std::conditional<sizeof(T) == 4, uint16_t, uint32_t>::type;
-		using T1 = typename std::conditional<sizeof(T) == 2, uint8_t, Other>::type;
-		using T2 = typename std::enable_if<std::is_integral<T>::value, T1>::type;
-
-	public:
-		T2 member;
+	static_assert(std::is_trivially_copyable<FixedPointSmall>::value && std::is_standard_layout<FixedPointSmall>::value, "FixedPointSmall must be trivially copyable and standard layout");
+	static_assert(std::is_trivially_copyable<FixedPointMedium>::value && std::is_standard_layout<FixedPointMedium>::value, "FixedPointMedium must be trivially copyable and standard layout");
+	static_assert(std::is_trivially_copyable<FixedPointLarge>::value && std::is_standard_layout<FixedPointLarge>::value, "FixedPointLarge must be trivially copyable and standard layout");
 
-		MyTest() : member(0) {}
-	};
+	// Runtime CPU dispatch
+	// The CPU features are read once (cpuid) and every bulk kernel is called
+	// through a table of function pointers indexed by the active instruction set.
+	// All the implementations of a kernel give exactly the same results, so a
+	// lower instruction set can be forced (e.g. to compare them).
 
-	// Vectors
-	template <class T, int N>
-	class Vec
+	enum class InstructionSet
 	{
-		T components[N];
-
-	public:
-		Vec();
-		Vec(Vec const&);
-		Vec(std::initializer_list<T>);
-		Vec(std::vector<T> const&);
-
-		Vec operator+(Vec const&);
-		Vec operator+=(Vec const&);
-		Vec operator-(Vec const&);
-		Vec operator-=(Vec const&);
-		T operator*(Vec const&);
-		Vec operator*(T const&);
-		Vec operator*=(T const&);
-		static Vec Cross(Vec const&, Vec const&);
-		static T Angle(Vec const&, Vec const&);
-		T operator[](uint32_t) const;
-		bool operator==(Vec const&) const;
-		bool operator!=(Vec const&) const;
-		T Mod() const;
-		Vec Normalize() const;
-		std::string ToString() const;
+		Scalar,
+		Sse2,
+		Avx2,
+		Avx512
 	};
 
-	template <class T, int N>
-	Vec<T, N>::Vec()
-	{
-		::memset(components, 0, N * sizeof(T));
-	}
-
-	template <class T, int N>
-	Vec<T, N>::Vec(Vec const& other)
+	namespace kernels
 	{
-		for(int i = 0; i < N; i++)
+#if defined(SFPML_SSE2)
+		inline void
+		Cpuid(uint32_t leaf, uint32_t registers[4])
 		{
-			components[i] = other.components[i];
+#if defined(_MSC_VER) && !defined(__clang__)
+			int values[4];
+			__cpuidex(values, static_cast<int>(leaf), 0);
+			for(int i = 0; i < 4; i++)
+			{
+				registers[i] = static_cast<uint32_t>(values[i]);
+			}
+#else
+			__cpuid_count(leaf, 0, registers[0], registers[1], registers[2], registers[3]);
+#endif
 		}
-	}
 
-	template <class T, int N>
-	Vec<T, N>::Vec(std::initializer_list<T> list)
-	: Vec()
-	{
-		if (list.size() > N)
+		// Register state saved by the OS (XCR0)
+		inline uint64_t
+		EnabledState()
 		{
-			throw(FPException("Invalid size"));
+#if defined(_MSC_VER) && !defined(__clang__)
+			return _xgetbv(0);
+#else
+			uint32_t low;
+			uint32_t high;
+			__asm__ __volatile__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return (static_cast<uint64_t>(high) << 32) | low;
+#endif
 		}
+#endif
 
-		int k = 0;
-		for(auto const& elem : list)
+		inline InstructionSet
+		DetectInstructionSet()
 		{
-			components[k++] = elem;
+#if defined(SFPML_SSE2)
+			uint32_t registers[4];
+			Cpuid(0, registers);
+			uint32_t leaves = registers[0];
+
+			Cpuid(1, registers);
+			if (!(registers[3] & (1u << 26)))											// SSE2
+			{
+				return InstructionSet::Scalar;
+			}
+			if (!(registers[2] & (1u << 27)) || !(registers[2] & (1u << 28)) || (leaves < 7))	// OSXSAVE, AVX
+			{
+				return InstructionSet::Sse2;
+			}
+
+			uint64_t state = EnabledState();
+			Cpuid(7, registers);
+			if (((state & 0x06) != 0x06) || !(registers[1] & (1u << 5)))				// XMM/YMM state, AVX2
+			{
+				return InstructionSet::Sse2;
+			}
+			if (((state & 0xE6) != 0xE6) || !(registers[1] & (1u << 16)) || !(registers[1] & (1u << 30)))	// ZMM state, AVX512F, AVX512BW
+			{
+				return InstructionSet::Avx2;
+			}
+
+			return InstructionSet::Avx512;
+#else
+			return InstructionSet::Scalar;
+#endif
 		}
-	}
 
-	template <class T, int N>
-	Vec<T, N>::Vec(std::vector<T> const& values)
-	: Vec()
-	{
-		if (values.size() > N)
+		inline InstructionSet&
+		ActiveInstructionSet()
 		{
-			throw(FPException("Invalid size"));
+			static InstructionSet active = DetectInstructionSet();
+			return active;
 		}
 
-		int k = 0;
-		for(auto const& elem : values)
+		// Index in the kernel tables
+		inline size_t
+		Level()
 		{
-			components[k++] = elem;
+			return static_cast<size_t>(ActiveInstructionSet());
 		}
 	}
 
-	template <class T, int N>
-	Vec<T, N>
-	Vec<T, N>::operator+(Vec const& other)
+	// Best instruction set supported by the CPU (and by the build)
+	inline InstructionSet
+	SupportedInstructionSet()
 	{
-		std::vector<T> v;
-		for(int i = 0; i < N; ++i)
-		{
-			v.push_back(components[i] + other.components[i]);
-		}
+		static const InstructionSet supported = kernels::DetectInstructionSet();
+		return supported;
+	}
 
-		return Vec(v);
+	inline InstructionSet
+	GetInstructionSet()
+	{
+		return kernels::ActiveInstructionSet();
 	}
 
-	template <class T, int N>
-	Vec<T, N>
-	Vec<T, N>::operator+=(Vec const& other)
+	// Instruction sets above the supported one are lowered to it.
+	// Not thread safe: meant to be called before the bulk kernels run.
+	inline void
+	SetInstructionSet(InstructionSet set)
 	{
-		*this = *this + other;
+		kernels::ActiveInstructionSet() = (set > SupportedInstructionSet()) ? SupportedInstructionSet() : set;
+	}
+
+	// Worker threads
+	// The batch functions on large inputs split the work between threads (define
+	// SFPML_NO_THREADS to always run on the calling thread). The chunks do not
+	// depend on each other, so the results do not depend on the thread count.
+	// The threads are started on first use and kept waiting for work until the
+	// program exits, so the kernels calling ParallelFor once per step (the
+	// factorizations) do not pay for a thread start on every step.
+
+	namespace kernels
+	{
+		inline size_t&
+		ActiveThreadCount()
+		{
+#if defined(SFPML_NO_THREADS)
+			static size_t active = 1;
+#else
+			static size_t active = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+#endif
+			return active;
+		}
+
+#if !defined(SFPML_NO_THREADS)
+		// Queue of tasks shared by the worker threads. A thread waiting for its tasks
+		// runs the queued ones meanwhile, so a task can call ParallelFor in turn.
+		class ThreadPool
+		{
+			std::mutex mutex;
+			std::condition_variable wake;
+			std::condition_variable finished;
+			std::deque<std::function<void()>> tasks;
+			std::vector<std::thread> workers;
+			bool stopping;
+
+			ThreadPool() : stopping(false) {}
+
+			// Runs the oldest task with the lock released
+			void
+			RunFront(std::unique_lock<std::mutex>& lock)
+			{
+				std::function<void()> task = std::move(tasks.front());
+				tasks.pop_front();
+				lock.unlock();
+				task();
+				lock.lock();
+				finished.notify_all();
+			}
+
+			void
+			Work()
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				for(;;)
+				{
+					wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+					if (tasks.empty())
+					{
+						return;
+					}
+					RunFront(lock);
+				}
+			}
+
+		public:
+			ThreadPool(ThreadPool const&) = delete;
+			ThreadPool& operator=(ThreadPool const&) = delete;
+
+			~ThreadPool()
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stopping = true;
+				}
+				wake.notify_all();
+				for(std::thread& worker : workers)
+				{
+					worker.join();
+				}
+			}
+
+			static ThreadPool&
+			Instance()
+			{
+				static ThreadPool pool;
+				return pool;
+			}
+
+			// Starts worker threads up to count
+			void
+			Reserve(size_t count)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				while (workers.size() < count)
+				{
+					workers.emplace_back([this]() { Work(); });
+				}
+			}
+
+			// The task must not throw
+			void
+			Post(std::function<void()> task)
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					tasks.push_back(std::move(task));
+				}
+				wake.notify_one();
+			}
+
+			// Runs queued tasks until remaining (decremented by the tasks) is 0
+			void
+			Wait(std::atomic<size_t> const& remaining)
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (remaining != 0)
+				{
+					if (!tasks.empty())
+					{
+						RunFront(lock);
+					}
+					else
+					{
+						finished.wait(lock);
+					}
+				}
+			}
+		};
+#endif
+
+		// Calls function(first, last) over [0, count) split in chunks of at least
+		// grain elements, the first chunk on the calling thread; returns the error
+		// flags of all the chunks. An exception thrown by a chunk is rethrown once
+		// all the chunks are done.
+		template <class F>
+		inline unsigned
+		ParallelFor(size_t count, size_t grain, F const& function)
+		{
+			size_t chunks = std::min(ActiveThreadCount(), count / std::max<size_t>(grain, 1));
+			if (chunks <= 1)
+			{
+				return function(0, count);
+			}
+
+#if defined(SFPML_NO_THREADS)
+			return function(0, count);
+#else
+			// Chunk i is [i * count / chunks, (i + 1) * count / chunks): never empty,
+			// since count >= chunks * grain.
+			ThreadPool& pool = ThreadPool::Instance();
+			std::vector<unsigned> errors(chunks, 0);
+			std::vector<std::exception_ptr> exceptions(chunks);
+			std::atomic<size_t> remaining(chunks - 1);
+			size_t posted = 0;
+			try
+			{
+				pool.Reserve(chunks - 1);
+				for(size_t i = 1; i < chunks; i++)
+				{
+					size_t first = i * (count / chunks) + i * (count % chunks) / chunks;
+					size_t last = (i + 1) * (count / chunks) + (i + 1) * (count % chunks) / chunks;
+					pool.Post([&function, &errors, &exceptions, &remaining, i, first, last]()
+					{
+						try
+						{
+							errors[i] = function(first, last);
+						}
+						catch(...)
+						{
+							exceptions[i] = std::current_exception();
+						}
+						--remaining;
+					});
+					posted++;
+				}
+
+				errors[0] = function(0, count / chunks + (count % chunks) / chunks);
+			}
+			catch(...)
+			{
+				// The posted chunks still reference function and errors
+				remaining -= (chunks - 1) - posted;
+				pool.Wait(remaining);
+				throw;
+			}
+
+			pool.Wait(remaining);
+			unsigned result = 0;
+			for(size_t i = 0; i < chunks; i++)
+			{
+				if (exceptions[i])
+				{
+					std::rethrow_exception(exceptions[i]);
+				}
+				result |= errors[i];
+			}
+			return result;
+#endif
+		}
+	}
+
+	inline size_t
+	GetThreadCount()
+	{
+		return kernels::ActiveThreadCount();
+	}
+
+	// 0 restores the number of hardware threads.
+	// Not thread safe: meant to be called before the batch functions run.
+	inline void
+	SetThreadCount(size_t count)
+	{
+#if defined(SFPML_NO_THREADS)
+		(void)count;
+#else
+		kernels::ActiveThreadCount() = count ? count : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+#endif
+	}
+
+	// Bulk conversions between widths
+	// Every element is converted exactly as the converting constructor does.
+	// The SIMD kernels rely on the in-memory layout of the FixedPoint objects:
+	// the sign byte comes first and the magnitude sits in the upper half.
+
+	namespace kernels
+	{
+		template <typename T, typename U>
+		inline void
+		ConvertScalar(FixedPoint<U> const* source, FixedPoint<T>* destination, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				destination[i] = FixedPoint<T>(source[i]);
+			}
+		}
+
+		template <typename T, typename U>
+		inline void
+		Convert(FixedPoint<U> const* source, FixedPoint<T>* destination, size_t count)
+		{
+			ConvertScalar(source, destination, count);
+		}
+
+#if defined(SFPML_SSE2)
+		static_assert(sizeof(FixedPointSmall) == 4 && sizeof(FixedPointMedium) == 8 && sizeof(FixedPointLarge) == 16, "Unexpected FixedPoint layout");
+
+		// Clears the sign of the FixedPointSmall values (4 x 32 bits) whose magnitude is zero
+		inline __m128i
+		ClearZeroSign(__m128i v)
+		{
+			__m128i zero = _mm_cmpeq_epi32(_mm_srli_epi32(v, 16), _mm_setzero_si128());
+			return _mm_andnot_si128(_mm_and_si128(zero, _mm_set1_epi32(0xFF)), v);
+		}
+
+		// Q8.8 => Q16.16
+		inline void
+		ConvertSse2(FixedPointSmall const* source, FixedPointMedium* destination, size_t count)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i sign = _mm_set_epi32(0, 0xFF, 0, 0xFF);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m128i v = ClearZeroSign(_mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i)));
+				__m128i lo = _mm_unpacklo_epi32(v, zero);
+				__m128i hi = _mm_unpackhi_epi32(v, zero);
+				lo = _mm_or_si128(_mm_and_si128(lo, sign), _mm_slli_epi64(_mm_srli_epi64(lo, 16), 40));
+				hi = _mm_or_si128(_mm_and_si128(hi, sign), _mm_slli_epi64(_mm_srli_epi64(hi, 16), 40));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), lo);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 2), hi);
+			}
+			for(; i < count; i++)
+			{
+				destination[i] = FixedPointMedium(source[i]);
+			}
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		ConvertAvx2(FixedPointSmall const* source, FixedPointMedium* destination, size_t count)
+		{
+			const __m256i sign = _mm256_set1_epi64x(0xFF);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m256i v = _mm256_cvtepu32_epi64(ClearZeroSign(_mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i))));
+				__m256i magnitude = _mm256_slli_epi64(_mm256_srli_epi64(v, 16), 40);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_or_si256(_mm256_and_si256(v, sign), magnitude));
+			}
+			ConvertSse2(source + i, destination + i, count - i);
+		}
+
+		// Q8.8 => Q32.32
+		inline void
+		ConvertSse2(FixedPointSmall const* source, FixedPointLarge* destination, size_t count)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i sign = _mm_set_epi32(0, 0xFF, 0, 0xFF);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m128i v = ClearZeroSign(_mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i)));
+				__m128i lo = _mm_unpacklo_epi32(v, zero);
+				__m128i hi = _mm_unpackhi_epi32(v, zero);
+				__m128i loMagnitude = _mm_slli_epi64(_mm_srli_epi64(lo, 16), 24);
+				__m128i hiMagnitude = _mm_slli_epi64(_mm_srli_epi64(hi, 16), 24);
+				lo = _mm_and_si128(lo, sign);
+				hi = _mm_and_si128(hi, sign);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_unpacklo_epi64(lo, loMagnitude));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 1), _mm_unpackhi_epi64(lo, loMagnitude));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 2), _mm_unpacklo_epi64(hi, hiMagnitude));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 3), _mm_unpackhi_epi64(hi, hiMagnitude));
+			}
+			for(; i < count; i++)
+			{
+				destination[i] = FixedPointLarge(source[i]);
+			}
+		}
+
+		// Q16.16 => Q32.32
+		inline void
+		ConvertSse2(FixedPointMedium const* source, FixedPointLarge* destination, size_t count)
+		{
+			const __m128i sign = _mm_set_epi32(0, 0xFF, 0, 0xFF);
+			size_t i = 0;
+			for(; (i + 2) <= count; i += 2)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i));
+				__m128i magnitude = _mm_slli_epi64(_mm_srli_epi64(v, 32), 16);
+				// Clear the sign of zero magnitudes
+				v = _mm_andnot_si128(_mm_shuffle_epi32(_mm_cmpeq_epi32(v, _mm_setzero_si128()), _MM_SHUFFLE(3, 3, 1, 1)), v);
+				v = _mm_and_si128(v, sign);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_unpacklo_epi64(v, magnitude));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 1), _mm_unpackhi_epi64(v, magnitude));
+			}
+			for(; i < count; i++)
+			{
+				destination[i] = FixedPointLarge(source[i]);
+			}
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		ConvertAvx2(FixedPointMedium const* source, FixedPointLarge* destination, size_t count)
+		{
+			const __m256i sign = _mm256_set1_epi64x(0xFF);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(source + i));
+				__m256i magnitude = _mm256_slli_epi64(_mm256_srli_epi64(v, 32), 16);
+				// Clear the sign of zero magnitudes
+				v = _mm256_andnot_si256(_mm256_shuffle_epi32(_mm256_cmpeq_epi32(v, _mm256_setzero_si256()), _MM_SHUFFLE(3, 3, 1, 1)), v);
+				v = _mm256_and_si256(v, sign);
+				__m256i lo = _mm256_unpacklo_epi64(v, magnitude);
+				__m256i hi = _mm256_unpackhi_epi64(v, magnitude);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_permute2x128_si256(lo, hi, 0x20));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i + 2), _mm256_permute2x128_si256(lo, hi, 0x31));
+			}
+			ConvertSse2(source + i, destination + i, count - i);
+		}
+
+		// Q16.16 => Q8.8 (rounded, saturated)
+		inline void
+		ConvertSse2(FixedPointMedium const* source, FixedPointSmall* destination, size_t count)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i sign = _mm_set1_epi32(0xFF);
+			const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+			const __m128i limit = _mm_set1_epi32(0x00FFFF7F);	// Largest magnitude that doesn't overflow once rounded
+			const __m128i half = _mm_set1_epi32(0x80);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i + 2));
+				// Gather the signs (even 32 bit words) and the magnitudes (odd 32 bit words)
+				__m128i s = _mm_unpacklo_epi64(_mm_shuffle_epi32(a, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 0, 2, 0)));
+				__m128i m = _mm_unpacklo_epi64(_mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 3, 1)));
+				// Unsigned min(m, limit)
+				__m128i over = _mm_cmpgt_epi32(_mm_xor_si128(m, bias), _mm_xor_si128(limit, bias));
+				m = _mm_or_si128(_mm_andnot_si128(over, m), _mm_and_si128(over, limit));
+				m = _mm_srli_epi32(_mm_add_epi32(m, half), 8);
+				s = _mm_andnot_si128(_mm_cmpeq_epi32(m, zero), _mm_and_si128(s, sign));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_or_si128(s, _mm_slli_epi32(m, 16)));
+			}
+			for(; i < count; i++)
+			{
+				destination[i] = FixedPointSmall(source[i]);
+			}
+		}
+
+		// Kernel tables, indexed by InstructionSet
+		inline void
+		Convert(FixedPointSmall const* source, FixedPointMedium* destination, size_t count)
+		{
+			static void (* const table[])(FixedPointSmall const*, FixedPointMedium*, size_t) = { ConvertScalar<uint32_t, uint16_t>, ConvertSse2, ConvertAvx2, ConvertAvx2 };
+			table[Level()](source, destination, count);
+		}
+
+		inline void
+		Convert(FixedPointSmall const* source, FixedPointLarge* destination, size_t count)
+		{
+			static void (* const table[])(FixedPointSmall const*, FixedPointLarge*, size_t) = { ConvertScalar<uint64_t, uint16_t>, ConvertSse2, ConvertSse2, ConvertSse2 };
+			table[Level()](source, destination, count);
+		}
+
+		inline void
+		Convert(FixedPointMedium const* source, FixedPointLarge* destination, size_t count)
+		{
+			static void (* const table[])(FixedPointMedium const*, FixedPointLarge*, size_t) = { ConvertScalar<uint64_t, uint32_t>, ConvertSse2, ConvertAvx2, ConvertAvx2 };
+			table[Level()](source, destination, count);
+		}
+
+		inline void
+		Convert(FixedPointMedium const* source, FixedPointSmall* destination, size_t count)
+		{
+			static void (* const table[])(FixedPointMedium const*, FixedPointSmall*, size_t) = { ConvertScalar<uint16_t, uint32_t>, ConvertSse2, ConvertSse2, ConvertSse2 };
+			table[Level()](source, destination, count);
+		}
+#endif
+	}
+
+	template <typename T, typename U>
+	static void
+	Convert(FixedPoint<U> const* source, FixedPoint<T>* destination, size_t count)
+	{
+		if (count && (!source || !destination))
+		{
+			throw FPException("Invalid argument");
+		}
+
+		kernels::Convert(source, destination, count);
+	}
+
+	template <typename T, typename U>
+	static void
+	Convert(Span<FixedPoint<U> const> source, Span<FixedPoint<T>> destination)
+	{
+		if (source.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		Convert(source.Data(), destination.Data(), source.Size());
+	}
+
+	// Bulk floating point conversions
+	// Same results as FromDouble/FromFloat/ToDouble/ToFloat, element by element.
+
+	namespace kernels
+	{
+		template <typename T, typename F>
+		inline void
+		FromFloatingScalar(F const* source, FixedPoint<T>* destination, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				destination[i] = FixedPoint<T>::FromDouble(static_cast<double>(source[i]));
+			}
+		}
+
+		template <typename T, typename F>
+		inline void
+		ToFloatingScalar(FixedPoint<T> const* source, F* destination, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				destination[i] = static_cast<F>(source[i].ToDouble());
+			}
+		}
+
+		template <typename T, typename F>
+		inline void
+		FromFloating(F const* source, FixedPoint<T>* destination, size_t count)
+		{
+			FromFloatingScalar(source, destination, count);
+		}
+
+		template <typename T>
+		inline void
+		ToDouble(FixedPoint<T> const* source, double* destination, size_t count)
+		{
+			ToFloatingScalar(source, destination, count);
+		}
+
+		template <typename T>
+		inline void
+		ToFloat(FixedPoint<T> const* source, float* destination, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				destination[i] = source[i].ToFloat();
+			}
+		}
+
+#if defined(SFPML_SSE2)
+		inline __m128d
+		Load2(double const* values)
+		{
+			return _mm_loadu_pd(values);
+		}
+
+		inline __m128d
+		Load2(float const* values)
+		{
+			return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(values))));
+		}
+
+		// Computes |value| * scale rounded half away from zero and saturated to [0, maximum].
+		// NaN gives 0. Also returns the mask of the lanes whose result is negative.
+		inline __m128d
+		RoundMagnitude(__m128d value, double scale, double maximum, __m128d& negative)
+		{
+			const __m128d zero = _mm_setzero_pd();
+			const __m128d one = _mm_set1_pd(1.0);
+			const __m128d two52 = _mm_set1_pd(4503599627370496.0);
+
+			__m128d magnitude = _mm_mul_pd(_mm_andnot_pd(_mm_set1_pd(-0.0), value), _mm_set1_pd(scale));
+			magnitude = _mm_max_pd(magnitude, zero);											// NaN => 0
+			magnitude = _mm_min_pd(magnitude, _mm_set1_pd(maximum + 1.0));
+			// floor (the magnitude is below 2^52 here)
+			__m128d integral = _mm_sub_pd(_mm_add_pd(magnitude, two52), two52);
+			integral = _mm_sub_pd(integral, _mm_and_pd(_mm_cmpgt_pd(integral, magnitude), one));
+			__m128d rounded = _mm_add_pd(integral, _mm_and_pd(_mm_cmpge_pd(_mm_sub_pd(magnitude, integral), _mm_set1_pd(0.5)), one));
+			rounded = _mm_min_pd(rounded, _mm_set1_pd(maximum));
+
+			negative = _mm_andnot_pd(_mm_cmpeq_pd(rounded, zero), _mm_cmplt_pd(value, zero));
+			return rounded;
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256d
+		Load4(double const* values)
+		{
+			return _mm256_loadu_pd(values);
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256d
+		Load4(float const* values)
+		{
+			return _mm256_cvtps_pd(_mm_loadu_ps(values));
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256d
+		RoundMagnitude(__m256d value, double scale, double maximum, __m256d& negative)
+		{
+			const __m256d zero = _mm256_setzero_pd();
+			const __m256d one = _mm256_set1_pd(1.0);
+
+			__m256d magnitude = _mm256_mul_pd(_mm256_andnot_pd(_mm256_set1_pd(-0.0), value), _mm256_set1_pd(scale));
+			magnitude = _mm256_max_pd(magnitude, zero);											// NaN => 0
+			magnitude = _mm256_min_pd(magnitude, _mm256_set1_pd(maximum + 1.0));
+			__m256d integral = _mm256_floor_pd(magnitude);
+			__m256d rounded = _mm256_add_pd(integral, _mm256_and_pd(_mm256_cmp_pd(_mm256_sub_pd(magnitude, integral), _mm256_set1_pd(0.5), _CMP_GE_OQ), one));
+			rounded = _mm256_min_pd(rounded, _mm256_set1_pd(maximum));
+
+			negative = _mm256_andnot_pd(_mm256_cmp_pd(rounded, zero, _CMP_EQ_OQ), _mm256_cmp_pd(value, zero, _CMP_LT_OQ));
+			return rounded;
+		}
+
+		// double/float => Q8.8
+		template <typename F>
+		inline void
+		FromFloatingSse2(F const* source, FixedPointSmall* destination, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 2) <= count; i += 2)
+			{
+				__m128d negative;
+				__m128i magnitude = _mm_cvttpd_epi32(RoundMagnitude(Load2(source + i), 256.0, 65535.0, negative));
+				__m128i sign = _mm_shuffle_epi32(_mm_castpd_si128(negative), _MM_SHUFFLE(2, 0, 2, 0));
+				sign = _mm_and_si128(sign, _mm_set1_epi32(1));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i), _mm_or_si128(sign, _mm_slli_epi32(magnitude, 16)));
+			}
+			for(; i < count; i++)
+			{
+				destination[i] = FixedPointSmall::FromDouble(static_cast<double>(source[i]));
+			}
+		}
+
+		template <typename F>
+		SFPML_TARGET("avx2")
+		inline void
+		FromFloatingAvx2(F const* source, FixedPointSmall* destination, size_t count)
+		{
+			const __m256i gather = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m256d negative;
+				__m128i magnitude = _mm256_cvttpd_epi32(RoundMagnitude(Load4(source + i), 256.0, 65535.0, negative));
+				__m128i sign = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(negative), gather));
+				sign = _mm_and_si128(sign, _mm_set1_epi32(1));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_or_si128(sign, _mm_slli_epi32(magnitude, 16)));
+			}
+			FromFloatingSse2(source + i, destination + i, count - i);
+		}
+
+		// double/float => Q16.16
+		// Magnitudes up to 2^32 - 1 are converted as (magnitude - 2^31) ^ 0x80000000
+		template <typename F>
+		inline void
+		FromFloatingSse2(F const* source, FixedPointMedium* destination, size_t count)
+		{
+			const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+			size_t i = 0;
+			for(; (i + 2) <= count; i += 2)
+			{
+				__m128d negative;
+				__m128d rounded = RoundMagnitude(Load2(source + i), 65536.0, 4294967295.0, negative);
+				__m128i magnitude = _mm_xor_si128(_mm_cvttpd_epi32(_mm_sub_pd(rounded, _mm_set1_pd(2147483648.0))), bias);
+				__m128i sign = _mm_and_si128(_mm_castpd_si128(negative), _mm_set_epi32(0, 1, 0, 1));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_or_si128(sign, _mm_unpacklo_epi32(_mm_setzero_si128(), magnitude)));
+			}
+			for(; i < count; i++)
+			{
+				destination[i] = FixedPointMedium::FromDouble(static_cast<double>(source[i]));
+			}
+		}
+
+		template <typename F>
+		SFPML_TARGET("avx2")
+		inline void
+		FromFloatingAvx2(F const* source, FixedPointMedium* destination, size_t count)
+		{
+			const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m256d negative;
+				__m256d rounded = RoundMagnitude(Load4(source + i), 65536.0, 4294967295.0, negative);
+				__m128i magnitude = _mm_xor_si128(_mm256_cvttpd_epi32(_mm256_sub_pd(rounded, _mm256_set1_pd(2147483648.0))), bias);
+				__m256i sign = _mm256_and_si256(_mm256_castpd_si256(negative), _mm256_set1_epi64x(1));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_or_si256(sign, _mm256_slli_epi64(_mm256_cvtepu32_epi64(magnitude), 32)));
+			}
+			FromFloatingSse2(source + i, destination + i, count - i);
+		}
+
+		template <typename F>
+		inline void
+		FromFloating(F const* source, FixedPointSmall* destination, size_t count)
+		{
+			static void (* const table[])(F const*, FixedPointSmall*, size_t) = { FromFloatingScalar<uint16_t, F>, FromFloatingSse2<F>, FromFloatingAvx2<F>, FromFloatingAvx2<F> };
+			table[Level()](source, destination, count);
+		}
+
+		template <typename F>
+		inline void
+		FromFloating(F const* source, FixedPointMedium* destination, size_t count)
+		{
+			static void (* const table[])(F const*, FixedPointMedium*, size_t) = { FromFloatingScalar<uint32_t, F>, FromFloatingSse2<F>, FromFloatingAvx2<F>, FromFloatingAvx2<F> };
+			table[Level()](source, destination, count);
+		}
+
+		inline void
+		Store2(__m128d values, double* destination)
+		{
+			_mm_storeu_pd(destination, values);
+		}
+
+		inline void
+		Store2(__m128d values, float* destination)
+		{
+			_mm_storel_pi(reinterpret_cast<__m64*>(destination), _mm_cvtpd_ps(values));
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		Store4(__m256d values, double* destination)
+		{
+			_mm256_storeu_pd(destination, values);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		Store4(__m256d values, float* destination)
+		{
+			_mm_storeu_ps(destination, _mm256_cvtpd_ps(values));
+		}
+
+		// Q8.8 => double/float
+		template <typename F>
+		inline void
+		ToFloatingSse2(FixedPointSmall const* source, F* destination, size_t count)
+		{
+			const __m128i signByte = _mm_set1_epi32(0xFF);
+			const __m128i zero = _mm_setzero_si128();
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i));
+				__m128i magnitude = _mm_srli_epi32(v, 16);
+				__m128i negative = _mm_cmpgt_epi32(_mm_and_si128(v, signByte), zero);
+				__m128i negativeLo = _mm_slli_epi64(_mm_unpacklo_epi32(negative, negative), 63);
+				__m128i negativeHi = _mm_slli_epi64(_mm_unpackhi_epi32(negative, negative), 63);
+				__m128d lo = _mm_mul_pd(_mm_cvtepi32_pd(magnitude), _mm_set1_pd(1.0 / 256.0));
+				__m128d hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(magnitude, _MM_SHUFFLE(3, 2, 3, 2))), _mm_set1_pd(1.0 / 256.0));
+				Store2(_mm_xor_pd(lo, _mm_castsi128_pd(negativeLo)), destination + i);
+				Store2(_mm_xor_pd(hi, _mm_castsi128_pd(negativeHi)), destination + i + 2);
+			}
+			for(; i < count; i++)
+			{
+				destination[i] = static_cast<F>(source[i].ToDouble());
+			}
+		}
+
+		// Q16.16 => double/float
+		template <typename F>
+		inline void
+		ToFloatingSse2(FixedPointMedium const* source, F* destination, size_t count)
+		{
+			const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+			const __m128i zero = _mm_setzero_si128();
+			size_t i = 0;
+			for(; (i + 2) <= count; i += 2)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i));
+				__m128i magnitude = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 1, 3, 1));
+				__m128i negative = _mm_cmpgt_epi32(_mm_and_si128(v, _mm_set_epi32(0, 0xFF, 0, 0xFF)), zero);
+				negative = _mm_slli_epi64(_mm_shuffle_epi32(negative, _MM_SHUFFLE(2, 2, 0, 0)), 63);
+				__m128d value = _mm_add_pd(_mm_cvtepi32_pd(_mm_xor_si128(magnitude, bias)), _mm_set1_pd(2147483648.0));
+				value = _mm_mul_pd(value, _mm_set1_pd(1.0 / 65536.0));
+				Store2(_mm_xor_pd(value, _mm_castsi128_pd(negative)), destination + i);
+			}
+			for(; i < count; i++)
+			{
+				destination[i] = static_cast<F>(source[i].ToDouble());
+			}
+		}
+
+		template <typename F>
+		SFPML_TARGET("avx2")
+		inline void
+		ToFloatingAvx2(FixedPointMedium const* source, F* destination, size_t count)
+		{
+			const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+			const __m128i zero = _mm_setzero_si128();
+			const __m256i gatherSigns = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+			const __m256i gatherMagnitudes = _mm256_setr_epi32(1, 3, 5, 7, 1, 3, 5, 7);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(source + i));
+				__m128i magnitude = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, gatherMagnitudes));
+				__m128i negative = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, gatherSigns));
+				negative = _mm_cmpgt_epi32(_mm_and_si128(negative, _mm_set1_epi32(0xFF)), zero);
+				__m256d value = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(magnitude, bias)), _mm256_set1_pd(2147483648.0));
+				value = _mm256_mul_pd(value, _mm256_set1_pd(1.0 / 65536.0));
+				value = _mm256_xor_pd(value, _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_cvtepi32_epi64(negative), 63)));
+				Store4(value, destination + i);
+			}
+			ToFloatingSse2(source + i, destination + i, count - i);
+		}
+
+		inline void
+		ToDouble(FixedPointSmall const* source, double* destination, size_t count)
+		{
+			static void (* const table[])(FixedPointSmall const*, double*, size_t) = { ToFloatingScalar<uint16_t, double>, ToFloatingSse2<double>, ToFloatingSse2<double>, ToFloatingSse2<double> };
+			table[Level()](source, destination, count);
+		}
+
+		inline void
+		ToFloat(FixedPointSmall const* source, float* destination, size_t count)
+		{
+			static void (* const table[])(FixedPointSmall const*, float*, size_t) = { ToFloatingScalar<uint16_t, float>, ToFloatingSse2<float>, ToFloatingSse2<float>, ToFloatingSse2<float> };
+			table[Level()](source, destination, count);
+		}
+
+		inline void
+		ToDouble(FixedPointMedium const* source, double* destination, size_t count)
+		{
+			static void (* const table[])(FixedPointMedium const*, double*, size_t) = { ToFloatingScalar<uint32_t, double>, ToFloatingSse2<double>, ToFloatingAvx2<double>, ToFloatingAvx2<double> };
+			table[Level()](source, destination, count);
+		}
+
+		inline void
+		ToFloat(FixedPointMedium const* source, float* destination, size_t count)
+		{
+			static void (* const table[])(FixedPointMedium const*, float*, size_t) = { ToFloatingScalar<uint32_t, float>, ToFloatingSse2<float>, ToFloatingAvx2<float>, ToFloatingAvx2<float> };
+			table[Level()](source, destination, count);
+		}
+#endif
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::FromDouble(Span<double const> source, Span<FixedPoint<T>> destination)
+	{
+		if (source.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::FromFloating(source.Data(), destination.Data(), source.Size());
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::FromFloat(Span<float const> source, Span<FixedPoint<T>> destination)
+	{
+		if (source.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::FromFloating(source.Data(), destination.Data(), source.Size());
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::ToDouble(Span<FixedPoint<T> const> source, Span<double> destination)
+	{
+		if (source.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::ToDouble(source.Data(), destination.Data(), source.Size());
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::ToFloat(Span<FixedPoint<T> const> source, Span<float> destination)
+	{
+		if (source.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::ToFloat(source.Data(), destination.Data(), source.Size());
+	}
+
+	// Bulk trigonometric functions
+	// The angles are converted to double (exact for Q8.8 and Q16.16), reduced to
+	// [-Pi/4, Pi/4] with the quadrant index k = round(x * 2/Pi) and Pi/2 split in three
+	// parts (Cody-Waite), then the sine and cosine polynomials of fdlibm are evaluated
+	// on every lane and the quadrant only selects/negates them (no branches).
+	// Q32.32 angles above 2^21 do not fit in a double and k * Pi/2 needs more bits than
+	// the three parts: they are first reduced exactly on integers (ReduceAngles), so
+	// the double lanes only see x - k * Pi/2 + (k mod 4) * Pi/2.
+	// The results are rounded like FromDouble; unlike Sin/Cos any angle is accepted.
+
+	namespace kernels
+	{
+		// Number of elements converted to double at a time (stack buffers)
+		const size_t BlockSize = 128;
+
+		const double TwoOverPi = 6.36619772367581382433e-01;
+		const double Pi2Part1 = 1.57079632673412561417e+00;			// First 33 bits of Pi/2
+		const double Pi2Part2 = 6.07710050630396597660e-11;			// Next 33 bits
+		const double Pi2Part3 = 2.02226624879595063154e-21;			// Pi/2 - Part1 - Part2
+		const double RoundingShift = 6755399441055744.0;				// 1.5 * 2^52: x + shift - shift rounds x to an integer
+
+		const double SinCoefficients[] = { -1.66666666666666324348e-01, 8.33333333332248946124e-03, -1.98412698298579493134e-04, 2.75573137070700676789e-06, -2.50507602534068634195e-08, 1.58969099521155010221e-10 };
+		const double CosCoefficients[] = { 4.16666666666666019037e-02, -1.38888888888741095749e-03, 2.48015872894767294178e-05, -2.75573143513906633035e-07, 2.08757232129817482790e-09, -1.13596475577881948265e-11 };
+
+		inline void
+		SinCos(double x, double& sine, double& cosine)
+		{
+			double shifted = (x * TwoOverPi) + RoundingShift;
+			double k = shifted - RoundingShift;
+			uint64_t quadrant;
+			memcpy(&quadrant, &shifted, sizeof(quadrant));
+
+			double r = ((x - (k * Pi2Part1)) - (k * Pi2Part2)) - (k * Pi2Part3);
+			double z = r * r;
+			double s = SinCoefficients[5];
+			double c = CosCoefficients[5];
+			for(int i = 4; i >= 0; i--)
+			{
+				s = (s * z) + SinCoefficients[i];
+				c = (c * z) + CosCoefficients[i];
+			}
+			s = r + ((r * z) * s);
+			c = (1.0 - (0.5 * z)) + ((z * z) * c);
+
+			// sin(x) = { s, c, -s, -c }[k & 3], cos(x) = { c, -s, -c, s }[k & 3]
+			sine = (quadrant & 1) ? c : s;
+			cosine = (quadrant & 1) ? s : c;
+			if (quadrant & 2)
+			{
+				sine = -sine;
+			}
+			if ((quadrant + 1) & 2)
+			{
+				cosine = -cosine;
+			}
+		}
+
+		// sine or cosine may be null
+		inline void
+		SinCosScalar(double const* x, double* sine, double* cosine, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				double s;
+				double c;
+				SinCos(x[i], s, c);
+				if (sine)
+				{
+					sine[i] = s;
+				}
+				if (cosine)
+				{
+					cosine[i] = c;
+				}
+			}
+		}
+
+#if defined(SFPML_SSE2)
+		inline void
+		SinCos(__m128d x, __m128d& sine, __m128d& cosine)
+		{
+			const __m128d shift = _mm_set1_pd(RoundingShift);
+			const __m128i one = _mm_set_epi32(0, 1, 0, 1);
+			const __m128i two = _mm_set_epi32(0, 2, 0, 2);
+
+			__m128d shifted = _mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(TwoOverPi)), shift);
+			__m128d k = _mm_sub_pd(shifted, shift);
+			__m128i quadrant = _mm_castpd_si128(shifted);
+
+			__m128d r = _mm_sub_pd(x, _mm_mul_pd(k, _mm_set1_pd(Pi2Part1)));
+			r = _mm_sub_pd(r, _mm_mul_pd(k, _mm_set1_pd(Pi2Part2)));
+			r = _mm_sub_pd(r, _mm_mul_pd(k, _mm_set1_pd(Pi2Part3)));
+			__m128d z = _mm_mul_pd(r, r);
+			__m128d s = _mm_set1_pd(SinCoefficients[5]);
+			__m128d c = _mm_set1_pd(CosCoefficients[5]);
+			for(int i = 4; i >= 0; i--)
+			{
+				s = _mm_add_pd(_mm_mul_pd(s, z), _mm_set1_pd(SinCoefficients[i]));
+				c = _mm_add_pd(_mm_mul_pd(c, z), _mm_set1_pd(CosCoefficients[i]));
+			}
+			s = _mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, z), s));
+			c = _mm_add_pd(_mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(_mm_set1_pd(0.5), z)), _mm_mul_pd(_mm_mul_pd(z, z), c));
+
+			__m128d swap = _mm_castsi128_pd(_mm_sub_epi64(_mm_setzero_si128(), _mm_and_si128(quadrant, one)));
+			__m128d sineSign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(quadrant, two), 62));
+			__m128d cosineSign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(_mm_add_epi64(quadrant, one), two), 62));
+			sine = _mm_xor_pd(_mm_or_pd(_mm_and_pd(swap, c), _mm_andnot_pd(swap, s)), sineSign);
+			cosine = _mm_xor_pd(_mm_or_pd(_mm_and_pd(swap, s), _mm_andnot_pd(swap, c)), cosineSign);
+		}
+
+		inline void
+		SinCosSse2(double const* x, double* sine, double* cosine, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 2) <= count; i += 2)
+			{
+				__m128d s;
+				__m128d c;
+				SinCos(_mm_loadu_pd(x + i), s, c);
+				if (sine)
+				{
+					_mm_storeu_pd(sine + i, s);
+				}
+				if (cosine)
+				{
+					_mm_storeu_pd(cosine + i, c);
+				}
+			}
+			if (i < count)
+			{
+				__m128d s;
+				__m128d c;
+				SinCos(_mm_load_sd(x + i), s, c);
+				if (sine)
+				{
+					_mm_store_sd(sine + i, s);
+				}
+				if (cosine)
+				{
+					_mm_store_sd(cosine + i, c);
+				}
+			}
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		SinCos(__m256d x, __m256d& sine, __m256d& cosine)
+		{
+			const __m256d shift = _mm256_set1_pd(RoundingShift);
+			const __m256i one = _mm256_set1_epi64x(1);
+			const __m256i two = _mm256_set1_epi64x(2);
+
+			__m256d shifted = _mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(TwoOverPi)), shift);
+			__m256d k = _mm256_sub_pd(shifted, shift);
+			__m256i quadrant = _mm256_castpd_si256(shifted);
+
+			__m256d r = _mm256_sub_pd(x, _mm256_mul_pd(k, _mm256_set1_pd(Pi2Part1)));
+			r = _mm256_sub_pd(r, _mm256_mul_pd(k, _mm256_set1_pd(Pi2Part2)));
+			r = _mm256_sub_pd(r, _mm256_mul_pd(k, _mm256_set1_pd(Pi2Part3)));
+			__m256d z = _mm256_mul_pd(r, r);
+			__m256d s = _mm256_set1_pd(SinCoefficients[5]);
+			__m256d c = _mm256_set1_pd(CosCoefficients[5]);
+			for(int i = 4; i >= 0; i--)
+			{
+				s = _mm256_add_pd(_mm256_mul_pd(s, z), _mm256_set1_pd(SinCoefficients[i]));
+				c = _mm256_add_pd(_mm256_mul_pd(c, z), _mm256_set1_pd(CosCoefficients[i]));
+			}
+			s = _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(r, z), s));
+			c = _mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(_mm256_set1_pd(0.5), z)), _mm256_mul_pd(_mm256_mul_pd(z, z), c));
+
+			__m256d swap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(quadrant, one), one));
+			__m256d sineSign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(quadrant, two), 62));
+			__m256d cosineSign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(quadrant, one), two), 62));
+			sine = _mm256_xor_pd(_mm256_blendv_pd(s, c, swap), sineSign);
+			cosine = _mm256_xor_pd(_mm256_blendv_pd(c, s, swap), cosineSign);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		SinCosAvx2(double const* x, double* sine, double* cosine, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m256d s;
+				__m256d c;
+				SinCos(_mm256_loadu_pd(x + i), s, c);
+				if (sine)
+				{
+					_mm256_storeu_pd(sine + i, s);
+				}
+				if (cosine)
+				{
+					_mm256_storeu_pd(cosine + i, c);
+				}
+			}
+			SinCosSse2(x + i, sine ? sine + i : nullptr, cosine ? cosine + i : nullptr, count - i);
+		}
+#endif
+
+		inline void
+		SinCos(double const* x, double* sine, double* cosine, size_t count)
+		{
+#if defined(SFPML_SSE2)
+			static void (* const table[])(double const*, double*, double*, size_t) = { SinCosScalar, SinCosSse2, SinCosAvx2, SinCosAvx2 };
+			table[Level()](x, sine, cosine, count);
+#else
+			SinCosScalar(x, sine, cosine, count);
+#endif
+		}
+
+		template <typename T>
+		inline void
+		ReduceAngles(FixedPoint<T> const* angles, double* x, size_t count)
+		{
+			ToDouble(angles, x, count);
+		}
+
+		// floor(Pi/2 * 2^96), 32 bit limbs (least significant first)
+		const uint32_t Pi2Limbs[4] = { 0x898CC517u, 0x42D18469u, 0x921FB544u, 0x1u };
+
+		// |x| * 2^96 - k * floor(Pi/2 * 2^96) on 5 limbs (two's complement): k < 2^32 and the
+		// error of the truncated Pi/2 is below k * 2^-96. k comes from the double estimate of
+		// |x| * 2/Pi: when it is off by one, r is slightly beyond Pi/4, which the polynomials
+		// still handle.
+		inline void
+		ReduceAngles(FixedPoint<uint64_t> const* angles, double* x, size_t count)
+		{
+			const double pi2 = 1.57079632679489661923;
+			for(size_t i = 0; i < count; i++)
+			{
+				typename FixedPoint<uint64_t>::Number number = angles[i];
+				uint64_t magnitude = number.value.fixedPoint;
+				uint64_t k = static_cast<uint64_t>((static_cast<double>(magnitude) * (TwoOverPi / 4294967296.0)) + 0.5);
+
+				uint32_t limbs[5] = { 0, 0, static_cast<uint32_t>(magnitude), static_cast<uint32_t>(magnitude >> 32), 0 };
+				uint64_t carry = 0;
+				uint32_t borrow = 0;
+				for(int j = 0; j < 5; j++)
+				{
+					uint64_t product = ((j < 4) ? (k * Pi2Limbs[j]) : 0) + carry;
+					carry = product >> 32;
+					uint64_t difference = static_cast<uint64_t>(limbs[j]) - static_cast<uint32_t>(product) - borrow;
+					limbs[j] = static_cast<uint32_t>(difference);
+					borrow = static_cast<uint32_t>(difference >> 63);
+				}
+				bool negative = (limbs[4] >> 31) != 0;
+				if (negative)
+				{
+					uint32_t increment = 1;
+					for(int j = 0; j < 5; j++)
+					{
+						uint64_t sum = static_cast<uint64_t>(~limbs[j]) + increment;
+						limbs[j] = static_cast<uint32_t>(sum);
+						increment = static_cast<uint32_t>(sum >> 32);
+					}
+				}
+
+				// |r| < 2: limbs[4] is 0 and limbs[3] at most 1
+				double r = (((((static_cast<double>(limbs[3]) * 4294967296.0) + limbs[2]) * 4294967296.0) + limbs[1]) * 4294967296.0) + limbs[0];
+				r *= 1.0 / 79228162514264337593543950336.0;
+				r = (negative ? -r : r) + (static_cast<double>(k & 3) * pi2);
+				x[i] = number.sign ? -r : r;
+			}
+		}
+
+		template <typename T>
+		inline void
+		SinCos(FixedPoint<T> const* angles, FixedPoint<T>* sines, FixedPoint<T>* cosines, size_t count)
+		{
+			double x[BlockSize];
+			double s[BlockSize];
+			double c[BlockSize];
+			for(size_t i = 0; i < count; i += BlockSize)
+			{
+				size_t n = ((count - i) < BlockSize) ? (count - i) : BlockSize;
+				ReduceAngles(angles + i, x, n);
+				SinCos(x, sines ? s : nullptr, cosines ? c : nullptr, n);
+				if (sines)
+				{
+					FromFloating(s, sines + i, n);
+				}
+				if (cosines)
+				{
+					FromFloating(c, cosines + i, n);
+				}
+			}
+		}
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::Sin(Span<FixedPoint<T> const> angles, Span<FixedPoint<T>> destination)
+	{
+		if (angles.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::SinCos(angles.Data(), destination.Data(), static_cast<FixedPoint<T>*>(nullptr), angles.Size());
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::Cos(Span<FixedPoint<T> const> angles, Span<FixedPoint<T>> destination)
+	{
+		if (angles.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::SinCos(angles.Data(), static_cast<FixedPoint<T>*>(nullptr), destination.Data(), angles.Size());
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::SinCos(Span<FixedPoint<T> const> angles, Span<FixedPoint<T>> sines, Span<FixedPoint<T>> cosines)
+	{
+		if ((angles.Size() != sines.Size()) || (angles.Size() != cosines.Size()))
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::SinCos(angles.Data(), sines.Data(), cosines.Data(), angles.Size());
+	}
+
+	// Bulk exponential, logarithm and power
+	// Same scheme as the trigonometric functions: blocks converted to double, then
+	// branch-free lane-parallel kernels (fdlibm reductions and polynomials):
+	// - exp(x) = 2^k * exp(r), k = round(x / ln2), r = x - k * ln2 (ln2 split in two parts)
+	// - log2(x) = e + log(m) / ln2, x = 2^e * m with m in [sqrt(2)/2, sqrt(2))
+	// - pow(x, y) = exp(y * ln|x|), negated for a negative base and an odd integer exponent
+	// The results are rounded like FromDouble and saturated. The invalid elements
+	// (logarithm of x <= 0, 0 to a negative power, negative base to a fractional power)
+	// are set to 0 and reported once the whole span has been computed.
+
+	namespace kernels
+	{
+		const double Log2E = 1.44269504088896338700e+00;
+		const double Ln2Part1 = 6.93147180369123816490e-01;			// First 32 bits of ln2
+		const double Ln2Part2 = 1.90821492927058770002e-10;			// ln2 - Part1
+		const double Sqrt2 = 1.41421356237309504880e+00;
+		const double ExpLimit = 700.0;								// exp(700) overflows every FixedPoint type, exp(-700) rounds to 0
+		const uint64_t RoundingShiftBits = 0x4338000000000000ull;	// Bits of RoundingShift
+		const uint64_t ExponentShiftBits = 0x4330000000000000ull;	// Bits of 2^52
+
+		const double ExpCoefficients[] = { 1.66666666666666019037e-01, -2.77777777770155933842e-03, 6.61375632143793436117e-05, -1.65339022054652515390e-06, 4.13813679705723846039e-08 };
+		const double LogCoefficients[] = { 6.666666666666735130e-01, 3.999999999940941908e-01, 2.857142874366239149e-01, 2.222219843214978396e-01, 1.818357216161805012e-01, 1.531383769920937332e-01, 1.479819860511658591e-01 };
+
+		inline double
+		AsDouble(uint64_t bits)
+		{
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		inline uint64_t
+		AsBits(double value)
+		{
+			uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		inline double
+		Exp(double x)
+		{
+			x = (x < -ExpLimit) ? -ExpLimit : ((x > ExpLimit) ? ExpLimit : x);
+			double shifted = (x * Log2E) + RoundingShift;
+			double k = shifted - RoundingShift;
+			double hi = x - (k * Ln2Part1);
+			double lo = k * Ln2Part2;
+			double r = hi - lo;
+			double z = r * r;
+			double p = ExpCoefficients[4];
+			for(int i = 3; i >= 0; i--)
+			{
+				p = (p * z) + ExpCoefficients[i];
+			}
+			double c = r - (z * p);
+			double y = 1.0 - ((lo - ((r * c) / (2.0 - c))) - hi);
+			return y * AsDouble((AsBits(shifted) - RoundingShiftBits + 1023) << 52);
+		}
+
+		// Natural logarithm of x > 0
+		inline double
+		Log(double x)
+		{
+			uint64_t bits = AsBits(x);
+			double e = AsDouble(ExponentShiftBits | (bits >> 52)) - (4503599627370496.0 + 1023.0);
+			double m = AsDouble((bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull);
+			if (m > Sqrt2)
+			{
+				m *= 0.5;
+				e += 1.0;
+			}
+
+			double f = m - 1.0;
+			double s = f / (2.0 + f);
+			double z = s * s;
+			double w = z * z;
+			double t1 = w * (LogCoefficients[1] + (w * (LogCoefficients[3] + (w * LogCoefficients[5]))));
+			double t2 = z * (LogCoefficients[0] + (w * (LogCoefficients[2] + (w * (LogCoefficients[4] + (w * LogCoefficients[6]))))));
+			double halfSquare = 0.5 * f * f;
+			double logM = f - (halfSquare - (s * (halfSquare + (t1 + t2))));
+			return (e * Ln2Part1) + (logM + (e * Ln2Part2));
+		}
+
+		inline void
+		ExpScalar(double const* x, double* out, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				out[i] = Exp(x[i]);
+			}
+		}
+
+		// out = log(x) * factor. Returns true if an element was not positive.
+		inline bool
+		LogScalar(double const* x, double factor, double* out, size_t count)
+		{
+			bool invalid = false;
+			for(size_t i = 0; i < count; i++)
+			{
+				bool valid = x[i] > 0.0;
+				double value = Log(valid ? x[i] : 1.0) * factor;
+				out[i] = valid ? value : 0.0;
+				invalid |= !valid;
+			}
+			return invalid;
+		}
+
+		inline double
+		Pow(double x, double y, bool& invalid)
+		{
+			double shifted = y + RoundingShift;
+			bool integer = (shifted - RoundingShift) == y;
+			bool odd = integer && (AsBits(shifted) & 1);
+			bool zero = x == 0.0;
+			bool valid = (zero && (y >= 0.0)) || (!zero && ((x > 0.0) || integer));
+			invalid |= !valid;
+
+			double value = Exp(y * Log(zero ? 1.0 : fabs(x)));
+			value = zero ? ((y == 0.0) ? 1.0 : 0.0) : value;
+			value = ((x < 0.0) && odd) ? -value : value;
+			return valid ? value : 0.0;
+		}
+
+		inline bool
+		PowScalar(double const* x, double const* y, double* out, size_t count)
+		{
+			bool invalid = false;
+			for(size_t i = 0; i < count; i++)
+			{
+				out[i] = Pow(x[i], y[i], invalid);
+			}
+			return invalid;
+		}
+
+#if defined(SFPML_SSE2)
+		inline __m128d
+		Exp(__m128d x)
+		{
+			const __m128d shift = _mm_set1_pd(RoundingShift);
+
+			x = _mm_min_pd(_mm_max_pd(x, _mm_set1_pd(-ExpLimit)), _mm_set1_pd(ExpLimit));
+			__m128d shifted = _mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(Log2E)), shift);
+			__m128d k = _mm_sub_pd(shifted, shift);
+			__m128d hi = _mm_sub_pd(x, _mm_mul_pd(k, _mm_set1_pd(Ln2Part1)));
+			__m128d lo = _mm_mul_pd(k, _mm_set1_pd(Ln2Part2));
+			__m128d r = _mm_sub_pd(hi, lo);
+			__m128d z = _mm_mul_pd(r, r);
+			__m128d p = _mm_set1_pd(ExpCoefficients[4]);
+			for(int i = 3; i >= 0; i--)
+			{
+				p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(ExpCoefficients[i]));
+			}
+			__m128d c = _mm_sub_pd(r, _mm_mul_pd(z, p));
+			__m128d y = _mm_div_pd(_mm_mul_pd(r, c), _mm_sub_pd(_mm_set1_pd(2.0), c));
+			y = _mm_sub_pd(_mm_set1_pd(1.0), _mm_sub_pd(_mm_sub_pd(lo, y), hi));
+			__m128i scale = _mm_add_epi64(_mm_sub_epi64(_mm_castpd_si128(shifted), _mm_set1_epi64x(static_cast<long long>(RoundingShiftBits))), _mm_set1_epi64x(1023));
+			return _mm_mul_pd(y, _mm_castsi128_pd(_mm_slli_epi64(scale, 52)));
+		}
+
+		inline __m128d
+		Log(__m128d x)
+		{
+			const __m128d one = _mm_set1_pd(1.0);
+
+			__m128i bits = _mm_castpd_si128(x);
+			__m128d e = _mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(bits, 52), _mm_set1_epi64x(static_cast<long long>(ExponentShiftBits))));
+			e = _mm_sub_pd(e, _mm_set1_pd(4503599627370496.0 + 1023.0));
+			__m128d m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(0x000FFFFFFFFFFFFFll)), _mm_set1_epi64x(0x3FF0000000000000ll)));
+			__m128d large = _mm_cmpgt_pd(m, _mm_set1_pd(Sqrt2));
+			m = _mm_mul_pd(m, _mm_or_pd(_mm_and_pd(large, _mm_set1_pd(0.5)), _mm_andnot_pd(large, one)));
+			e = _mm_add_pd(e, _mm_and_pd(large, one));
+
+			__m128d f = _mm_sub_pd(m, one);
+			__m128d s = _mm_div_pd(f, _mm_add_pd(_mm_set1_pd(2.0), f));
+			__m128d z = _mm_mul_pd(s, s);
+			__m128d w = _mm_mul_pd(z, z);
+			__m128d t1 = _mm_add_pd(_mm_set1_pd(LogCoefficients[3]), _mm_mul_pd(w, _mm_set1_pd(LogCoefficients[5])));
+			t1 = _mm_mul_pd(w, _mm_add_pd(_mm_set1_pd(LogCoefficients[1]), _mm_mul_pd(w, t1)));
+			__m128d t2 = _mm_add_pd(_mm_set1_pd(LogCoefficients[4]), _mm_mul_pd(w, _mm_set1_pd(LogCoefficients[6])));
+			t2 = _mm_add_pd(_mm_set1_pd(LogCoefficients[2]), _mm_mul_pd(w, t2));
+			t2 = _mm_mul_pd(z, _mm_add_pd(_mm_set1_pd(LogCoefficients[0]), _mm_mul_pd(w, t2)));
+			__m128d halfSquare = _mm_mul_pd(_mm_mul_pd(_mm_set1_pd(0.5), f), f);
+			__m128d logM = _mm_sub_pd(f, _mm_sub_pd(halfSquare, _mm_mul_pd(s, _mm_add_pd(halfSquare, _mm_add_pd(t1, t2)))));
+			return _mm_add_pd(_mm_mul_pd(e, _mm_set1_pd(Ln2Part1)), _mm_add_pd(logM, _mm_mul_pd(e, _mm_set1_pd(Ln2Part2))));
+		}
+
+		inline __m128d
+		Pow(__m128d x, __m128d y, __m128d& invalid)
+		{
+			const __m128d zero = _mm_setzero_pd();
+			const __m128d one = _mm_set1_pd(1.0);
+			const __m128d shift = _mm_set1_pd(RoundingShift);
+			const __m128d signBit = _mm_set1_pd(-0.0);
+
+			__m128d shifted = _mm_add_pd(y, shift);
+			__m128d integer = _mm_cmpeq_pd(_mm_sub_pd(shifted, shift), y);
+			__m128d sign = _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(shifted), 63));		// Odd exponent
+			sign = _mm_and_pd(_mm_and_pd(sign, integer), _mm_and_pd(x, signBit));
+			__m128d isZero = _mm_cmpeq_pd(x, zero);
+			__m128d valid = _mm_or_pd(_mm_and_pd(isZero, _mm_cmpge_pd(y, zero)), _mm_andnot_pd(isZero, _mm_or_pd(_mm_cmpgt_pd(x, zero), integer)));
+			invalid = _mm_or_pd(invalid, _mm_andnot_pd(valid, _mm_castsi128_pd(_mm_set1_epi32(-1))));
+
+			__m128d magnitude = _mm_or_pd(_mm_andnot_pd(isZero, _mm_andnot_pd(signBit, x)), _mm_and_pd(isZero, one));
+			__m128d value = Exp(_mm_mul_pd(y, Log(magnitude)));
+			__m128d zeroPower = _mm_and_pd(_mm_cmpeq_pd(y, zero), one);
+			value = _mm_or_pd(_mm_andnot_pd(isZero, value), _mm_and_pd(isZero, zeroPower));
+			return _mm_and_pd(_mm_xor_pd(value, sign), valid);
+		}
+
+		inline void
+		ExpSse2(double const* x, double* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 2) <= count; i += 2)
+			{
+				_mm_storeu_pd(out + i, Exp(_mm_loadu_pd(x + i)));
+			}
+			if (i < count)
+			{
+				_mm_store_sd(out + i, Exp(_mm_load_sd(x + i)));
+			}
+		}
+
+		inline __m128d
+		Log(__m128d x, __m128d factor, __m128d& invalid)
+		{
+			__m128d valid = _mm_cmpgt_pd(x, _mm_setzero_pd());
+			invalid = _mm_or_pd(invalid, _mm_andnot_pd(valid, _mm_castsi128_pd(_mm_set1_epi32(-1))));
+			x = _mm_or_pd(_mm_and_pd(valid, x), _mm_andnot_pd(valid, _mm_set1_pd(1.0)));
+			return _mm_and_pd(_mm_mul_pd(Log(x), factor), valid);
+		}
+
+		inline bool
+		LogSse2(double const* x, double factor, double* out, size_t count)
+		{
+			const __m128d scale = _mm_set1_pd(factor);
+			__m128d invalid = _mm_setzero_pd();
+			size_t i = 0;
+			for(; (i + 2) <= count; i += 2)
+			{
+				_mm_storeu_pd(out + i, Log(_mm_loadu_pd(x + i), scale, invalid));
+			}
+			if (i < count)
+			{
+				// The upper lane (0) is invalid: only the lower one is checked
+				__m128d last = _mm_setzero_pd();
+				_mm_store_sd(out + i, Log(_mm_load_sd(x + i), scale, last));
+				invalid = _mm_or_pd(invalid, _mm_move_sd(_mm_setzero_pd(), last));
+			}
+			return _mm_movemask_pd(invalid) != 0;
+		}
+
+		inline bool
+		PowSse2(double const* x, double const* y, double* out, size_t count)
+		{
+			__m128d invalid = _mm_setzero_pd();
+			size_t i = 0;
+			for(; (i + 2) <= count; i += 2)
+			{
+				_mm_storeu_pd(out + i, Pow(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i), invalid));
+			}
+			if (i < count)
+			{
+				_mm_store_sd(out + i, Pow(_mm_load_sd(x + i), _mm_load_sd(y + i), invalid));
+			}
+			return _mm_movemask_pd(invalid) != 0;
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256d
+		Exp(__m256d x)
+		{
+			const __m256d shift = _mm256_set1_pd(RoundingShift);
+
+			x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-ExpLimit)), _mm256_set1_pd(ExpLimit));
+			__m256d shifted = _mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(Log2E)), shift);
+			__m256d k = _mm256_sub_pd(shifted, shift);
+			__m256d hi = _mm256_sub_pd(x, _mm256_mul_pd(k, _mm256_set1_pd(Ln2Part1)));
+			__m256d lo = _mm256_mul_pd(k, _mm256_set1_pd(Ln2Part2));
+			__m256d r = _mm256_sub_pd(hi, lo);
+			__m256d z = _mm256_mul_pd(r, r);
+			__m256d p = _mm256_set1_pd(ExpCoefficients[4]);
+			for(int i = 3; i >= 0; i--)
+			{
+				p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(ExpCoefficients[i]));
+			}
+			__m256d c = _mm256_sub_pd(r, _mm256_mul_pd(z, p));
+			__m256d y = _mm256_div_pd(_mm256_mul_pd(r, c), _mm256_sub_pd(_mm256_set1_pd(2.0), c));
+			y = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_sub_pd(_mm256_sub_pd(lo, y), hi));
+			__m256i scale = _mm256_add_epi64(_mm256_sub_epi64(_mm256_castpd_si256(shifted), _mm256_set1_epi64x(static_cast<long long>(RoundingShiftBits))), _mm256_set1_epi64x(1023));
+			return _mm256_mul_pd(y, _mm256_castsi256_pd(_mm256_slli_epi64(scale, 52)));
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256d
+		Log(__m256d x)
+		{
+			const __m256d one = _mm256_set1_pd(1.0);
+
+			__m256i bits = _mm256_castpd_si256(x);
+			__m256d e = _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(static_cast<long long>(ExponentShiftBits))));
+			e = _mm256_sub_pd(e, _mm256_set1_pd(4503599627370496.0 + 1023.0));
+			__m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFll)), _mm256_set1_epi64x(0x3FF0000000000000ll)));
+			__m256d large = _mm256_cmp_pd(m, _mm256_set1_pd(Sqrt2), _CMP_GT_OQ);
+			m = _mm256_mul_pd(m, _mm256_blendv_pd(one, _mm256_set1_pd(0.5), large));
+			e = _mm256_add_pd(e, _mm256_and_pd(large, one));
+
+			__m256d f = _mm256_sub_pd(m, one);
+			__m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+			__m256d z = _mm256_mul_pd(s, s);
+			__m256d w = _mm256_mul_pd(z, z);
+			__m256d t1 = _mm256_add_pd(_mm256_set1_pd(LogCoefficients[3]), _mm256_mul_pd(w, _mm256_set1_pd(LogCoefficients[5])));
+			t1 = _mm256_mul_pd(w, _mm256_add_pd(_mm256_set1_pd(LogCoefficients[1]), _mm256_mul_pd(w, t1)));
+			__m256d t2 = _mm256_add_pd(_mm256_set1_pd(LogCoefficients[4]), _mm256_mul_pd(w, _mm256_set1_pd(LogCoefficients[6])));
+			t2 = _mm256_add_pd(_mm256_set1_pd(LogCoefficients[2]), _mm256_mul_pd(w, t2));
+			t2 = _mm256_mul_pd(z, _mm256_add_pd(_mm256_set1_pd(LogCoefficients[0]), _mm256_mul_pd(w, t2)));
+			__m256d halfSquare = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), f), f);
+			__m256d logM = _mm256_sub_pd(f, _mm256_sub_pd(halfSquare, _mm256_mul_pd(s, _mm256_add_pd(halfSquare, _mm256_add_pd(t1, t2)))));
+			return _mm256_add_pd(_mm256_mul_pd(e, _mm256_set1_pd(Ln2Part1)), _mm256_add_pd(logM, _mm256_mul_pd(e, _mm256_set1_pd(Ln2Part2))));
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256d
+		Pow(__m256d x, __m256d y, __m256d& invalid)
+		{
+			const __m256d zero = _mm256_setzero_pd();
+			const __m256d one = _mm256_set1_pd(1.0);
+			const __m256d shift = _mm256_set1_pd(RoundingShift);
+			const __m256d signBit = _mm256_set1_pd(-0.0);
+
+			__m256d shifted = _mm256_add_pd(y, shift);
+			__m256d integer = _mm256_cmp_pd(_mm256_sub_pd(shifted, shift), y, _CMP_EQ_OQ);
+			__m256d sign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(shifted), 63));	// Odd exponent
+			sign = _mm256_and_pd(_mm256_and_pd(sign, integer), _mm256_and_pd(x, signBit));
+			__m256d isZero = _mm256_cmp_pd(x, zero, _CMP_EQ_OQ);
+			__m256d valid = _mm256_blendv_pd(_mm256_or_pd(_mm256_cmp_pd(x, zero, _CMP_GT_OQ), integer), _mm256_cmp_pd(y, zero, _CMP_GE_OQ), isZero);
+			invalid = _mm256_or_pd(invalid, _mm256_andnot_pd(valid, _mm256_castsi256_pd(_mm256_set1_epi32(-1))));
+
+			__m256d magnitude = _mm256_blendv_pd(_mm256_andnot_pd(signBit, x), one, isZero);
+			__m256d value = Exp(_mm256_mul_pd(y, Log(magnitude)));
+			value = _mm256_blendv_pd(value, _mm256_and_pd(_mm256_cmp_pd(y, zero, _CMP_EQ_OQ), one), isZero);
+			return _mm256_and_pd(_mm256_xor_pd(value, sign), valid);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		ExpAvx2(double const* x, double* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				_mm256_storeu_pd(out + i, Exp(_mm256_loadu_pd(x + i)));
+			}
+			ExpSse2(x + i, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx2")
+		inline bool
+		LogAvx2(double const* x, double factor, double* out, size_t count)
+		{
+			const __m256d scale = _mm256_set1_pd(factor);
+			const __m256d zero = _mm256_setzero_pd();
+			__m256d invalid = zero;
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m256d v = _mm256_loadu_pd(x + i);
+				__m256d valid = _mm256_cmp_pd(v, zero, _CMP_GT_OQ);
+				invalid = _mm256_or_pd(invalid, _mm256_andnot_pd(valid, _mm256_castsi256_pd(_mm256_set1_epi32(-1))));
+				v = _mm256_blendv_pd(_mm256_set1_pd(1.0), v, valid);
+				_mm256_storeu_pd(out + i, _mm256_and_pd(_mm256_mul_pd(Log(v), scale), valid));
+			}
+			bool tail = LogSse2(x + i, factor, out + i, count - i);
+			return (_mm256_movemask_pd(invalid) != 0) || tail;
+		}
+
+		SFPML_TARGET("avx2")
+		inline bool
+		PowAvx2(double const* x, double const* y, double* out, size_t count)
+		{
+			__m256d invalid = _mm256_setzero_pd();
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				_mm256_storeu_pd(out + i, Pow(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), invalid));
+			}
+			bool tail = PowSse2(x + i, y + i, out + i, count - i);
+			return (_mm256_movemask_pd(invalid) != 0) || tail;
+		}
+#endif
+
+		inline void
+		Exp(double const* x, double* out, size_t count)
+		{
+#if defined(SFPML_SSE2)
+			static void (* const table[])(double const*, double*, size_t) = { ExpScalar, ExpSse2, ExpAvx2, ExpAvx2 };
+			table[Level()](x, out, count);
+#else
+			ExpScalar(x, out, count);
+#endif
+		}
+
+		inline bool
+		Log(double const* x, double factor, double* out, size_t count)
+		{
+#if defined(SFPML_SSE2)
+			static bool (* const table[])(double const*, double, double*, size_t) = { LogScalar, LogSse2, LogAvx2, LogAvx2 };
+			return table[Level()](x, factor, out, count);
+#else
+			return LogScalar(x, factor, out, count);
+#endif
+		}
+
+		inline bool
+		Pow(double const* x, double const* y, double* out, size_t count)
+		{
+#if defined(SFPML_SSE2)
+			static bool (* const table[])(double const*, double const*, double*, size_t) = { PowScalar, PowSse2, PowAvx2, PowAvx2 };
+			return table[Level()](x, y, out, count);
+#else
+			return PowScalar(x, y, out, count);
+#endif
+		}
+
+		template <typename T>
+		inline void
+		Exp(FixedPoint<T> const* source, FixedPoint<T>* destination, size_t count)
+		{
+			double x[BlockSize];
+			for(size_t i = 0; i < count; i += BlockSize)
+			{
+				size_t n = ((count - i) < BlockSize) ? (count - i) : BlockSize;
+				ToDouble(source + i, x, n);
+				Exp(x, x, n);
+				FromFloating(x, destination + i, n);
+			}
+		}
+
+		template <typename T>
+		inline bool
+		Log(FixedPoint<T> const* source, double factor, FixedPoint<T>* destination, size_t count)
+		{
+			double x[BlockSize];
+			bool invalid = false;
+			for(size_t i = 0; i < count; i += BlockSize)
+			{
+				size_t n = ((count - i) < BlockSize) ? (count - i) : BlockSize;
+				ToDouble(source + i, x, n);
+				invalid |= Log(x, factor, x, n);
+				FromFloating(x, destination + i, n);
+			}
+			return invalid;
+		}
+
+		template <typename T>
+		inline bool
+		Pow(FixedPoint<T> const* base, FixedPoint<T> const* exponent, FixedPoint<T>* destination, size_t count)
+		{
+			double x[BlockSize];
+			double y[BlockSize];
+			bool invalid = false;
+			for(size_t i = 0; i < count; i += BlockSize)
+			{
+				size_t n = ((count - i) < BlockSize) ? (count - i) : BlockSize;
+				ToDouble(base + i, x, n);
+				ToDouble(exponent + i, y, n);
+				invalid |= Pow(x, y, x, n);
+				FromFloating(x, destination + i, n);
+			}
+			return invalid;
+		}
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::Exp(Span<FixedPoint<T> const> source, Span<FixedPoint<T>> destination)
+	{
+		if (source.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::Exp(source.Data(), destination.Data(), source.Size());
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::Log(Span<FixedPoint<T> const> source, Span<FixedPoint<T>> destination, FixedPoint<T> const& base)
+	{
+		if (source.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+		double b = base.ToDouble();
+		if ((b <= 0.0) || (b == 1.0))
+		{
+			throw FPException("Invalid argument");
+		}
+
+		if (kernels::Log(source.Data(), 1.0 / kernels::Log(b), destination.Data(), source.Size()))
+		{
+			throw FPException("Invalid argument");
+		}
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::Log2(Span<FixedPoint<T> const> source, Span<FixedPoint<T>> destination)
+	{
+		if (source.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		if (kernels::Log(source.Data(), kernels::Log2E, destination.Data(), source.Size()))
+		{
+			throw FPException("Invalid argument");
+		}
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::Pow(Span<FixedPoint<T> const> base, Span<FixedPoint<T> const> exponent, Span<FixedPoint<T>> destination)
+	{
+		if ((base.Size() != exponent.Size()) || (base.Size() != destination.Size()))
+		{
+			throw FPException("Invalid size");
+		}
+
+		if (kernels::Pow(base.Data(), exponent.Data(), destination.Data(), base.Size()))
+		{
+			throw FPException("Invalid argument");
+		}
+	}
+
+	// Bulk square root and reciprocal square root
+	// Bit exact with Sqrt (and with 1 / Sqrt for RSqrt): the lanes run the same
+	// Babylonian iteration, with the fixed iteration count of Sqrt (one per bit of
+	// the number) and the same initial guesses, and every step of operator/ is
+	// reproduced on the magnitudes. The magnitudes (integers below 2^32) are held in
+	// double lanes, where the integer quotients are exact (floor of the rounded
+	// quotient) and the wrap around of the Whole type is a floor by a power of two.
+	// Q32.32 magnitudes need 64 bit quotients: that type runs the scalar code.
+	// Negative inputs (and zero for RSqrt) give 0 and are reported once the whole
+	// span has been computed.
+
+	namespace kernels
+	{
+		const unsigned InvalidArgumentFlag = 1;
+		const unsigned DivisionByZeroFlag = 2;
+
+		template <typename T>
+		inline unsigned
+		SqrtScalar(FixedPoint<T> const* source, FixedPoint<T>* destination, size_t count, bool reciprocal)
+		{
+			unsigned errors = 0;
+			for(size_t i = 0; i < count; i++)
+			{
+				if (FixedPoint<T>::IsNegative(source[i]))
+				{
+					errors |= InvalidArgumentFlag;
+					destination[i] = FixedPoint<T>();
+					continue;
+				}
+
+				FixedPoint<T> root = FixedPoint<T>::Sqrt(source[i]);
+				if (reciprocal)
+				{
+					if (static_cast<T>(root) == 0)
+					{
+						errors |= DivisionByZeroFlag;
+						destination[i] = FixedPoint<T>();
+						continue;
+					}
+					root = FixedPoint<T>(false, 1, 0) / root;
+				}
+				destination[i] = root;
+			}
+			return errors;
+		}
+
+		template <typename T>
+		inline unsigned
+		Sqrt(FixedPoint<T> const* source, FixedPoint<T>* destination, size_t count, bool reciprocal)
+		{
+			return SqrtScalar(source, destination, count, reciprocal);
+		}
+
+#if defined(SFPML_SSE2)
+		// floor(y) for 0 <= y < 2^51
+		inline __m128d
+		FloorPositive(__m128d y)
+		{
+			const __m128d two52 = _mm_set1_pd(4503599627370496.0);
+			__m128d integral = _mm_sub_pd(_mm_add_pd(y, two52), two52);
+			return _mm_sub_pd(integral, _mm_and_pd(_mm_cmpgt_pd(integral, y), _mm_set1_pd(1.0)));
+		}
+
+		inline __m128d
+		Select(__m128d mask, __m128d a, __m128d b)
+		{
+			return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+		}
+
+		// Integer quotient of magnitudes below 2^32 (b >= 1)
+		inline __m128d
+		Quotient(__m128d a, __m128d b)
+		{
+			return FloorPositive(_mm_div_pd(a, b));
+		}
+
+		// Magnitude reduced modulo 2^(2 * F) (overflow of the Whole type)
+		template <int F>
+		inline __m128d
+		Wrap(__m128d v)
+		{
+			const __m128d whole = _mm_set1_pd(static_cast<double>(1ull << (2 * F)));
+			return _mm_sub_pd(v, _mm_mul_pd(FloorPositive(_mm_mul_pd(v, _mm_set1_pd(1.0 / static_cast<double>(1ull << (2 * F))))), whole));
+		}
+
+		// operator/ of two positive magnitudes (x != 0)
+		template <int F>
+		inline __m128d
+		DivideMagnitudes(__m128d s, __m128d x)
+		{
+			const __m128d zero = _mm_setzero_pd();
+			const __m128d one = _mm_set1_pd(1.0);
+			const __m128d scale = _mm_set1_pd(static_cast<double>(1u << F));
+			const __m128d inverseScale = _mm_set1_pd(1.0 / static_cast<double>(1u << F));
+
+			// Split of the divisor: a = integer part, b = fractional part or (x / a) / 2
+			__m128d a = FloorPositive(_mm_mul_pd(x, inverseScale));
+			__m128d noInteger = _mm_cmpeq_pd(a, zero);
+			__m128d noFractional = _mm_cmpeq_pd(_mm_sub_pd(x, _mm_mul_pd(a, scale)), zero);
+			__m128d aSafe = Select(noInteger, one, a);
+			__m128d b = FloorPositive(_mm_mul_pd(Quotient(x, aSafe), _mm_set1_pd(0.5)));
+			b = Select(noInteger, x, _mm_andnot_pd(noFractional, b));
+			__m128d noB = _mm_cmpeq_pd(b, zero);
+			__m128d bSafe = Select(noB, one, b);
+
+			__m128d n = Select(_mm_or_pd(noInteger, noB), s, FloorPositive(_mm_mul_pd(s, _mm_set1_pd(0.5))));
+			__m128d nInteger = FloorPositive(_mm_mul_pd(n, inverseScale));
+			__m128d part1 = _mm_mul_pd(nInteger, scale);
+			__m128d part2 = _mm_mul_pd(_mm_sub_pd(n, part1), scale);
+
+			__m128d q = Quotient(part1, bSafe);
+			__m128d r = Quotient(Wrap<F>(_mm_mul_pd(_mm_sub_pd(part1, _mm_mul_pd(q, bSafe)), scale)), bSafe);
+			part1 = Select(noB, part1, Wrap<F>(_mm_add_pd(Wrap<F>(_mm_mul_pd(q, scale)), r)));
+			part2 = Select(noB, part2, Quotient(part2, bSafe));
+
+			__m128d p2 = Quotient(part2, aSafe);
+			part1 = Select(noInteger, part1, Quotient(part1, aSafe));
+			part2 = Select(noInteger, part2, Select(noB, FloorPositive(_mm_mul_pd(p2, inverseScale)), p2));
+			return Wrap<F>(_mm_add_pd(part1, part2));
+		}
+
+		// Sqrt of positive magnitudes
+		template <int F>
+		inline __m128d
+		SqrtMagnitudes(__m128d s)
+		{
+			const __m128d zero = _mm_setzero_pd();
+			const double limits[] = { 10.0, 100.0, 1000.0, 10000.0, 100000.0 };
+			const double guesses[] = { 2.0, 7.0, 20.0, 70.0, 200.0, 700.0 };
+
+			__m128d integer = FloorPositive(_mm_mul_pd(s, _mm_set1_pd(1.0 / static_cast<double>(1u << F))));
+			__m128d guess = _mm_set1_pd(guesses[5]);
+			for(int i = 4; i >= 0; i--)
+			{
+				guess = Select(_mm_cmple_pd(integer, _mm_set1_pd(limits[i])), _mm_set1_pd(guesses[i]), guess);
+			}
+
+			// Once every lane repeats the value before the last one (fixed point or
+			// 2-cycle), the result after the remaining iterations is known.
+			__m128d x = _mm_mul_pd(guess, _mm_set1_pd(static_cast<double>(1u << F)));
+			__m128d previous = _mm_set1_pd(-1.0);
+			for(int i = 0; i < (2 * F); i++)
+			{
+				__m128d stopped = _mm_cmpeq_pd(x, zero);
+				__m128d next = FloorPositive(_mm_mul_pd(Wrap<F>(_mm_add_pd(x, DivideMagnitudes<F>(s, Select(stopped, _mm_set1_pd(1.0), x)))), _mm_set1_pd(0.5)));
+				next = _mm_andnot_pd(stopped, next);
+				if (_mm_movemask_pd(_mm_cmpeq_pd(next, previous)) == 0x3)
+				{
+					return (((2 * F) - i) & 1) ? next : x;
+				}
+				previous = x;
+				x = next;
+			}
+			return x;
+		}
+
+		// Sqrt (or 1 / Sqrt) of the magnitudes value * 2^F; the negative lanes give 0.
+		// Only the lanes of the mask lanes update the error masks.
+		template <int F>
+		inline __m128d
+		SqrtLanes(__m128d value, bool reciprocal, __m128d lanes, __m128d& invalid, __m128d& divisionByZero)
+		{
+			const __m128d zero = _mm_setzero_pd();
+
+			// Sign bit of each lane broadcast to the whole lane (-0.0 included)
+			__m128d negative = _mm_castsi128_pd(_mm_shuffle_epi32(_mm_srai_epi32(_mm_castpd_si128(value), 31), _MM_SHUFFLE(3, 3, 1, 1)));
+			invalid = _mm_or_pd(invalid, _mm_and_pd(negative, lanes));
+			__m128d root = SqrtMagnitudes<F>(_mm_andnot_pd(negative, value));
+			if (reciprocal)
+			{
+				__m128d isZero = _mm_andnot_pd(negative, _mm_cmpeq_pd(root, zero));
+				divisionByZero = _mm_or_pd(divisionByZero, _mm_and_pd(isZero, lanes));
+				root = _mm_andnot_pd(isZero, DivideMagnitudes<F>(_mm_set1_pd(static_cast<double>(1u << F)), Select(isZero, _mm_set1_pd(1.0), root)));
+			}
+			return _mm_andnot_pd(negative, root);
+		}
+
+		inline unsigned
+		ErrorFlags(int invalid, int divisionByZero)
+		{
+			return (invalid ? InvalidArgumentFlag : 0) | (divisionByZero ? DivisionByZeroFlag : 0);
+		}
+
+		template <typename T>
+		inline unsigned
+		SqrtSse2(FixedPoint<T> const* source, FixedPoint<T>* destination, size_t count, bool reciprocal)
+		{
+			const int F = sizeof(typename FixedPoint<T>::FractionalPart) * 8;
+			const __m128d scale = _mm_set1_pd(static_cast<double>(1u << F));
+			const __m128d inverseScale = _mm_set1_pd(1.0 / static_cast<double>(1u << F));
+			const __m128d allLanes = _mm_castsi128_pd(_mm_set1_epi32(-1));
+			__m128d invalid = _mm_setzero_pd();
+			__m128d divisionByZero = _mm_setzero_pd();
+			double x[BlockSize];
+			for(size_t i = 0; i < count; i += BlockSize)
+			{
+				size_t n = ((count - i) < BlockSize) ? (count - i) : BlockSize;
+				ToDouble(source + i, x, n);
+				size_t j = 0;
+				for(; (j + 2) <= n; j += 2)
+				{
+					__m128d root = SqrtLanes<F>(_mm_mul_pd(_mm_loadu_pd(x + j), scale), reciprocal, allLanes, invalid, divisionByZero);
+					_mm_storeu_pd(x + j, _mm_mul_pd(root, inverseScale));
+				}
+				if (j < n)
+				{
+					__m128d root = SqrtLanes<F>(_mm_mul_pd(_mm_load_sd(x + j), scale), reciprocal, _mm_move_sd(_mm_setzero_pd(), allLanes), invalid, divisionByZero);
+					_mm_store_sd(x + j, _mm_mul_pd(root, inverseScale));
+				}
+				FromFloating(x, destination + i, n);
+			}
+			return ErrorFlags(_mm_movemask_pd(invalid), _mm_movemask_pd(divisionByZero));
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256d
+		Select(__m256d mask, __m256d a, __m256d b)
+		{
+			return _mm256_blendv_pd(b, a, mask);
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256d
+		Quotient(__m256d a, __m256d b)
+		{
+			return _mm256_floor_pd(_mm256_div_pd(a, b));
+		}
+
+		template <int F>
+		SFPML_TARGET("avx2")
+		inline __m256d
+		Wrap(__m256d v)
+		{
+			const __m256d whole = _mm256_set1_pd(static_cast<double>(1ull << (2 * F)));
+			return _mm256_sub_pd(v, _mm256_mul_pd(_mm256_floor_pd(_mm256_mul_pd(v, _mm256_set1_pd(1.0 / static_cast<double>(1ull << (2 * F))))), whole));
+		}
+
+		template <int F>
+		SFPML_TARGET("avx2")
+		inline __m256d
+		DivideMagnitudes(__m256d s, __m256d x)
+		{
+			const __m256d zero = _mm256_setzero_pd();
+			const __m256d one = _mm256_set1_pd(1.0);
+			const __m256d scale = _mm256_set1_pd(static_cast<double>(1u << F));
+			const __m256d inverseScale = _mm256_set1_pd(1.0 / static_cast<double>(1u << F));
+
+			__m256d a = _mm256_floor_pd(_mm256_mul_pd(x, inverseScale));
+			__m256d noInteger = _mm256_cmp_pd(a, zero, _CMP_EQ_OQ);
+			__m256d noFractional = _mm256_cmp_pd(_mm256_sub_pd(x, _mm256_mul_pd(a, scale)), zero, _CMP_EQ_OQ);
+			__m256d aSafe = Select(noInteger, one, a);
+			__m256d b = _mm256_floor_pd(_mm256_mul_pd(Quotient(x, aSafe), _mm256_set1_pd(0.5)));
+			b = Select(noInteger, x, _mm256_andnot_pd(noFractional, b));
+			__m256d noB = _mm256_cmp_pd(b, zero, _CMP_EQ_OQ);
+			__m256d bSafe = Select(noB, one, b);
+
+			__m256d n = Select(_mm256_or_pd(noInteger, noB), s, _mm256_floor_pd(_mm256_mul_pd(s, _mm256_set1_pd(0.5))));
+			__m256d nInteger = _mm256_floor_pd(_mm256_mul_pd(n, inverseScale));
+			__m256d part1 = _mm256_mul_pd(nInteger, scale);
+			__m256d part2 = _mm256_mul_pd(_mm256_sub_pd(n, part1), scale);
+
+			__m256d q = Quotient(part1, bSafe);
+			__m256d r = Quotient(Wrap<F>(_mm256_mul_pd(_mm256_sub_pd(part1, _mm256_mul_pd(q, bSafe)), scale)), bSafe);
+			part1 = Select(noB, part1, Wrap<F>(_mm256_add_pd(Wrap<F>(_mm256_mul_pd(q, scale)), r)));
+			part2 = Select(noB, part2, Quotient(part2, bSafe));
+
+			__m256d p2 = Quotient(part2, aSafe);
+			part1 = Select(noInteger, part1, Quotient(part1, aSafe));
+			part2 = Select(noInteger, part2, Select(noB, _mm256_floor_pd(_mm256_mul_pd(p2, inverseScale)), p2));
+			return Wrap<F>(_mm256_add_pd(part1, part2));
+		}
+
+		template <int F>
+		SFPML_TARGET("avx2")
+		inline __m256d
+		SqrtMagnitudes(__m256d s)
+		{
+			const __m256d zero = _mm256_setzero_pd();
+			const double limits[] = { 10.0, 100.0, 1000.0, 10000.0, 100000.0 };
+			const double guesses[] = { 2.0, 7.0, 20.0, 70.0, 200.0, 700.0 };
+
+			__m256d integer = _mm256_floor_pd(_mm256_mul_pd(s, _mm256_set1_pd(1.0 / static_cast<double>(1u << F))));
+			__m256d guess = _mm256_set1_pd(guesses[5]);
+			for(int i = 4; i >= 0; i--)
+			{
+				guess = Select(_mm256_cmp_pd(integer, _mm256_set1_pd(limits[i]), _CMP_LE_OQ), _mm256_set1_pd(guesses[i]), guess);
+			}
+
+			__m256d x = _mm256_mul_pd(guess, _mm256_set1_pd(static_cast<double>(1u << F)));
+			__m256d previous = _mm256_set1_pd(-1.0);
+			for(int i = 0; i < (2 * F); i++)
+			{
+				__m256d stopped = _mm256_cmp_pd(x, zero, _CMP_EQ_OQ);
+				__m256d next = _mm256_floor_pd(_mm256_mul_pd(Wrap<F>(_mm256_add_pd(x, DivideMagnitudes<F>(s, Select(stopped, _mm256_set1_pd(1.0), x)))), _mm256_set1_pd(0.5)));
+				next = _mm256_andnot_pd(stopped, next);
+				if (_mm256_movemask_pd(_mm256_cmp_pd(next, previous, _CMP_EQ_OQ)) == 0xF)
+				{
+					return (((2 * F) - i) & 1) ? next : x;
+				}
+				previous = x;
+				x = next;
+			}
+			return x;
+		}
+
+		template <typename T>
+		SFPML_TARGET("avx2")
+		inline unsigned
+		SqrtAvx2(FixedPoint<T> const* source, FixedPoint<T>* destination, size_t count, bool reciprocal)
+		{
+			const int F = sizeof(typename FixedPoint<T>::FractionalPart) * 8;
+			const __m256d zero = _mm256_setzero_pd();
+			const __m256d scale = _mm256_set1_pd(static_cast<double>(1u << F));
+			const __m256d inverseScale = _mm256_set1_pd(1.0 / static_cast<double>(1u << F));
+			__m256d invalid = zero;
+			__m256d divisionByZero = zero;
+			unsigned errors = 0;
+			double x[BlockSize];
+			for(size_t i = 0; i < count; i += BlockSize)
+			{
+				size_t n = ((count - i) < BlockSize) ? (count - i) : BlockSize;
+				ToDouble(source + i, x, n);
+				size_t j = 0;
+				for(; (j + 4) <= n; j += 4)
+				{
+					__m256d value = _mm256_mul_pd(_mm256_loadu_pd(x + j), scale);
+					__m256d negative = _mm256_castsi256_pd(_mm256_shuffle_epi32(_mm256_srai_epi32(_mm256_castpd_si256(value), 31), _MM_SHUFFLE(3, 3, 1, 1)));
+					invalid = _mm256_or_pd(invalid, negative);
+					__m256d root = SqrtMagnitudes<F>(_mm256_andnot_pd(negative, value));
+					if (reciprocal)
+					{
+						__m256d isZero = _mm256_andnot_pd(negative, _mm256_cmp_pd(root, zero, _CMP_EQ_OQ));
+						divisionByZero = _mm256_or_pd(divisionByZero, isZero);
+						root = _mm256_andnot_pd(isZero, DivideMagnitudes<F>(scale, Select(isZero, _mm256_set1_pd(1.0), root)));
+					}
+					_mm256_storeu_pd(x + j, _mm256_mul_pd(_mm256_andnot_pd(negative, root), inverseScale));
+				}
+				FromFloating(x, destination + i, j);
+				errors |= SqrtSse2(source + i + j, destination + i + j, n - j, reciprocal);
+			}
+			return errors | ErrorFlags(_mm256_movemask_pd(invalid), _mm256_movemask_pd(divisionByZero));
+		}
+
+		inline unsigned
+		Sqrt(FixedPointSmall const* source, FixedPointSmall* destination, size_t count, bool reciprocal)
+		{
+			static unsigned (* const table[])(FixedPointSmall const*, FixedPointSmall*, size_t, bool) = { SqrtScalar<uint16_t>, SqrtSse2<uint16_t>, SqrtAvx2<uint16_t>, SqrtAvx2<uint16_t> };
+			return table[Level()](source, destination, count, reciprocal);
+		}
+
+		inline unsigned
+		Sqrt(FixedPointMedium const* source, FixedPointMedium* destination, size_t count, bool reciprocal)
+		{
+			static unsigned (* const table[])(FixedPointMedium const*, FixedPointMedium*, size_t, bool) = { SqrtScalar<uint32_t>, SqrtSse2<uint32_t>, SqrtAvx2<uint32_t>, SqrtAvx2<uint32_t> };
+			return table[Level()](source, destination, count, reciprocal);
+		}
+#endif
+
+		inline void
+		ThrowErrors(unsigned errors)
+		{
+			if (errors & InvalidArgumentFlag)
+			{
+				throw FPException("Invalid argument");
+			}
+			if (errors & DivisionByZeroFlag)
+			{
+				throw FPException("Division by zero");
+			}
+		}
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::Sqrt(Span<FixedPoint<T> const> source, Span<FixedPoint<T>> destination)
+	{
+		if (source.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::ThrowErrors(kernels::Sqrt(source.Data(), destination.Data(), source.Size(), false));
+	}
+
+	template <typename T>
+	void
+	FixedPoint<T>::RSqrt(Span<FixedPoint<T> const> source, Span<FixedPoint<T>> destination)
+	{
+		if (source.Size() != destination.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::ThrowErrors(kernels::Sqrt(source.Data(), destination.Data(), source.Size(), true));
+	}
+
+	// Aligned memory blocks for the containers processed by SIMD kernels
+	// The address returned by operator new is stored just before the aligned block.
+
+	inline void*
+	AlignedAllocate(size_t bytes, size_t alignment)
+	{
+		if (bytes > (std::numeric_limits<size_t>::max() - alignment - sizeof(void*)))
+		{
+			throw FPException("Invalid size");
+		}
+
+		void* block = ::operator new(bytes + alignment + sizeof(void*));
+		uintptr_t aligned = (reinterpret_cast<uintptr_t>(block) + sizeof(void*) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+		reinterpret_cast<void**>(aligned)[-1] = block;
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	inline void
+	AlignedFree(void* aligned)
+	{
+		if (aligned)
+		{
+			::operator delete(reinterpret_cast<void**>(aligned)[-1]);
+		}
+	}
+
+	// Element-wise kernels of FixedPointArray
+	// The values are raw two's complement Q numbers (int16_t Q8.8, int32_t Q16.16,
+	// int64_t Q32.32) and every operation saturates to the range of the raw type.
+	// Multiply and MultiplyAccumulate (accumulator + a * b, saturated once) round
+	// to nearest (ties toward +infinity), Divide truncates toward zero and a zero
+	// divisor gives the largest value with the sign of the dividend.
+	// The SIMD kernels give exactly the same results as the scalar ones.
+
+	namespace kernels
+	{
+		enum class ArrayOperation
+		{
+			Add,
+			Subtract,
+			Multiply,
+			Min,
+			Max
+		};
+
+		template <typename R, typename W>
+		inline R
+		Saturate(W value)
+		{
+			if (value > static_cast<W>(std::numeric_limits<R>::max()))
+			{
+				return std::numeric_limits<R>::max();
+			}
+			if (value < static_cast<W>(std::numeric_limits<R>::min()))
+			{
+				return std::numeric_limits<R>::min();
+			}
+
+			return static_cast<R>(value);
+		}
+
+		template <typename R>
+		inline R
+		SaturatingAdd(R a, R b)
+		{
+			using U = typename std::make_unsigned<R>::type;
+			R sum = static_cast<R>(static_cast<U>(a) + static_cast<U>(b));
+			if (((a ^ sum) & (b ^ sum)) < 0)
+			{
+				return (a < 0) ? std::numeric_limits<R>::min() : std::numeric_limits<R>::max();
+			}
+
+			return sum;
+		}
+
+		template <typename R>
+		inline R
+		SaturatingSubtract(R a, R b)
+		{
+			using U = typename std::make_unsigned<R>::type;
+			R difference = static_cast<R>(static_cast<U>(a) - static_cast<U>(b));
+			if (((a ^ b) & (a ^ difference)) < 0)
+			{
+				return (a < 0) ? std::numeric_limits<R>::min() : std::numeric_limits<R>::max();
+			}
+
+			return difference;
+		}
+
+		template <typename R>
+		inline R
+		SaturatingAbs(R a)
+		{
+			if (a == std::numeric_limits<R>::min())
+			{
+				return std::numeric_limits<R>::max();
+			}
+
+			return (a < 0) ? static_cast<R>(-a) : a;
+		}
+
+		template <typename R>
+		inline R
+		DivisionByZero(R a)
+		{
+			if (a == 0)
+			{
+				return 0;
+			}
+
+			return (a < 0) ? std::numeric_limits<R>::min() : std::numeric_limits<R>::max();
+		}
+
+		// Full 64 x 64 => 128 bits unsigned product
+		inline void
+		MultiplyWide(uint64_t a, uint64_t b, uint64_t& high, uint64_t& low)
+		{
+			uint64_t p0 = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+			uint64_t p1 = (a & 0xFFFFFFFF) * (b >> 32);
+			uint64_t p2 = (a >> 32) * (b & 0xFFFFFFFF);
+			uint64_t p3 = (a >> 32) * (b >> 32);
+			uint64_t middle = (p0 >> 32) + (p1 & 0xFFFFFFFF) + (p2 & 0xFFFFFFFF);
+
+			low = (middle << 32) | (p0 & 0xFFFFFFFF);
+			high = p3 + (p1 >> 32) + (p2 >> 32) + (middle >> 32);
+		}
+
+		// Signed 128 bits product (the unsigned one corrected by the operand signs)
+		inline void
+		MultiplyWide(int64_t a, int64_t b, uint64_t& high, uint64_t& low)
+		{
+			MultiplyWide(static_cast<uint64_t>(a), static_cast<uint64_t>(b), high, low);
+			high -= (a < 0) ? static_cast<uint64_t>(b) : 0;
+			high -= (b < 0) ? static_cast<uint64_t>(a) : 0;
+		}
+
+		// Rounds a signed 128 bits Q64.64 value to Q32.32 (ties toward +infinity), saturated
+		inline int64_t
+		RoundWide(uint64_t high, uint64_t low)
+		{
+			uint64_t rounded = low + (1ull << 31);
+			high += (rounded < low) ? 1 : 0;
+			int64_t top = static_cast<int64_t>(high);
+			if (top >= (1ll << 31))
+			{
+				return std::numeric_limits<int64_t>::max();
+			}
+			if (top < -(1ll << 31))
+			{
+				return std::numeric_limits<int64_t>::min();
+			}
+
+			return static_cast<int64_t>((high << 32) | (rounded >> 32));
+		}
+
+		inline int16_t
+		Multiply(int16_t a, int16_t b)
+		{
+			return Saturate<int16_t>(((static_cast<int32_t>(a) * b) + (1 << 7)) >> 8);
+		}
+
+		inline int32_t
+		Multiply(int32_t a, int32_t b)
+		{
+			return Saturate<int32_t>(((static_cast<int64_t>(a) * b) + (1 << 15)) >> 16);
+		}
+
+		inline int64_t
+		Multiply(int64_t a, int64_t b)
+		{
+			uint64_t low;
+			uint64_t high;
+			MultiplyWide(a, b, high, low);
+			return RoundWide(high, low);
+		}
+
+		// accumulator + a * b, rounded and saturated once (the product is not saturated on its own)
+
+		inline int16_t
+		MultiplyAccumulate(int16_t a, int16_t b, int16_t accumulator)
+		{
+			return Saturate<int16_t>(((static_cast<int32_t>(a) * b) + (static_cast<int32_t>(accumulator) * 256) + (1 << 7)) >> 8);
+		}
+
+		inline int32_t
+		MultiplyAccumulate(int32_t a, int32_t b, int32_t accumulator)
+		{
+			return Saturate<int32_t>(((static_cast<int64_t>(a) * b) + (static_cast<int64_t>(accumulator) * 65536) + (1 << 15)) >> 16);
+		}
+
+		inline int64_t
+		MultiplyAccumulate(int64_t a, int64_t b, int64_t accumulator)
+		{
+			uint64_t low;
+			uint64_t high;
+			MultiplyWide(a, b, high, low);
+
+			// |a * b| <= 2^126 and |accumulator * 2^32| <= 2^95: the sum cannot overflow
+			uint64_t addend = static_cast<uint64_t>(accumulator) << 32;
+			uint64_t sum = low + addend;
+			high += ((accumulator < 0) ? ~static_cast<uint64_t>(0xFFFFFFFF) : 0) | (static_cast<uint64_t>(accumulator) >> 32);
+			high += (sum < low) ? 1 : 0;
+			return RoundWide(high, sum);
+		}
+
+		inline int16_t
+		Divide(int16_t a, int16_t b)
+		{
+			if (b == 0)
+			{
+				return DivisionByZero(a);
+			}
+
+			return Saturate<int16_t>((static_cast<int32_t>(a) * 256) / b);
+		}
+
+		inline int32_t
+		Divide(int32_t a, int32_t b)
+		{
+			if (b == 0)
+			{
+				return DivisionByZero(a);
+			}
+
+			return Saturate<int32_t>((static_cast<int64_t>(a) * 65536) / b);
+		}
+
+		inline int64_t
+		Divide(int64_t a, int64_t b)
+		{
+			if (b == 0)
+			{
+				return DivisionByZero(a);
+			}
+
+			// |a| * 2^32 / |b|: integer quotient first, then 32 bits of long division
+			uint64_t dividend = (a < 0) ? (0 - static_cast<uint64_t>(a)) : static_cast<uint64_t>(a);
+			uint64_t divisor = (b < 0) ? (0 - static_cast<uint64_t>(b)) : static_cast<uint64_t>(b);
+			uint64_t quotient = dividend / divisor;
+			uint64_t remainder = dividend % divisor;
+			bool negative = (a < 0) != (b < 0);
+			if (quotient >> 32)
+			{
+				return negative ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int64_t>::max();
+			}
+
+			for(int i = 0; i < 32; i++)
+			{
+				remainder <<= 1;
+				quotient <<= 1;
+				if (remainder >= divisor)
+				{
+					remainder -= divisor;
+					quotient |= 1;
+				}
+			}
+
+			const uint64_t limit = 1ull << 63;
+			if (negative)
+			{
+				return (quotient >= limit) ? std::numeric_limits<int64_t>::min() : -static_cast<int64_t>(quotient);
+			}
+
+			return (quotient >= limit) ? std::numeric_limits<int64_t>::max() : static_cast<int64_t>(quotient);
+		}
+
+		// Scalar kernels (reference results and tails of the SIMD kernels)
+
+		template <typename R>
+		inline void
+		BinaryScalar(ArrayOperation operation, R const* a, R const* b, R* out, size_t count)
+		{
+			switch(operation)
+			{
+				case ArrayOperation::Add:
+					for(size_t i = 0; i < count; i++)
+					{
+						out[i] = SaturatingAdd(a[i], b[i]);
+					}
+					break;
+				case ArrayOperation::Subtract:
+					for(size_t i = 0; i < count; i++)
+					{
+						out[i] = SaturatingSubtract(a[i], b[i]);
+					}
+					break;
+				case ArrayOperation::Multiply:
+					for(size_t i = 0; i < count; i++)
+					{
+						out[i] = Multiply(a[i], b[i]);
+					}
+					break;
+				case ArrayOperation::Min:
+					for(size_t i = 0; i < count; i++)
+					{
+						out[i] = (a[i] < b[i]) ? a[i] : b[i];
+					}
+					break;
+				case ArrayOperation::Max:
+					for(size_t i = 0; i < count; i++)
+					{
+						out[i] = (a[i] > b[i]) ? a[i] : b[i];
+					}
+					break;
+			}
+		}
+
+		template <typename R>
+		inline void
+		MultiplyAccumulateScalar(R const* a, R const* b, R* accumulator, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				accumulator[i] = MultiplyAccumulate(a[i], b[i], accumulator[i]);
+			}
+		}
+
+		template <typename R>
+		inline bool
+		DivideScalar(R const* a, R const* b, R* out, size_t count)
+		{
+			bool divisionByZero = false;
+			for(size_t i = 0; i < count; i++)
+			{
+				divisionByZero |= (b[i] == 0);
+				out[i] = Divide(a[i], b[i]);
+			}
+
+			return divisionByZero;
+		}
+
+		template <typename R>
+		inline void
+		AbsScalar(R const* a, R* out, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				out[i] = SaturatingAbs(a[i]);
+			}
+		}
+
+		template <typename R>
+		inline void
+		ClampScalar(R const* a, R low, R high, R* out, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				R value = (a[i] < low) ? low : a[i];
+				out[i] = (value > high) ? high : value;
+			}
+		}
+
+#if defined(SFPML_SSE2)
+		// SSE2 kernels (8 x Q8.8, 4 x Q16.16 lanes; SSE2 has no 64 bits compare
+		// and no signed 32 x 32 => 64 bits multiply, so Q32.32 arrays and the
+		// Q16.16 products use the scalar kernels)
+
+		inline __m128i
+		Select(__m128i mask, __m128i a, __m128i b)
+		{
+			return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+		}
+
+		// Q8.8 products: the 32 bits products come from the low and high halves
+		// (mullo/mulhi), are rounded like mulhrs does, shifted and packed with saturation.
+		// mulhrs itself cannot be used: it rounds at bit 15 (Q0.15), not at bit 8.
+		inline __m128i
+		MultiplyAccumulate16(__m128i x, __m128i y, __m128i accumulator)
+		{
+			const __m128i round = _mm_set1_epi32(1 << 7);
+			__m128i low = _mm_mullo_epi16(x, y);
+			__m128i high = _mm_mulhi_epi16(x, y);
+			__m128i p0 = _mm_add_epi32(_mm_unpacklo_epi16(low, high), round);
+			__m128i p1 = _mm_add_epi32(_mm_unpackhi_epi16(low, high), round);
+			p0 = _mm_add_epi32(p0, _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), accumulator), 8));
+			p1 = _mm_add_epi32(p1, _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), accumulator), 8));
+			return _mm_packs_epi32(_mm_srai_epi32(p0, 8), _mm_srai_epi32(p1, 8));
+		}
+
+		inline __m128i
+		Multiply16(__m128i x, __m128i y)
+		{
+			return MultiplyAccumulate16(x, y, _mm_setzero_si128());
+		}
+
+		// 4 x (n / d) truncated; |n| < 2^24, so the quotient of the doubles truncates
+		// to the exact quotient. Zero divisors give INT32_MIN/INT32_MAX/0.
+		inline __m128i
+		DivideLanes(__m128i n, __m128i d)
+		{
+			__m128i zero = _mm_cmpeq_epi32(d, _mm_setzero_si128());
+			d = _mm_or_si128(d, _mm_and_si128(zero, _mm_set1_epi32(1)));
+			__m128d q0 = _mm_div_pd(_mm_cvtepi32_pd(n), _mm_cvtepi32_pd(d));
+			__m128d q1 = _mm_div_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(n, _MM_SHUFFLE(1, 0, 3, 2))), _mm_cvtepi32_pd(_mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2))));
+			__m128i q = _mm_unpacklo_epi64(_mm_cvttpd_epi32(q0), _mm_cvttpd_epi32(q1));
+			__m128i saturated = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi32(n, _mm_setzero_si128()), _mm_set1_epi32(0x7FFFFFFF)), _mm_and_si128(_mm_cmplt_epi32(n, _mm_setzero_si128()), _mm_set1_epi32(static_cast<int>(0x80000000))));
+			return Select(zero, saturated, q);
+		}
+
+		inline __m128i
+		Divide16(__m128i x, __m128i y)
+		{
+			__m128i n0 = _mm_slli_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16), 8);
+			__m128i n1 = _mm_slli_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16), 8);
+			__m128i d0 = _mm_srai_epi32(_mm_unpacklo_epi16(y, y), 16);
+			__m128i d1 = _mm_srai_epi32(_mm_unpackhi_epi16(y, y), 16);
+			return _mm_packs_epi32(DivideLanes(n0, d0), DivideLanes(n1, d1));
+		}
+
+		inline __m128i
+		SaturatingAdd32(__m128i x, __m128i y)
+		{
+			__m128i sum = _mm_add_epi32(x, y);
+			__m128i overflow = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(x, sum), _mm_xor_si128(y, sum)), 31);
+			__m128i saturated = _mm_xor_si128(_mm_srai_epi32(x, 31), _mm_set1_epi32(0x7FFFFFFF));
+			return Select(overflow, saturated, sum);
+		}
+
+		inline __m128i
+		SaturatingSubtract32(__m128i x, __m128i y)
+		{
+			__m128i difference = _mm_sub_epi32(x, y);
+			__m128i overflow = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(x, y), _mm_xor_si128(x, difference)), 31);
+			__m128i saturated = _mm_xor_si128(_mm_srai_epi32(x, 31), _mm_set1_epi32(0x7FFFFFFF));
+			return Select(overflow, saturated, difference);
+		}
+
+		inline __m128i
+		Min32(__m128i x, __m128i y)
+		{
+			return Select(_mm_cmpgt_epi32(x, y), y, x);
+		}
+
+		inline __m128i
+		Max32(__m128i x, __m128i y)
+		{
+			return Select(_mm_cmpgt_epi32(x, y), x, y);
+		}
+
+		inline __m128i
+		Abs32(__m128i x)
+		{
+			__m128i negative = _mm_srai_epi32(x, 31);
+			__m128i value = _mm_sub_epi32(_mm_xor_si128(x, negative), negative);
+			return _mm_xor_si128(value, _mm_srai_epi32(value, 31));
+		}
+
+		template <ArrayOperation operation>
+		inline __m128i
+		Apply16(__m128i x, __m128i y)
+		{
+			switch(operation)
+			{
+				case ArrayOperation::Add:
+					return _mm_adds_epi16(x, y);
+				case ArrayOperation::Subtract:
+					return _mm_subs_epi16(x, y);
+				case ArrayOperation::Multiply:
+					return Multiply16(x, y);
+				case ArrayOperation::Min:
+					return _mm_min_epi16(x, y);
+				default:
+					return _mm_max_epi16(x, y);
+			}
+		}
+
+		template <ArrayOperation operation>
+		inline __m128i
+		Apply32(__m128i x, __m128i y)
+		{
+			switch(operation)
+			{
+				case ArrayOperation::Add:
+					return SaturatingAdd32(x, y);
+				case ArrayOperation::Subtract:
+					return SaturatingSubtract32(x, y);
+				case ArrayOperation::Min:
+					return Min32(x, y);
+				default:
+					return Max32(x, y);
+			}
+		}
+
+		template <ArrayOperation operation>
+		inline void
+		BinarySse2(int16_t const* a, int16_t const* b, int16_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+				__m128i y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Apply16<operation>(x, y));
+			}
+			BinaryScalar(operation, a + i, b + i, out + i, count - i);
+		}
+
+		template <ArrayOperation operation>
+		inline void
+		BinarySse2(int32_t const* a, int32_t const* b, int32_t* out, size_t count)
+		{
+			size_t i = 0;
+			if (operation != ArrayOperation::Multiply)
+			{
+				for(; (i + 4) <= count; i += 4)
+				{
+					__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+					__m128i y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Apply32<operation>(x, y));
+				}
+			}
+			BinaryScalar(operation, a + i, b + i, out + i, count - i);
+		}
+
+		template <ArrayOperation operation>
+		inline void
+		BinarySse2(int64_t const* a, int64_t const* b, int64_t* out, size_t count)
+		{
+			BinaryScalar(operation, a, b, out, count);
+		}
+
+		inline void
+		MultiplyAccumulateSse2(int16_t const* a, int16_t const* b, int16_t* accumulator, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+				__m128i y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+				__m128i z = _mm_loadu_si128(reinterpret_cast<__m128i const*>(accumulator + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(accumulator + i), MultiplyAccumulate16(x, y, z));
+			}
+			MultiplyAccumulateScalar(a + i, b + i, accumulator + i, count - i);
+		}
+
+		template <typename R>
+		inline void
+		MultiplyAccumulateSse2(R const* a, R const* b, R* accumulator, size_t count)
+		{
+			MultiplyAccumulateScalar(a, b, accumulator, count);
+		}
+
+		inline bool
+		DivideSse2(int16_t const* a, int16_t const* b, int16_t* out, size_t count)
+		{
+			__m128i zero = _mm_setzero_si128();
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+				__m128i y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+				zero = _mm_or_si128(zero, _mm_cmpeq_epi16(y, _mm_setzero_si128()));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Divide16(x, y));
+			}
+
+			return DivideScalar(a + i, b + i, out + i, count - i) || (_mm_movemask_epi8(zero) != 0);
+		}
+
+		template <typename R>
+		inline bool
+		DivideSse2(R const* a, R const* b, R* out, size_t count)
+		{
+			return DivideScalar(a, b, out, count);
+		}
+
+		inline void
+		AbsSse2(int16_t const* a, int16_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_max_epi16(x, _mm_subs_epi16(_mm_setzero_si128(), x)));
+			}
+			AbsScalar(a + i, out + i, count - i);
+		}
+
+		inline void
+		AbsSse2(int32_t const* a, int32_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Abs32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i))));
+			}
+			AbsScalar(a + i, out + i, count - i);
+		}
+
+		inline void
+		AbsSse2(int64_t const* a, int64_t* out, size_t count)
+		{
+			AbsScalar(a, out, count);
+		}
+
+		inline void
+		ClampSse2(int16_t const* a, int16_t low, int16_t high, int16_t* out, size_t count)
+		{
+			const __m128i lowVector = _mm_set1_epi16(low);
+			const __m128i highVector = _mm_set1_epi16(high);
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_min_epi16(_mm_max_epi16(x, lowVector), highVector));
+			}
+			ClampScalar(a + i, low, high, out + i, count - i);
+		}
+
+		inline void
+		ClampSse2(int32_t const* a, int32_t low, int32_t high, int32_t* out, size_t count)
+		{
+			const __m128i lowVector = _mm_set1_epi32(low);
+			const __m128i highVector = _mm_set1_epi32(high);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Min32(Max32(x, lowVector), highVector));
+			}
+			ClampScalar(a + i, low, high, out + i, count - i);
+		}
+
+		inline void
+		ClampSse2(int64_t const* a, int64_t low, int64_t high, int64_t* out, size_t count)
+		{
+			ClampScalar(a, low, high, out, count);
+		}
+#endif
+
+#if defined(SFPML_SSE2)
+		// AVX2 kernels (16 x Q8.8, 8 x Q16.16, 4 x Q32.32 lanes)
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		MultiplyAccumulate16(__m256i x, __m256i y, __m256i accumulator)
+		{
+			const __m256i round = _mm256_set1_epi32(1 << 7);
+			__m256i low = _mm256_mullo_epi16(x, y);
+			__m256i high = _mm256_mulhi_epi16(x, y);
+			__m256i p0 = _mm256_add_epi32(_mm256_unpacklo_epi16(low, high), round);
+			__m256i p1 = _mm256_add_epi32(_mm256_unpackhi_epi16(low, high), round);
+			p0 = _mm256_add_epi32(p0, _mm256_srai_epi32(_mm256_unpacklo_epi16(_mm256_setzero_si256(), accumulator), 8));
+			p1 = _mm256_add_epi32(p1, _mm256_srai_epi32(_mm256_unpackhi_epi16(_mm256_setzero_si256(), accumulator), 8));
+			return _mm256_packs_epi32(_mm256_srai_epi32(p0, 8), _mm256_srai_epi32(p1, 8));
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Multiply16(__m256i x, __m256i y)
+		{
+			return MultiplyAccumulate16(x, y, _mm256_setzero_si256());
+		}
+
+		// Rounds 4 x 64 bits Q32.32 values (plus the rounding term) to Q16.16 and
+		// saturates them; the results are in the low halves of the 64 bits lanes.
+		// AVX2 has no 64 bits arithmetic shift: the logical one gives the same
+		// low 32 bits and the range is checked on the 64 bits values.
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Narrow32(__m256i sum)
+		{
+			const __m256i maximum = _mm256_set1_epi64x((1ll << 47) - 1);
+			const __m256i minimum = _mm256_set1_epi64x(-(1ll << 47));
+			__m256i value = _mm256_srli_epi64(sum, 16);
+			value = _mm256_blendv_epi8(value, _mm256_set1_epi64x(0x7FFFFFFF), _mm256_cmpgt_epi64(sum, maximum));
+			return _mm256_blendv_epi8(value, _mm256_set1_epi64x(0x80000000), _mm256_cmpgt_epi64(minimum, sum));
+		}
+
+		// Q16.16 products: _mm256_mul_epi32 multiplies the even lanes (32 x 32 => 64 bits),
+		// the odd lanes are shifted down and multiplied the same way.
+		SFPML_TARGET("avx2")
+		inline __m256i
+		MultiplyAccumulate32(__m256i x, __m256i y, __m256i accumulator)
+		{
+			const __m256i round = _mm256_set1_epi64x(1 << 15);
+			const __m256i scale = _mm256_set1_epi64x(1 << 16);
+			__m256i even = _mm256_add_epi64(_mm256_mul_epi32(x, y), _mm256_mul_epi32(accumulator, scale));
+			__m256i odd = _mm256_add_epi64(_mm256_mul_epi32(_mm256_srli_epi64(x, 32), _mm256_srli_epi64(y, 32)), _mm256_mul_epi32(_mm256_srli_epi64(accumulator, 32), scale));
+			even = Narrow32(_mm256_add_epi64(even, round));
+			odd = Narrow32(_mm256_add_epi64(odd, round));
+			return _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Multiply32(__m256i x, __m256i y)
+		{
+			return MultiplyAccumulate32(x, y, _mm256_setzero_si256());
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		DivideLanes(__m256i n, __m256i d)
+		{
+			__m256i zero = _mm256_cmpeq_epi32(d, _mm256_setzero_si256());
+			d = _mm256_or_si256(d, _mm256_and_si256(zero, _mm256_set1_epi32(1)));
+			__m256d q0 = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(n)), _mm256_cvtepi32_pd(_mm256_castsi256_si128(d)));
+			__m256d q1 = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(n, 1)), _mm256_cvtepi32_pd(_mm256_extracti128_si256(d, 1)));
+			__m256i q = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(q0)), _mm256_cvttpd_epi32(q1), 1);
+			__m256i saturated = _mm256_or_si256(_mm256_and_si256(_mm256_cmpgt_epi32(n, _mm256_setzero_si256()), _mm256_set1_epi32(0x7FFFFFFF)), _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), n), _mm256_set1_epi32(static_cast<int>(0x80000000))));
+			return _mm256_blendv_epi8(q, saturated, zero);
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Divide16(__m256i x, __m256i y)
+		{
+			__m256i n0 = _mm256_slli_epi32(_mm256_srai_epi32(_mm256_unpacklo_epi16(x, x), 16), 8);
+			__m256i n1 = _mm256_slli_epi32(_mm256_srai_epi32(_mm256_unpackhi_epi16(x, x), 16), 8);
+			__m256i d0 = _mm256_srai_epi32(_mm256_unpacklo_epi16(y, y), 16);
+			__m256i d1 = _mm256_srai_epi32(_mm256_unpackhi_epi16(y, y), 16);
+			return _mm256_packs_epi32(DivideLanes(n0, d0), DivideLanes(n1, d1));
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Negative64(__m256i x)
+		{
+			return _mm256_cmpgt_epi64(_mm256_setzero_si256(), x);
+		}
+
+		// 4 x Q16.16 quotients: the quotient of the doubles is truncated, then
+		// corrected by one unit when the 64 bits remainder is out of range.
+		SFPML_TARGET("avx2")
+		inline __m128i
+		Divide32(__m128i x, __m128i y)
+		{
+			__m128i zero = _mm_cmpeq_epi32(y, _mm_setzero_si128());
+			y = _mm_or_si128(y, _mm_and_si128(zero, _mm_set1_epi32(1)));
+
+			__m256d q = _mm256_div_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(x), _mm256_set1_pd(65536.0)), _mm256_cvtepi32_pd(y));
+			q = _mm256_round_pd(q, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+			__m256i saturated = _mm256_castpd_si256(_mm256_or_pd(_mm256_cmp_pd(q, _mm256_set1_pd(2147483647.0), _CMP_GT_OQ), _mm256_cmp_pd(q, _mm256_set1_pd(-2147483648.0), _CMP_LT_OQ)));
+			q = _mm256_min_pd(_mm256_max_pd(q, _mm256_set1_pd(-2147483648.0)), _mm256_set1_pd(2147483647.0));
+			__m256i quotient = _mm256_cvtepi32_epi64(_mm256_cvttpd_epi32(q));
+
+			__m256i n = _mm256_slli_epi64(_mm256_cvtepi32_epi64(x), 16);
+			__m256i d = _mm256_cvtepi32_epi64(y);
+			__m256i remainder = _mm256_sub_epi64(n, _mm256_mul_epi32(quotient, d));
+			__m256i negativeN = Negative64(n);
+			__m256i negativeD = Negative64(d);
+			remainder = _mm256_sub_epi64(_mm256_xor_si256(remainder, negativeN), negativeN);
+			__m256i magnitudeD = _mm256_sub_epi64(_mm256_xor_si256(d, negativeD), negativeD);
+			__m256i step = _mm256_or_si256(_mm256_xor_si256(negativeN, negativeD), _mm256_set1_epi64x(1));
+			__m256i tooShort = _mm256_cmpgt_epi64(remainder, _mm256_sub_epi64(magnitudeD, _mm256_set1_epi64x(1)));
+			__m256i tooFar = Negative64(remainder);
+			__m256i correction = _mm256_sub_epi64(_mm256_and_si256(tooShort, step), _mm256_and_si256(tooFar, step));
+			quotient = _mm256_add_epi64(quotient, _mm256_andnot_si256(saturated, correction));
+			__m128i result = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(quotient, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+
+			__m128i divisionByZero = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi32(x, _mm_setzero_si128()), _mm_set1_epi32(0x7FFFFFFF)), _mm_and_si128(_mm_cmplt_epi32(x, _mm_setzero_si128()), _mm_set1_epi32(static_cast<int>(0x80000000))));
+			return _mm_blendv_epi8(result, divisionByZero, zero);
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		SaturatingAdd32(__m256i x, __m256i y)
+		{
+			__m256i sum = _mm256_add_epi32(x, y);
+			__m256i overflow = _mm256_srai_epi32(_mm256_and_si256(_mm256_xor_si256(x, sum), _mm256_xor_si256(y, sum)), 31);
+			__m256i saturated = _mm256_xor_si256(_mm256_srai_epi32(x, 31), _mm256_set1_epi32(0x7FFFFFFF));
+			return _mm256_blendv_epi8(sum, saturated, overflow);
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		SaturatingSubtract32(__m256i x, __m256i y)
+		{
+			__m256i difference = _mm256_sub_epi32(x, y);
+			__m256i overflow = _mm256_srai_epi32(_mm256_and_si256(_mm256_xor_si256(x, y), _mm256_xor_si256(x, difference)), 31);
+			__m256i saturated = _mm256_xor_si256(_mm256_srai_epi32(x, 31), _mm256_set1_epi32(0x7FFFFFFF));
+			return _mm256_blendv_epi8(difference, saturated, overflow);
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Abs32(__m256i x)
+		{
+			__m256i value = _mm256_abs_epi32(x);
+			return _mm256_xor_si256(value, _mm256_srai_epi32(value, 31));
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		SaturatingAdd64(__m256i x, __m256i y)
+		{
+			__m256i sum = _mm256_add_epi64(x, y);
+			__m256i overflow = Negative64(_mm256_and_si256(_mm256_xor_si256(x, sum), _mm256_xor_si256(y, sum)));
+			__m256i saturated = _mm256_xor_si256(Negative64(x), _mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+			return _mm256_blendv_epi8(sum, saturated, overflow);
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		SaturatingSubtract64(__m256i x, __m256i y)
+		{
+			__m256i difference = _mm256_sub_epi64(x, y);
+			__m256i overflow = Negative64(_mm256_and_si256(_mm256_xor_si256(x, y), _mm256_xor_si256(x, difference)));
+			__m256i saturated = _mm256_xor_si256(Negative64(x), _mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+			return _mm256_blendv_epi8(difference, saturated, overflow);
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Min64(__m256i x, __m256i y)
+		{
+			return _mm256_blendv_epi8(x, y, _mm256_cmpgt_epi64(x, y));
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Max64(__m256i x, __m256i y)
+		{
+			return _mm256_blendv_epi8(y, x, _mm256_cmpgt_epi64(x, y));
+		}
+
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Abs64(__m256i x)
+		{
+			__m256i negative = Negative64(x);
+			__m256i value = _mm256_sub_epi64(_mm256_xor_si256(x, negative), negative);
+			return _mm256_xor_si256(value, Negative64(value));
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Apply16(__m256i x, __m256i y)
+		{
+			switch(operation)
+			{
+				case ArrayOperation::Add:
+					return _mm256_adds_epi16(x, y);
+				case ArrayOperation::Subtract:
+					return _mm256_subs_epi16(x, y);
+				case ArrayOperation::Multiply:
+					return Multiply16(x, y);
+				case ArrayOperation::Min:
+					return _mm256_min_epi16(x, y);
+				default:
+					return _mm256_max_epi16(x, y);
+			}
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Apply32(__m256i x, __m256i y)
+		{
+			switch(operation)
+			{
+				case ArrayOperation::Add:
+					return SaturatingAdd32(x, y);
+				case ArrayOperation::Subtract:
+					return SaturatingSubtract32(x, y);
+				case ArrayOperation::Multiply:
+					return Multiply32(x, y);
+				case ArrayOperation::Min:
+					return _mm256_min_epi32(x, y);
+				default:
+					return _mm256_max_epi32(x, y);
+			}
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx2")
+		inline __m256i
+		Apply64(__m256i x, __m256i y)
+		{
+			switch(operation)
+			{
+				case ArrayOperation::Add:
+					return SaturatingAdd64(x, y);
+				case ArrayOperation::Subtract:
+					return SaturatingSubtract64(x, y);
+				case ArrayOperation::Min:
+					return Min64(x, y);
+				default:
+					return Max64(x, y);
+			}
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx2")
+		inline void
+		BinaryAvx2(int16_t const* a, int16_t const* b, int16_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 16) <= count; i += 16)
+			{
+				__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+				__m256i y = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Apply16<operation>(x, y));
+			}
+			BinaryScalar(operation, a + i, b + i, out + i, count - i);
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx2")
+		inline void
+		BinaryAvx2(int32_t const* a, int32_t const* b, int32_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+				__m256i y = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Apply32<operation>(x, y));
+			}
+			BinaryScalar(operation, a + i, b + i, out + i, count - i);
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx2")
+		inline void
+		BinaryAvx2(int64_t const* a, int64_t const* b, int64_t* out, size_t count)
+		{
+			size_t i = 0;
+			if (operation != ArrayOperation::Multiply)
+			{
+				for(; (i + 4) <= count; i += 4)
+				{
+					__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+					__m256i y = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Apply64<operation>(x, y));
+				}
+			}
+			BinaryScalar(operation, a + i, b + i, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		MultiplyAccumulateAvx2(int16_t const* a, int16_t const* b, int16_t* accumulator, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 16) <= count; i += 16)
+			{
+				__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+				__m256i y = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+				__m256i z = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(accumulator + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(accumulator + i), MultiplyAccumulate16(x, y, z));
+			}
+			MultiplyAccumulateScalar(a + i, b + i, accumulator + i, count - i);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		MultiplyAccumulateAvx2(int32_t const* a, int32_t const* b, int32_t* accumulator, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+				__m256i y = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+				__m256i z = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(accumulator + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(accumulator + i), MultiplyAccumulate32(x, y, z));
+			}
+			MultiplyAccumulateScalar(a + i, b + i, accumulator + i, count - i);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		MultiplyAccumulateAvx2(int64_t const* a, int64_t const* b, int64_t* accumulator, size_t count)
+		{
+			MultiplyAccumulateScalar(a, b, accumulator, count);
+		}
+
+		SFPML_TARGET("avx2")
+		inline bool
+		DivideAvx2(int16_t const* a, int16_t const* b, int16_t* out, size_t count)
+		{
+			__m256i zero = _mm256_setzero_si256();
+			size_t i = 0;
+			for(; (i + 16) <= count; i += 16)
+			{
+				__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+				__m256i y = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+				zero = _mm256_or_si256(zero, _mm256_cmpeq_epi16(y, _mm256_setzero_si256()));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Divide16(x, y));
+			}
+
+			return DivideScalar(a + i, b + i, out + i, count - i) || (_mm256_movemask_epi8(zero) != 0);
+		}
+
+		SFPML_TARGET("avx2")
+		inline bool
+		DivideAvx2(int32_t const* a, int32_t const* b, int32_t* out, size_t count)
+		{
+			__m128i zero = _mm_setzero_si128();
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+				__m128i y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+				zero = _mm_or_si128(zero, _mm_cmpeq_epi32(y, _mm_setzero_si128()));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Divide32(x, y));
+			}
+
+			return DivideScalar(a + i, b + i, out + i, count - i) || (_mm_movemask_epi8(zero) != 0);
+		}
+
+		SFPML_TARGET("avx2")
+		inline bool
+		DivideAvx2(int64_t const* a, int64_t const* b, int64_t* out, size_t count)
+		{
+			return DivideScalar(a, b, out, count);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		AbsAvx2(int16_t const* a, int16_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 16) <= count; i += 16)
+			{
+				__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_max_epi16(x, _mm256_subs_epi16(_mm256_setzero_si256(), x)));
+			}
+			AbsScalar(a + i, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		AbsAvx2(int32_t const* a, int32_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Abs32(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i))));
+			}
+			AbsScalar(a + i, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		AbsAvx2(int64_t const* a, int64_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Abs64(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i))));
+			}
+			AbsScalar(a + i, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		ClampAvx2(int16_t const* a, int16_t low, int16_t high, int16_t* out, size_t count)
+		{
+			const __m256i lowVector = _mm256_set1_epi16(low);
+			const __m256i highVector = _mm256_set1_epi16(high);
+			size_t i = 0;
+			for(; (i + 16) <= count; i += 16)
+			{
+				__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_min_epi16(_mm256_max_epi16(x, lowVector), highVector));
+			}
+			ClampScalar(a + i, low, high, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		ClampAvx2(int32_t const* a, int32_t low, int32_t high, int32_t* out, size_t count)
+		{
+			const __m256i lowVector = _mm256_set1_epi32(low);
+			const __m256i highVector = _mm256_set1_epi32(high);
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_min_epi32(_mm256_max_epi32(x, lowVector), highVector));
+			}
+			ClampScalar(a + i, low, high, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx2")
+		inline void
+		ClampAvx2(int64_t const* a, int64_t low, int64_t high, int64_t* out, size_t count)
+		{
+			const __m256i lowVector = _mm256_set1_epi64x(low);
+			const __m256i highVector = _mm256_set1_epi64x(high);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Min64(Max64(x, lowVector), highVector));
+			}
+			ClampScalar(a + i, low, high, out + i, count - i);
+		}
+#endif
+
+#if defined(SFPML_SSE2)
+		// AVX-512 kernels (32 x Q8.8, 16 x Q16.16, 8 x Q32.32 lanes)
+		// The GCC headers implement several unmasked intrinsics (shifts, abs, min/max,
+		// mul_epi32) with an undefined source operand, which -Wmaybe-uninitialized reports:
+		// their zero-masking forms with every lane selected are used instead.
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		MultiplyAccumulate16(__m512i x, __m512i y, __m512i accumulator)
+		{
+			const __m512i round = _mm512_set1_epi32(1 << 7);
+			__m512i low = _mm512_mullo_epi16(x, y);
+			__m512i high = _mm512_mulhi_epi16(x, y);
+			__m512i p0 = _mm512_add_epi32(_mm512_unpacklo_epi16(low, high), round);
+			__m512i p1 = _mm512_add_epi32(_mm512_unpackhi_epi16(low, high), round);
+			p0 = _mm512_add_epi32(p0, _mm512_maskz_srai_epi32(0xFFFF, _mm512_unpacklo_epi16(_mm512_setzero_si512(), accumulator), 8));
+			p1 = _mm512_add_epi32(p1, _mm512_maskz_srai_epi32(0xFFFF, _mm512_unpackhi_epi16(_mm512_setzero_si512(), accumulator), 8));
+			return _mm512_packs_epi32(_mm512_maskz_srai_epi32(0xFFFF, p0, 8), _mm512_maskz_srai_epi32(0xFFFF, p1, 8));
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		Multiply16(__m512i x, __m512i y)
+		{
+			return MultiplyAccumulate16(x, y, _mm512_setzero_si512());
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		Narrow32(__m512i sum)
+		{
+			__m512i value = _mm512_maskz_srai_epi64(0xFF, sum, 16);
+			return _mm512_maskz_min_epi64(0xFF, _mm512_maskz_max_epi64(0xFF, value, _mm512_set1_epi64(-(1ll << 31))), _mm512_set1_epi64((1ll << 31) - 1));
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		MultiplyAccumulate32(__m512i x, __m512i y, __m512i accumulator)
+		{
+			const __m512i round = _mm512_set1_epi64(1 << 15);
+			const __m512i scale = _mm512_set1_epi64(1 << 16);
+			__m512i even = _mm512_add_epi64(_mm512_maskz_mul_epi32(0xFF, x, y), _mm512_maskz_mul_epi32(0xFF, accumulator, scale));
+			__m512i odd = _mm512_add_epi64(_mm512_maskz_mul_epi32(0xFF, _mm512_maskz_srli_epi64(0xFF, x, 32), _mm512_maskz_srli_epi64(0xFF, y, 32)), _mm512_maskz_mul_epi32(0xFF, _mm512_maskz_srli_epi64(0xFF, accumulator, 32), scale));
+			even = Narrow32(_mm512_add_epi64(even, round));
+			odd = Narrow32(_mm512_add_epi64(odd, round));
+			return _mm512_mask_blend_epi32(0xAAAA, even, _mm512_maskz_slli_epi64(0xFF, odd, 32));
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		Multiply32(__m512i x, __m512i y)
+		{
+			return MultiplyAccumulate32(x, y, _mm512_setzero_si512());
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		SaturatingAdd32(__m512i x, __m512i y)
+		{
+			__m512i sum = _mm512_add_epi32(x, y);
+			__mmask16 overflow = _mm512_cmplt_epi32_mask(_mm512_and_si512(_mm512_xor_si512(x, sum), _mm512_xor_si512(y, sum)), _mm512_setzero_si512());
+			__m512i saturated = _mm512_xor_si512(_mm512_maskz_srai_epi32(0xFFFF, x, 31), _mm512_set1_epi32(0x7FFFFFFF));
+			return _mm512_mask_blend_epi32(overflow, sum, saturated);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		SaturatingSubtract32(__m512i x, __m512i y)
+		{
+			__m512i difference = _mm512_sub_epi32(x, y);
+			__mmask16 overflow = _mm512_cmplt_epi32_mask(_mm512_and_si512(_mm512_xor_si512(x, y), _mm512_xor_si512(x, difference)), _mm512_setzero_si512());
+			__m512i saturated = _mm512_xor_si512(_mm512_maskz_srai_epi32(0xFFFF, x, 31), _mm512_set1_epi32(0x7FFFFFFF));
+			return _mm512_mask_blend_epi32(overflow, difference, saturated);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		Abs32(__m512i x)
+		{
+			__m512i value = _mm512_maskz_abs_epi32(0xFFFF, x);
+			return _mm512_xor_si512(value, _mm512_maskz_srai_epi32(0xFFFF, value, 31));
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		SaturatingAdd64(__m512i x, __m512i y)
+		{
+			__m512i sum = _mm512_add_epi64(x, y);
+			__mmask8 overflow = _mm512_cmplt_epi64_mask(_mm512_and_si512(_mm512_xor_si512(x, sum), _mm512_xor_si512(y, sum)), _mm512_setzero_si512());
+			__m512i saturated = _mm512_xor_si512(_mm512_maskz_srai_epi64(0xFF, x, 63), _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFll));
+			return _mm512_mask_blend_epi64(overflow, sum, saturated);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		SaturatingSubtract64(__m512i x, __m512i y)
+		{
+			__m512i difference = _mm512_sub_epi64(x, y);
+			__mmask8 overflow = _mm512_cmplt_epi64_mask(_mm512_and_si512(_mm512_xor_si512(x, y), _mm512_xor_si512(x, difference)), _mm512_setzero_si512());
+			__m512i saturated = _mm512_xor_si512(_mm512_maskz_srai_epi64(0xFF, x, 63), _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFll));
+			return _mm512_mask_blend_epi64(overflow, difference, saturated);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		Abs64(__m512i x)
+		{
+			__m512i value = _mm512_maskz_abs_epi64(0xFF, x);
+			return _mm512_xor_si512(value, _mm512_maskz_srai_epi64(0xFF, value, 63));
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		Apply16(__m512i x, __m512i y)
+		{
+			switch(operation)
+			{
+				case ArrayOperation::Add:
+					return _mm512_adds_epi16(x, y);
+				case ArrayOperation::Subtract:
+					return _mm512_subs_epi16(x, y);
+				case ArrayOperation::Multiply:
+					return Multiply16(x, y);
+				case ArrayOperation::Min:
+					return _mm512_min_epi16(x, y);
+				default:
+					return _mm512_max_epi16(x, y);
+			}
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		Apply32(__m512i x, __m512i y)
+		{
+			switch(operation)
+			{
+				case ArrayOperation::Add:
+					return SaturatingAdd32(x, y);
+				case ArrayOperation::Subtract:
+					return SaturatingSubtract32(x, y);
+				case ArrayOperation::Multiply:
+					return Multiply32(x, y);
+				case ArrayOperation::Min:
+					return _mm512_maskz_min_epi32(0xFFFF, x, y);
+				default:
+					return _mm512_maskz_max_epi32(0xFFFF, x, y);
+			}
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx512f,avx512bw")
+		inline __m512i
+		Apply64(__m512i x, __m512i y)
+		{
+			switch(operation)
+			{
+				case ArrayOperation::Add:
+					return SaturatingAdd64(x, y);
+				case ArrayOperation::Subtract:
+					return SaturatingSubtract64(x, y);
+				case ArrayOperation::Min:
+					return _mm512_maskz_min_epi64(0xFF, x, y);
+				default:
+					return _mm512_maskz_max_epi64(0xFF, x, y);
+			}
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		BinaryAvx512(int16_t const* a, int16_t const* b, int16_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 32) <= count; i += 32)
+			{
+				__m512i x = _mm512_loadu_si512(a + i);
+				__m512i y = _mm512_loadu_si512(b + i);
+				_mm512_storeu_si512(out + i, Apply16<operation>(x, y));
+			}
+			BinaryScalar(operation, a + i, b + i, out + i, count - i);
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		BinaryAvx512(int32_t const* a, int32_t const* b, int32_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 16) <= count; i += 16)
+			{
+				__m512i x = _mm512_loadu_si512(a + i);
+				__m512i y = _mm512_loadu_si512(b + i);
+				_mm512_storeu_si512(out + i, Apply32<operation>(x, y));
+			}
+			BinaryScalar(operation, a + i, b + i, out + i, count - i);
+		}
+
+		template <ArrayOperation operation>
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		BinaryAvx512(int64_t const* a, int64_t const* b, int64_t* out, size_t count)
+		{
+			size_t i = 0;
+			if (operation != ArrayOperation::Multiply)
+			{
+				for(; (i + 8) <= count; i += 8)
+				{
+					__m512i x = _mm512_loadu_si512(a + i);
+					__m512i y = _mm512_loadu_si512(b + i);
+					_mm512_storeu_si512(out + i, Apply64<operation>(x, y));
+				}
+			}
+			BinaryScalar(operation, a + i, b + i, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		MultiplyAccumulateAvx512(int16_t const* a, int16_t const* b, int16_t* accumulator, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 32) <= count; i += 32)
+			{
+				__m512i z = _mm512_loadu_si512(accumulator + i);
+				_mm512_storeu_si512(accumulator + i, MultiplyAccumulate16(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i), z));
+			}
+			MultiplyAccumulateScalar(a + i, b + i, accumulator + i, count - i);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		MultiplyAccumulateAvx512(int32_t const* a, int32_t const* b, int32_t* accumulator, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 16) <= count; i += 16)
+			{
+				__m512i z = _mm512_loadu_si512(accumulator + i);
+				_mm512_storeu_si512(accumulator + i, MultiplyAccumulate32(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i), z));
+			}
+			MultiplyAccumulateScalar(a + i, b + i, accumulator + i, count - i);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		MultiplyAccumulateAvx512(int64_t const* a, int64_t const* b, int64_t* accumulator, size_t count)
+		{
+			MultiplyAccumulateScalar(a, b, accumulator, count);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		AbsAvx512(int16_t const* a, int16_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 32) <= count; i += 32)
+			{
+				__m512i x = _mm512_loadu_si512(a + i);
+				_mm512_storeu_si512(out + i, _mm512_max_epi16(x, _mm512_subs_epi16(_mm512_setzero_si512(), x)));
+			}
+			AbsScalar(a + i, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		AbsAvx512(int32_t const* a, int32_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 16) <= count; i += 16)
+			{
+				_mm512_storeu_si512(out + i, Abs32(_mm512_loadu_si512(a + i)));
+			}
+			AbsScalar(a + i, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		AbsAvx512(int64_t const* a, int64_t* out, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				_mm512_storeu_si512(out + i, Abs64(_mm512_loadu_si512(a + i)));
+			}
+			AbsScalar(a + i, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		ClampAvx512(int16_t const* a, int16_t low, int16_t high, int16_t* out, size_t count)
+		{
+			const __m512i lowVector = _mm512_set1_epi16(low);
+			const __m512i highVector = _mm512_set1_epi16(high);
+			size_t i = 0;
+			for(; (i + 32) <= count; i += 32)
+			{
+				_mm512_storeu_si512(out + i, _mm512_min_epi16(_mm512_max_epi16(_mm512_loadu_si512(a + i), lowVector), highVector));
+			}
+			ClampScalar(a + i, low, high, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		ClampAvx512(int32_t const* a, int32_t low, int32_t high, int32_t* out, size_t count)
+		{
+			const __m512i lowVector = _mm512_set1_epi32(low);
+			const __m512i highVector = _mm512_set1_epi32(high);
+			size_t i = 0;
+			for(; (i + 16) <= count; i += 16)
+			{
+				_mm512_storeu_si512(out + i, _mm512_maskz_min_epi32(0xFFFF, _mm512_maskz_max_epi32(0xFFFF, _mm512_loadu_si512(a + i), lowVector), highVector));
+			}
+			ClampScalar(a + i, low, high, out + i, count - i);
+		}
+
+		SFPML_TARGET("avx512f,avx512bw")
+		inline void
+		ClampAvx512(int64_t const* a, int64_t low, int64_t high, int64_t* out, size_t count)
+		{
+			const __m512i lowVector = _mm512_set1_epi64(low);
+			const __m512i highVector = _mm512_set1_epi64(high);
+			size_t i = 0;
+			for(; (i + 8) <= count; i += 8)
+			{
+				_mm512_storeu_si512(out + i, _mm512_maskz_min_epi64(0xFF, _mm512_maskz_max_epi64(0xFF, _mm512_loadu_si512(a + i), lowVector), highVector));
+			}
+			ClampScalar(a + i, low, high, out + i, count - i);
+		}
+#endif
+
+		// Kernel tables, indexed by InstructionSet
+
+		template <ArrayOperation operation, typename R>
+		inline void
+		BinaryScalar(R const* a, R const* b, R* out, size_t count)
+		{
+			BinaryScalar(operation, a, b, out, count);
+		}
+
+		template <ArrayOperation operation, typename R>
+		inline void
+		Binary(R const* a, R const* b, R* out, size_t count)
+		{
+#if defined(SFPML_SSE2)
+			static void (* const table[])(R const*, R const*, R*, size_t) = { BinaryScalar<operation>, BinarySse2<operation>, BinaryAvx2<operation>, BinaryAvx512<operation> };
+			table[Level()](a, b, out, count);
+#else
+			BinaryScalar(operation, a, b, out, count);
+#endif
+		}
+
+		template <typename R>
+		inline void
+		MultiplyAccumulate(R const* a, R const* b, R* accumulator, size_t count)
+		{
+#if defined(SFPML_SSE2)
+			static void (* const table[])(R const*, R const*, R*, size_t) = { MultiplyAccumulateScalar, MultiplyAccumulateSse2, MultiplyAccumulateAvx2, MultiplyAccumulateAvx512 };
+			table[Level()](a, b, accumulator, count);
+#else
+			MultiplyAccumulateScalar(a, b, accumulator, count);
+#endif
+		}
+
+		// No AVX-512 division: the AVX2 kernel is used
+		template <typename R>
+		inline bool
+		Divide(R const* a, R const* b, R* out, size_t count)
+		{
+#if defined(SFPML_SSE2)
+			static bool (* const table[])(R const*, R const*, R*, size_t) = { DivideScalar, DivideSse2, DivideAvx2, DivideAvx2 };
+			return table[Level()](a, b, out, count);
+#else
+			return DivideScalar(a, b, out, count);
+#endif
+		}
+
+		template <typename R>
+		inline void
+		Abs(R const* a, R* out, size_t count)
+		{
+#if defined(SFPML_SSE2)
+			static void (* const table[])(R const*, R*, size_t) = { AbsScalar, AbsSse2, AbsAvx2, AbsAvx512 };
+			table[Level()](a, out, count);
+#else
+			AbsScalar(a, out, count);
+#endif
+		}
+
+		template <typename R>
+		inline void
+		Clamp(R const* a, R low, R high, R* out, size_t count)
+		{
+#if defined(SFPML_SSE2)
+			static void (* const table[])(R const*, R, R, R*, size_t) = { ClampScalar, ClampSse2, ClampAvx2, ClampAvx512 };
+			table[Level()](a, low, high, out, count);
+#else
+			ClampScalar(a, low, high, out, count);
+#endif
+		}
+	}
+
+	// FixedPointArray
+	// Structure of arrays container: the values are stored as raw two's complement
+	// Q numbers (no sign byte), contiguous and 64-byte aligned, so that the
+	// element-wise operations run as SIMD kernels on the raw integers.
+	// One bit goes to the sign: the range is half the range of FixedPoint
+	// (-128.0 .. 127.996 for Q8.8, -32768.0 .. 32767.99998 for Q16.16,
+	// -2^31 .. 2^31 - 2^-32 for Q32.32). Storing a value outside that range (ToRaw,
+	// Set, the span constructor, the Clamp bounds) throws FPException("Out of range").
+	// The arithmetic follows the kernels above, not the FixedPoint operators: the
+	// results saturate instead of wrapping around, the products are rounded to
+	// nearest instead of truncated, and there is no negative zero.
+
+	template <typename T>
+	class FixedPointArray
+	{
+	public:
+		using Raw = typename std::make_signed<T>::type;
+		enum { Alignment = 64 };
+
+	private:
+		Raw* values;
+		size_t size;
+
+		void Allocate(size_t count);
+
+	public:
+		FixedPointArray() : values(nullptr), size(0) {}
+		explicit FixedPointArray(size_t);
+		FixedPointArray(size_t, UninitializedTag);
+		FixedPointArray(Span<FixedPoint<T> const>);
+		FixedPointArray(FixedPointArray const&);
+		FixedPointArray(FixedPointArray&&) noexcept;
+		~FixedPointArray() { AlignedFree(values); }
+
+		FixedPointArray& operator=(FixedPointArray const&);
+		FixedPointArray& operator=(FixedPointArray&&) noexcept;
+
+		FixedPointArray operator+(FixedPointArray const&) const;
+		FixedPointArray& operator+=(FixedPointArray const&);
+		FixedPointArray operator-(FixedPointArray const&) const;
+		FixedPointArray& operator-=(FixedPointArray const&);
+		FixedPointArray operator*(FixedPointArray const&) const;
+		FixedPointArray& operator*=(FixedPointArray const&);
+		FixedPointArray operator/(FixedPointArray const&) const;
+		FixedPointArray& operator/=(FixedPointArray const&);
+		FixedPointArray& MultiplyAccumulate(FixedPointArray const&, FixedPointArray const&);
+
+		size_t Size() const { return size; }
+		Raw* Data() { return values; }
+		Raw const* Data() const { return values; }
+		Span<Raw> Values() { return Span<Raw>(values, size); }
+		Span<Raw const> Values() const { return Span<Raw const>(values, size); }
+		FixedPoint<T> Get(size_t) const;
+		void Set(size_t, FixedPoint<T> const&);
+		void ToFixedPoint(Span<FixedPoint<T>>) const;
+
+		static Raw ToRaw(FixedPoint<T> const&);
+		static FixedPoint<T> FromRaw(Raw);
+		static FixedPointArray Min(FixedPointArray const&, FixedPointArray const&);
+		static FixedPointArray Max(FixedPointArray const&, FixedPointArray const&);
+		static FixedPointArray Abs(FixedPointArray const&);
+		static FixedPointArray Clamp(FixedPointArray const&, FixedPoint<T> const&, FixedPoint<T> const&);
+		static void Multiply(Span<Raw const>, Span<Raw const>, Span<Raw>);
+		static void MultiplyAccumulate(Span<Raw const>, Span<Raw const>, Span<Raw>);
+	};
+
+	template <typename T>
+	void
+	FixedPointArray<T>::Allocate(size_t count)
+	{
+		if (count > (std::numeric_limits<size_t>::max() / sizeof(Raw)))
+		{
+			throw FPException("Invalid size");
+		}
+
+		values = (count != 0) ? static_cast<Raw*>(AlignedAllocate(count * sizeof(Raw), Alignment)) : nullptr;
+		size = count;
+	}
+
+	template <typename T>
+	FixedPointArray<T>::FixedPointArray(size_t count)
+	{
+		Allocate(count);
+		if (count)
+		{
+			memset(values, 0, count * sizeof(Raw));
+		}
+	}
+
+	template <typename T>
+	FixedPointArray<T>::FixedPointArray(size_t count, UninitializedTag)
+	{
+		Allocate(count);
+	}
+
+	template <typename T>
+	FixedPointArray<T>::FixedPointArray(Span<FixedPoint<T> const> source)
+	{
+		Allocate(source.Size());
+		try
+		{
+			for(size_t i = 0; i < size; i++)
+			{
+				values[i] = ToRaw(source[i]);
+			}
+		}
+		catch(...)
+		{
+			// The destructor does not run for a constructor that throws
+			AlignedFree(values);
+			throw;
+		}
+	}
+
+	template <typename T>
+	FixedPointArray<T>::FixedPointArray(FixedPointArray const& other)
+	{
+		Allocate(other.size);
+		if (size)
+		{
+			memcpy(values, other.values, size * sizeof(Raw));
+		}
+	}
+
+	template <typename T>
+	FixedPointArray<T>::FixedPointArray(FixedPointArray&& other) noexcept
+	: values(other.values), size(other.size)
+	{
+		other.values = nullptr;
+		other.size = 0;
+	}
+
+	template <typename T>
+	FixedPointArray<T>&
+	FixedPointArray<T>::operator=(FixedPointArray const& other)
+	{
+		if (this != &other)
+		{
+			if (size != other.size)
+			{
+				// Copy and swap: *this is left as it is when the allocation throws
+				FixedPointArray copy(other);
+				std::swap(values, copy.values);
+				std::swap(size, copy.size);
+			}
+			else if (size)
+			{
+				memcpy(values, other.values, size * sizeof(Raw));
+			}
+		}
+
+		return *this;
+	}
+
+	template <typename T>
+	FixedPointArray<T>&
+	FixedPointArray<T>::operator=(FixedPointArray&& other) noexcept
+	{
+		if (this != &other)
+		{
+			AlignedFree(values);
+			values = other.values;
+			size = other.size;
+			other.values = nullptr;
+			other.size = 0;
+		}
+
+		return *this;
+	}
+
+	template <typename T>
+	FixedPointArray<T>
+	FixedPointArray<T>::operator+(FixedPointArray const& other) const
+	{
+		FixedPointArray<T> result(*this);
+		result += other;
+		return result;
+	}
+
+	template <typename T>
+	FixedPointArray<T>&
+	FixedPointArray<T>::operator+=(FixedPointArray const& other)
+	{
+		if (size != other.size)
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::Binary<kernels::ArrayOperation::Add>(values, other.values, values, size);
+		return *this;
+	}
+
+	template <typename T>
+	FixedPointArray<T>
+	FixedPointArray<T>::operator-(FixedPointArray const& other) const
+	{
+		FixedPointArray<T> result(*this);
+		result -= other;
+		return result;
+	}
+
+	template <typename T>
+	FixedPointArray<T>&
+	FixedPointArray<T>::operator-=(FixedPointArray const& other)
+	{
+		if (size != other.size)
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::Binary<kernels::ArrayOperation::Subtract>(values, other.values, values, size);
+		return *this;
+	}
+
+	template <typename T>
+	FixedPointArray<T>
+	FixedPointArray<T>::operator*(FixedPointArray const& other) const
+	{
+		FixedPointArray<T> result(*this);
+		result *= other;
+		return result;
+	}
+
+	template <typename T>
+	FixedPointArray<T>&
+	FixedPointArray<T>::operator*=(FixedPointArray const& other)
+	{
+		Multiply(Values(), other.Values(), Values());
+		return *this;
+	}
+
+	// MultiplyAccumulate
+	// this += a * b, element by element (e.g. one tap of a filter bank)
+
+	template <typename T>
+	FixedPointArray<T>&
+	FixedPointArray<T>::MultiplyAccumulate(FixedPointArray const& a, FixedPointArray const& b)
+	{
+		MultiplyAccumulate(a.Values(), b.Values(), Values());
+		return *this;
+	}
+
+	// Span API
+	// Same kernels as the FixedPointArray operators, over raw values owned by the caller.
+
+	template <typename T>
+	void
+	FixedPointArray<T>::Multiply(Span<Raw const> a, Span<Raw const> b, Span<Raw> destination)
+	{
+		if ((a.Size() != b.Size()) || (a.Size() != destination.Size()))
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::Binary<kernels::ArrayOperation::Multiply>(a.Data(), b.Data(), destination.Data(), a.Size());
+	}
+
+	template <typename T>
+	void
+	FixedPointArray<T>::MultiplyAccumulate(Span<Raw const> a, Span<Raw const> b, Span<Raw> accumulator)
+	{
+		if ((a.Size() != b.Size()) || (a.Size() != accumulator.Size()))
+		{
+			throw FPException("Invalid size");
+		}
+
+		kernels::MultiplyAccumulate(a.Data(), b.Data(), accumulator.Data(), a.Size());
+	}
+
+	template <typename T>
+	FixedPointArray<T>
+	FixedPointArray<T>::operator/(FixedPointArray const& other) const
+	{
+		FixedPointArray<T> result(*this);
+		result /= other;
+		return result;
+	}
+
+	// Division operator
+	// All the elements are divided, then an exception is thrown if any divisor
+	// was zero (those elements hold the saturated value).
+
+	template <typename T>
+	FixedPointArray<T>&
+	FixedPointArray<T>::operator/=(FixedPointArray const& other)
+	{
+		if (size != other.size)
+		{
+			throw FPException("Invalid size");
+		}
+
+		if (kernels::Divide(values, other.values, values, size))
+		{
+			throw FPException("Division by zero");
+		}
+		return *this;
+	}
+
+	template <typename T>
+	FixedPoint<T>
+	FixedPointArray<T>::Get(size_t index) const
+	{
+		if (index >= size)
+		{
+			throw FPException("Subscript out of range");
+		}
+
+		return FromRaw(values[index]);
+	}
+
+	template <typename T>
+	void
+	FixedPointArray<T>::Set(size_t index, FixedPoint<T> const& value)
+	{
+		if (index >= size)
+		{
+			throw FPException("Subscript out of range");
+		}
+
+		values[index] = ToRaw(value);
+	}
+
+	template <typename T>
+	void
+	FixedPointArray<T>::ToFixedPoint(Span<FixedPoint<T>> destination) const
+	{
+		if (destination.Size() != size)
+		{
+			throw FPException("Invalid size");
+		}
+
+		for(size_t i = 0; i < size; i++)
+		{
+			destination[i] = FromRaw(values[i]);
+		}
+	}
+
+	template <typename T>
+	typename FixedPointArray<T>::Raw
+	FixedPointArray<T>::ToRaw(FixedPoint<T> const& value)
+	{
+		// The negative range has one more value (-2^(n-1) raw)
+		typename FixedPoint<T>::Number number = value;
+		const T limit = static_cast<T>(std::numeric_limits<Raw>::max());
+		if (number.value.fixedPoint > (number.sign ? static_cast<T>(limit + 1) : limit))
+		{
+			throw FPException("Out of range");
+		}
+
+		return number.sign ? static_cast<Raw>(0 - number.value.fixedPoint) : static_cast<Raw>(number.value.fixedPoint);
+	}
+
+	template <typename T>
+	FixedPoint<T>
+	FixedPointArray<T>::FromRaw(Raw raw)
+	{
+		if (raw < 0)
+		{
+			return FixedPoint<T>(true, static_cast<T>(0 - static_cast<T>(raw)));
+		}
+
+		return FixedPoint<T>(false, static_cast<T>(raw));
+	}
+
+	template <typename T>
+	FixedPointArray<T>
+	FixedPointArray<T>::Min(FixedPointArray const& a, FixedPointArray const& b)
+	{
+		if (a.size != b.size)
+		{
+			throw FPException("Invalid size");
+		}
+
+		FixedPointArray<T> result(a.size, Uninitialized);
+		kernels::Binary<kernels::ArrayOperation::Min>(a.values, b.values, result.values, a.size);
+		return result;
+	}
+
+	template <typename T>
+	FixedPointArray<T>
+	FixedPointArray<T>::Max(FixedPointArray const& a, FixedPointArray const& b)
+	{
+		if (a.size != b.size)
+		{
+			throw FPException("Invalid size");
+		}
+
+		FixedPointArray<T> result(a.size, Uninitialized);
+		kernels::Binary<kernels::ArrayOperation::Max>(a.values, b.values, result.values, a.size);
+		return result;
+	}
+
+	template <typename T>
+	FixedPointArray<T>
+	FixedPointArray<T>::Abs(FixedPointArray const& a)
+	{
+		FixedPointArray<T> result(a.size, Uninitialized);
+		kernels::Abs(a.values, result.values, a.size);
+		return result;
+	}
+
+	template <typename T>
+	FixedPointArray<T>
+	FixedPointArray<T>::Clamp(FixedPointArray const& a, FixedPoint<T> const& low, FixedPoint<T> const& high)
+	{
+		Raw rawLow = ToRaw(low);
+		Raw rawHigh = ToRaw(high);
+		if (rawLow > rawHigh)
+		{
+			throw FPException("Invalid argument");
+		}
+
+		FixedPointArray<T> result(a.size, Uninitialized);
+		kernels::Clamp(a.values, rawLow, rawHigh, result.values, a.size);
+		return result;
+	}
+
+	typedef FixedPointArray<uint16_t> FixedPointArraySmall;
+	typedef FixedPointArray<uint32_t> FixedPointArrayMedium;
+	typedef FixedPointArray<uint64_t> FixedPointArrayLarge;
+
+	// std::conditional
+	template <typename T>
+	class MyTest
+	{
+		using Other = typename std::conditional<sizeof(T) == 4, uint16_t, uint32_t>::type;
+		using T1 = typename std::conditional<sizeof(T) == 2, uint8_t, Other>::type;
+		using T2 = typename std::enable_if<std::is_integral<T>::value, T1>::type;
+
+	public:
+		T2 member;
+
+		MyTest() : member(0) {}
+	};
+
+	// Packed Vec kernels (FixedPointMedium, 3 and 4 components)
+	// The components are loaded in two registers, one holding the four magnitudes
+	// (32 bit lanes) and one the four signs (all ones when negative), and every
+	// lane reproduces the FixedPoint operators exactly: sign-magnitude results,
+	// magnitudes wrapped to 32 bits, the sign of the zero results included.
+	// The dot product and the length add the lanes in the same order as the
+	// generic code, the length takes the square root with Sqrt.
+
+#if defined(SFPML_SSE2)
+	namespace kernels
+	{
+		struct PackedVec
+		{
+			__m128i signs;
+			__m128i magnitudes;
+		};
+
+		// Components are { bool sign; uint32_t magnitude } (8 bytes): the low dword
+		// holds the sign byte (and padding), the high dword the magnitude.
+		template <int N>
+		inline PackedVec
+		LoadPacked(FixedPoint<uint32_t> const* components)
+		{
+			static_assert((N == 3) || (N == 4), "Packed vectors have 3 or 4 components");
+			__m128i low = _mm_loadu_si128(reinterpret_cast<__m128i const*>(components));
+			__m128i high = (N == 4) ? _mm_loadu_si128(reinterpret_cast<__m128i const*>(components + 2)) : _mm_loadl_epi64(reinterpret_cast<__m128i const*>(components + 2));
+			__m128i signs = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(2, 0, 2, 0)));
+			__m128i magnitudes = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(3, 1, 3, 1)));
+			signs = _mm_cmpeq_epi32(_mm_and_si128(signs, _mm_set1_epi32(0xFF)), _mm_setzero_si128());
+			return PackedVec{ _mm_xor_si128(signs, _mm_set1_epi32(-1)), magnitudes };
+		}
+
+		template <int N>
+		inline void
+		StorePacked(PackedVec const& v, FixedPoint<uint32_t>* components)
+		{
+			__m128i signs = _mm_and_si128(v.signs, _mm_set1_epi32(1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(components), _mm_unpacklo_epi32(signs, v.magnitudes));
+			if (N == 4)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(components + 2), _mm_unpackhi_epi32(signs, v.magnitudes));
+			}
+			else
+			{
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(components + 2), _mm_unpackhi_epi32(signs, v.magnitudes));
+			}
+		}
+
+		// a > b on unsigned 32 bit lanes
+		inline __m128i
+		GreaterUnsigned(__m128i a, __m128i b)
+		{
+			const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+			return _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+		}
+
+		// operator+
+		inline PackedVec
+		AddPacked(PackedVec const& a, PackedVec const& b)
+		{
+			__m128i sameSign = _mm_cmpeq_epi32(a.signs, b.signs);
+			__m128i greater = GreaterUnsigned(a.magnitudes, b.magnitudes);
+			__m128i less = GreaterUnsigned(b.magnitudes, a.magnitudes);
+
+			// Opposite signs: the larger magnitude gives the sign, equal magnitudes give +0
+			__m128i difference = Select(greater, _mm_sub_epi32(a.magnitudes, b.magnitudes), _mm_sub_epi32(b.magnitudes, a.magnitudes));
+			__m128i differenceSign = _mm_or_si128(_mm_and_si128(greater, a.signs), _mm_and_si128(less, b.signs));
+
+			return PackedVec{ Select(sameSign, a.signs, differenceSign), Select(sameSign, _mm_add_epi32(a.magnitudes, b.magnitudes), difference) };
+		}
+
+		// operator-
+		inline PackedVec
+		SubtractPacked(PackedVec const& a, PackedVec const& b)
+		{
+			__m128i sameSign = _mm_cmpeq_epi32(a.signs, b.signs);
+			__m128i greater = GreaterUnsigned(a.magnitudes, b.magnitudes);
+			__m128i less = GreaterUnsigned(b.magnitudes, a.magnitudes);
+
+			// Same signs: the larger magnitude gives the sign, equal magnitudes give -0
+			__m128i difference = Select(greater, _mm_sub_epi32(a.magnitudes, b.magnitudes), _mm_sub_epi32(b.magnitudes, a.magnitudes));
+			__m128i differenceSign = Select(greater, a.signs, Select(less, _mm_xor_si128(a.signs, _mm_set1_epi32(-1)), _mm_set1_epi32(-1)));
+
+			return PackedVec{ Select(sameSign, differenceSign, a.signs), Select(sameSign, difference, _mm_add_epi32(a.magnitudes, b.magnitudes)) };
+		}
+
+		// operator*: the magnitude is the low dword of (a * b) >> 16
+		inline PackedVec
+		MultiplyPacked(PackedVec const& a, PackedVec const& b)
+		{
+			__m128i even = _mm_srli_epi64(_mm_mul_epu32(a.magnitudes, b.magnitudes), 16);
+			__m128i odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(a.magnitudes, 32), _mm_srli_epi64(b.magnitudes, 32)), 16);
+			__m128i magnitudes = _mm_or_si128(_mm_and_si128(even, _mm_set_epi32(0, -1, 0, -1)), _mm_slli_epi64(odd, 32));
+			return PackedVec{ _mm_xor_si128(a.signs, b.signs), magnitudes };
+		}
+
+		inline PackedVec
+		BroadcastPacked(FixedPoint<uint32_t> const& value)
+		{
+			typename FixedPoint<uint32_t>::Number number = static_cast<typename FixedPoint<uint32_t>::Number>(value);
+			return PackedVec{ _mm_set1_epi32(number.sign ? -1 : 0), _mm_set1_epi32(static_cast<int>(number.value.fixedPoint)) };
+		}
+
+		template <int I>
+		inline PackedVec
+		LanePacked(PackedVec const& v)
+		{
+			return PackedVec{ _mm_shuffle_epi32(v.signs, _MM_SHUFFLE(I, I, I, I)), _mm_shuffle_epi32(v.magnitudes, _MM_SHUFFLE(I, I, I, I)) };
+		}
+
+		// Sum of the lanes, added one after the other to +0 (lane 0 of the result)
+		template <int N>
+		inline FixedPoint<uint32_t>
+		SumPacked(PackedVec const& v)
+		{
+			PackedVec sum{ _mm_setzero_si128(), _mm_setzero_si128() };
+			sum = AddPacked(sum, LanePacked<0>(v));
+			sum = AddPacked(sum, LanePacked<1>(v));
+			sum = AddPacked(sum, LanePacked<2>(v));
+			if (N == 4)
+			{
+				sum = AddPacked(sum, LanePacked<3>(v));
+			}
+			return FixedPoint<uint32_t>(_mm_cvtsi128_si32(sum.signs) != 0, static_cast<uint32_t>(_mm_cvtsi128_si32(sum.magnitudes)));
+		}
+
+		// operator/ of every component by the same (non zero) divisor, on the
+		// magnitudes converted to double lanes (see DivideMagnitudes)
+		inline PackedVec
+		DividePacked(PackedVec const& v, FixedPoint<uint32_t> const& divisor)
+		{
+			const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+			const __m128d offset = _mm_set1_pd(2147483648.0);
+
+			typename FixedPoint<uint32_t>::Number number = static_cast<typename FixedPoint<uint32_t>::Number>(divisor);
+			__m128d x = _mm_set1_pd(static_cast<double>(number.value.fixedPoint));
+			__m128i biased = _mm_xor_si128(v.magnitudes, bias);
+			__m128d low = DivideMagnitudes<16>(_mm_add_pd(_mm_cvtepi32_pd(biased), offset), x);
+			__m128d high = DivideMagnitudes<16>(_mm_add_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(biased, _MM_SHUFFLE(1, 0, 3, 2))), offset), x);
+			__m128i magnitudes = _mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_sub_pd(low, offset)), _mm_cvttpd_epi32(_mm_sub_pd(high, offset)));
+
+			return PackedVec{ _mm_xor_si128(v.signs, _mm_set1_epi32(number.sign ? -1 : 0)), _mm_xor_si128(magnitudes, bias) };
+		}
+
+		// operator/ lane by lane (non zero divisors)
+		inline PackedVec
+		DivideLanesPacked(PackedVec const& v, PackedVec const& divisors)
+		{
+			const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+			const __m128d offset = _mm_set1_pd(2147483648.0);
+
+			__m128i biased = _mm_xor_si128(v.magnitudes, bias);
+			__m128i biasedDivisors = _mm_xor_si128(divisors.magnitudes, bias);
+			__m128d low = DivideMagnitudes<16>(_mm_add_pd(_mm_cvtepi32_pd(biased), offset), _mm_add_pd(_mm_cvtepi32_pd(biasedDivisors), offset));
+			__m128d high = DivideMagnitudes<16>(_mm_add_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(biased, _MM_SHUFFLE(1, 0, 3, 2))), offset), _mm_add_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(biasedDivisors, _MM_SHUFFLE(1, 0, 3, 2))), offset));
+			__m128i magnitudes = _mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_sub_pd(low, offset)), _mm_cvttpd_epi32(_mm_sub_pd(high, offset)));
+
+			return PackedVec{ _mm_xor_si128(v.signs, divisors.signs), _mm_xor_si128(magnitudes, bias) };
+		}
+
+		// 4 x 4 transpose of the lanes (e.g. 4 points => x, y, z and w lanes)
+		inline void
+		TransposePacked(PackedVec (&v)[4])
+		{
+			__m128 signs[4];
+			__m128 magnitudes[4];
+			for(int i = 0; i < 4; i++)
+			{
+				signs[i] = _mm_castsi128_ps(v[i].signs);
+				magnitudes[i] = _mm_castsi128_ps(v[i].magnitudes);
+			}
+			_MM_TRANSPOSE4_PS(signs[0], signs[1], signs[2], signs[3]);
+			_MM_TRANSPOSE4_PS(magnitudes[0], magnitudes[1], magnitudes[2], magnitudes[3]);
+			for(int i = 0; i < 4; i++)
+			{
+				v[i] = PackedVec{ _mm_castps_si128(signs[i]), _mm_castps_si128(magnitudes[i]) };
+			}
+		}
+
+		// Columns of a N x N matrix (rows stored one after the other)
+		template <int N>
+		inline void
+		LoadColumnsPacked(FixedPoint<uint32_t> const* m, PackedVec (&columns)[4])
+		{
+			for(int row = 0; row < 4; row++)
+			{
+				columns[row] = (row < N) ? LoadPacked<N>(m + (row * N)) : PackedVec{ _mm_setzero_si128(), _mm_setzero_si128() };
+			}
+			TransposePacked(columns);
+		}
+
+		// Matrix by vector product: the columns scaled by the components are added
+		// to +0 in the same order as the dot product of every row by the vector.
+		template <int N>
+		inline PackedVec
+		TransformPacked(PackedVec const (&columns)[4], PackedVec const& v)
+		{
+			PackedVec sum{ _mm_setzero_si128(), _mm_setzero_si128() };
+			sum = AddPacked(sum, MultiplyPacked(columns[0], LanePacked<0>(v)));
+			sum = AddPacked(sum, MultiplyPacked(columns[1], LanePacked<1>(v)));
+			sum = AddPacked(sum, MultiplyPacked(columns[2], LanePacked<2>(v)));
+			if (N == 4)
+			{
+				sum = AddPacked(sum, MultiplyPacked(columns[3], LanePacked<3>(v)));
+			}
+			return sum;
+		}
+
+		// Cross product of 3 component vectors
+		inline PackedVec
+		CrossPacked(PackedVec const& a, PackedVec const& b)
+		{
+			// (y1 * z2 - z1 * y2, -(x1 * z2 - z1 * x2), x1 * y2 - y1 * x2)
+			PackedVec a1{ _mm_shuffle_epi32(a.signs, _MM_SHUFFLE(3, 0, 0, 1)), _mm_shuffle_epi32(a.magnitudes, _MM_SHUFFLE(3, 0, 0, 1)) };
+			PackedVec b1{ _mm_shuffle_epi32(b.signs, _MM_SHUFFLE(3, 1, 2, 2)), _mm_shuffle_epi32(b.magnitudes, _MM_SHUFFLE(3, 1, 2, 2)) };
+			PackedVec a2{ _mm_shuffle_epi32(a.signs, _MM_SHUFFLE(3, 1, 2, 2)), _mm_shuffle_epi32(a.magnitudes, _MM_SHUFFLE(3, 1, 2, 2)) };
+			PackedVec b2{ _mm_shuffle_epi32(b.signs, _MM_SHUFFLE(3, 0, 0, 1)), _mm_shuffle_epi32(b.magnitudes, _MM_SHUFFLE(3, 0, 0, 1)) };
+			PackedVec cross = SubtractPacked(MultiplyPacked(a1, b1), MultiplyPacked(a2, b2));
+
+			// The 2nd component is multiplied by -1: only its sign changes
+			cross.signs = _mm_xor_si128(cross.signs, _mm_set_epi32(0, 0, -1, 0));
+			return cross;
+		}
+	}
+#endif
+
+	// Vector expressions
+	// The operators +, - and * (by a scalar) of vectors build lightweight nodes: an
+	// expression like a + b * s - c is evaluated component by component when it is
+	// assigned to a Vec (no temporary vectors). Every component is computed with the
+	// FixedPoint operators, each one rounding its result (there is no wider
+	// accumulator across the chain), so the results are the same as evaluating one
+	// operator at a time; Vec3Medium and Vec4Medium evaluate the whole expression in
+	// registers with the packed kernels.
+	// The nodes hold the inner nodes and the row and column views by value and refer
+	// to the vectors: a node kept with auto is valid as long as those vectors are.
+
+	template <class T, int N>
+	class Vec;
+
+	template <class T, int N, class E>
+	class VecExpression
+	{
+	public:
+		E const& Self() const { return static_cast<E const&>(*this); }
+	};
+
+	// Type of a stored operand: a reference for a Vec, a copy for the rest (nodes
+	// and views, which are usually temporaries of the same statement)
+	template <class T, int N, class E>
+	using VecOperand = typename std::conditional<std::is_same<E, Vec<T, N>>::value, E const&, E const>::type;
+
+	template <class T, int N, class A, class B>
+	class VecSum : public VecExpression<T, N, VecSum<T, N, A, B>>
+	{
+		VecOperand<T, N, A> a;
+		VecOperand<T, N, B> b;
+
+	public:
+		VecSum(A const& a, B const& b) : a(a), b(b) {}
+
+		T Component(int i) const { T x = a.Component(i); return x + b.Component(i); }
+#if defined(SFPML_SSE2)
+		kernels::PackedVec Packed() const { return kernels::AddPacked(a.Packed(), b.Packed()); }
+#endif
+	};
+
+	template <class T, int N, class A, class B>
+	class VecDifference : public VecExpression<T, N, VecDifference<T, N, A, B>>
+	{
+		VecOperand<T, N, A> a;
+		VecOperand<T, N, B> b;
+
+	public:
+		VecDifference(A const& a, B const& b) : a(a), b(b) {}
+
+		T Component(int i) const { T x = a.Component(i); return x - b.Component(i); }
+#if defined(SFPML_SSE2)
+		kernels::PackedVec Packed() const { return kernels::SubtractPacked(a.Packed(), b.Packed()); }
+#endif
+	};
+
+	// The scalar is copied: it is often a temporary
+	template <class T, int N, class A>
+	class VecScale : public VecExpression<T, N, VecScale<T, N, A>>
+	{
+		VecOperand<T, N, A> a;
+		T number;
+
+	public:
+		VecScale(A const& a, T const& number) : a(a), number(number) {}
+
+		T Component(int i) const { T x = a.Component(i); return x * number; }
+#if defined(SFPML_SSE2)
+		kernels::PackedVec Packed() const { return kernels::MultiplyPacked(a.Packed(), kernels::BroadcastPacked(number)); }
+#endif
+	};
+
+	namespace kernels
+	{
+		// Evaluation of an expression into the components of a vector. Each component
+		// only depends on the same component of the operands, so the destination can
+		// be one of them.
+		template <class T, int N, class E>
+		inline void
+		Evaluate(VecExpression<T, N, E> const& expression, T (&components)[N])
+		{
+			for(int i = 0; i < N; ++i)
+			{
+				components[i] = expression.Self().Component(i);
+			}
+		}
+
+		template <class T, int N, class A, class B>
+		inline T
+		Dot(VecExpression<T, N, A> const& a, VecExpression<T, N, B> const& b)
+		{
+			T sum(false, 0);
+			for(int i = 0; i < N; ++i)
+			{
+				T x = a.Self().Component(i);
+				sum += (x * b.Self().Component(i));
+			}
+
+			return sum;
+		}
+
+#if defined(SFPML_SSE2)
+		template <class E>
+		inline void
+		Evaluate(VecExpression<FixedPointMedium, 3, E> const& expression, FixedPointMedium (&components)[3])
+		{
+			StorePacked<3>(expression.Self().Packed(), components);
+		}
+
+		template <class E>
+		inline void
+		Evaluate(VecExpression<FixedPointMedium, 4, E> const& expression, FixedPointMedium (&components)[4])
+		{
+			StorePacked<4>(expression.Self().Packed(), components);
+		}
+
+		template <class A, class B>
+		inline FixedPointMedium
+		Dot(VecExpression<FixedPointMedium, 3, A> const& a, VecExpression<FixedPointMedium, 3, B> const& b)
+		{
+			return SumPacked<3>(MultiplyPacked(a.Self().Packed(), b.Self().Packed()));
+		}
+
+		template <class A, class B>
+		inline FixedPointMedium
+		Dot(VecExpression<FixedPointMedium, 4, A> const& a, VecExpression<FixedPointMedium, 4, B> const& b)
+		{
+			return SumPacked<4>(MultiplyPacked(a.Self().Packed(), b.Self().Packed()));
+		}
+#endif
+	}
+
+	template <class T, int N, class A, class B>
+	inline VecSum<T, N, A, B>
+	operator+(VecExpression<T, N, A> const& a, VecExpression<T, N, B> const& b)
+	{
+		return VecSum<T, N, A, B>(a.Self(), b.Self());
+	}
+
+	template <class T, int N, class A, class B>
+	inline VecDifference<T, N, A, B>
+	operator-(VecExpression<T, N, A> const& a, VecExpression<T, N, B> const& b)
+	{
+		return VecDifference<T, N, A, B>(a.Self(), b.Self());
+	}
+
+	template <class T, int N, class A>
+	inline VecScale<T, N, A>
+	operator*(VecExpression<T, N, A> const& a, T const& number)
+	{
+		return VecScale<T, N, A>(a.Self(), number);
+	}
+
+	// Dot product (evaluated immediately)
+	template <class T, int N, class A, class B>
+	inline T
+	operator*(VecExpression<T, N, A> const& a, VecExpression<T, N, B> const& b)
+	{
+		return kernels::Dot(a, b);
+	}
+
+	// Vectors
+	template <class T, int N>
+	class Vec : public VecExpression<T, N, Vec<T, N>>
+	{
+		T components[N];
+
+		template <std::size_t... I>
+		Vec(UninitializedTag tag, std::index_sequence<I...>) : components{ (static_cast<void>(I), T(tag))... } {}
+
+		template <class U, int M>
+		friend class Mat;
+
+	public:
+		Vec() : components() {}
+		explicit Vec(UninitializedTag tag) : Vec(tag, std::make_index_sequence<N>()) {}
+		Vec(std::initializer_list<T>);
+		Vec(std::vector<T> const&);
+		template <class E>
+		Vec(VecExpression<T, N, E> const&);
+
+		template <class E>
+		Vec& operator=(VecExpression<T, N, E> const&);
+		template <class E>
+		Vec& operator+=(VecExpression<T, N, E> const&);
+		template <class E>
+		Vec& operator-=(VecExpression<T, N, E> const&);
+		Vec& operator*=(T const&);
+		static Vec Cross(Vec const&, Vec const&);
+		static T Angle(Vec const&, Vec const&);
+		T operator[](uint32_t) const;
+		bool operator==(Vec const&) const;
+		bool operator!=(Vec const&) const;
+		T Mod() const;
+		Vec Normalize() const;
+		static void Mod(Span<Vec const>, Span<T>);
+		static void Normalize(Span<Vec const>, Span<Vec>);
+		std::string ToString() const;
+		FormatResult Format(char*, char*) const;
+
+		// Unchecked access for the expression templates
+		T const& Component(int index) const { return components[index]; }
+#if defined(SFPML_SSE2)
+		// Vec3Medium and Vec4Medium only
+		kernels::PackedVec Packed() const { return kernels::LoadPacked<N>(components); }
+#endif
+
+		// Longest text written by Format: (x, y, ...)
+		enum { MaxFormatLength = 2 + (N * T::MaxFormatLength) + ((N - 1) * 2) };
+	};
+
+	template <class T, int N>
+	Vec<T, N>::Vec(std::initializer_list<T> list)
+	: Vec()
+	{
+		if (list.size() > N)
+		{
+			throw(FPException("Invalid size"));
+		}
+
+		int k = 0;
+		for(auto const& elem : list)
+		{
+			components[k++] = elem;
+		}
+	}
+
+	template <class T, int N>
+	Vec<T, N>::Vec(std::vector<T> const& values)
+	: Vec()
+	{
+		if (values.size() > N)
+		{
+			throw(FPException("Invalid size"));
+		}
+
+		int k = 0;
+		for(auto const& elem : values)
+		{
+			components[k++] = elem;
+		}
+	}
+
+	template <class T, int N>
+	template <class E>
+	Vec<T, N>::Vec(VecExpression<T, N, E> const& expression)
+	: Vec(Uninitialized)
+	{
+		kernels::Evaluate(expression, components);
+	}
+
+	template <class T, int N>
+	template <class E>
+	Vec<T, N>&
+	Vec<T, N>::operator=(VecExpression<T, N, E> const& expression)
+	{
+		kernels::Evaluate(expression, components);
+		return *this;
+	}
+
+	template <class T, int N>
+	template <class E>
+	Vec<T, N>&
+	Vec<T, N>::operator+=(VecExpression<T, N, E> const& expression)
+	{
+		kernels::Evaluate(VecSum<T, N, Vec, E>(*this, expression.Self()), components);
+		return *this;
+	}
+
+	template <class T, int N>
+	template <class E>
+	Vec<T, N>&
+	Vec<T, N>::operator-=(VecExpression<T, N, E> const& expression)
+	{
+		kernels::Evaluate(VecDifference<T, N, Vec, E>(*this, expression.Self()), components);
+		return *this;
+	}
+
+	template <class T, int N>
+	Vec<T, N>&
+	Vec<T, N>::operator*=(T const& number)
+	{
+		kernels::Evaluate(VecScale<T, N, Vec>(*this, number), components);
+		return *this;
+	}
+
+	// https://www.andreaminini.org/matematica/spazio-vettoriale/prodotto-vettoriale-spazio
+	template <class T, int N>
+	Vec<T, N>
+	Vec<T, N>::Cross(Vec const& first, Vec const& second)
+	{
+		if (N != 3)
+		{
+			throw FPException("Invalid size");
+		}
+
+		// 1st component
+		//		| y1 y2 |
+		//  det	| z1 z2 |
+		// 2nd component
+		//		| x1 x2 |
+		// -det	| z1 z2 |
+		// 3rd component
+		//		| x1 x2 |
+		//	det | y1 y2 |
+		T components[N] = {};
+		memcpy(components, first.components, N * sizeof(T));
+
+		T det1 = components[1] * second.components[2];
+		det1 -= components[2] * second.components[1];
+		T det2 = components[0] * second.components[2];
+		det2 -= components[2] * second.components[0];
+		det2 *= T(true, 1, 0);
+		T det3 = components[0] * second.components[1];
+		det3 -= components[1] * second.components[0];
+
+		return Vec<T, N>{ det1, det2, det3 };
+	}
+
+	template <class T, int N>
+	T
+	Vec<T, N>::Angle(Vec const& first, Vec const& second)
+	{
+		Vec<T, N> a(first);
+		Vec<T, N> b(second);
+
+		// Compute the cosine of the angle between the 2 vectors
+		T cosine = a * b;					// Dot Product
+		cosine /= (a.Mod() * b.Mod());		// Divide by the product of the 2 vectors magnitude
+		if (cosine == T(false, 0))
+		{
+			// Angle between the 2 vectors is PI/2
+			return T::FromString("1.570796326");
+		}
+
+		// Compute the sine of the angle between the 2 vectors
+		T sine = T::Sqrt(T(false, 1, 0) - T::Pow(cosine, 2));
+
+		// Compute the tangent of the angle between the 2 vectors
+		T tangent = sine / cosine;
+
+		// Compute the arctan in order to get the angle between the 2 vectors.
+		// Use Taylor formula.
+		T res(false, 0);
+		for(uint8_t i = 0; i < 10; i++)
+		{
+			T val = T::Pow(tangent, (2 * i) + 1);
+			val /= T(((i % 2) == 0) ? false : true, (2 * i) + 1, 0);
+
+			res += val;
+		}
+
+		return res;
+	}
+
+	template <class T, int N>
+	T
+	Vec<T, N>::operator[](uint32_t index) const
+	{
+		if (index >= N)
+		{
+			throw FPException("Subscript out of range");
+		}
+
+		return components[index];
+	}
+
+	template <class T, int N>
+	bool
+	Vec<T, N>::operator==(Vec const& other) const
+	{
+		for(int i = 0; i < N; ++i)
+		{
+			if (components[i] != other.components[i])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template <class T, int N>
+	bool
+	Vec<T, N>::operator!=(Vec const& other) const
+	{
+		return !operator==(other);
+	}
+
+	template <class T, int N>
+	T
+	Vec<T, N>::Mod() const
+	{
+		T sum(false, 0);
+		for(int i = 0; i < N; ++i)
+		{
+			sum += T::Pow(components[i], 2);
+		}
+
+		return T::Sqrt(sum);
+	}
+
+	template <class T, int N>
+	Vec<T, N>
+	Vec<T, N>::Normalize() const
+	{
+		T mod = Mod();
+		Vec<T, N> res(*this);
+
+		for(auto& component : res.components)
+		{
+			component /= mod;
+		}
+
+		return res;
+	}
+
+	// Magnitudes of all the vectors (same results as Mod): the sums of squares
+	// are accumulated block by block and their square roots run as a batch.
+	template <class T, int N>
+	void
+	Vec<T, N>::Mod(Span<Vec const> vectors, Span<T> magnitudes)
+	{
+		if (vectors.Size() != magnitudes.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		T sums[kernels::BlockSize];
+		for(size_t i = 0; i < vectors.Size(); i += kernels::BlockSize)
+		{
+			size_t n = std::min(vectors.Size() - i, kernels::BlockSize);
+			for(size_t j = 0; j < n; j++)
+			{
+				T sum(false, 0);
+				for(int k = 0; k < N; ++k)
+				{
+					sum += T::Pow(vectors[i + j].components[k], 2);
+				}
+				sums[j] = sum;
+			}
+
+			T::Sqrt(Span<T const>(sums, n), Span<T>(magnitudes.Data() + i, n));
+		}
+	}
+
+	// Unit vectors of all the vectors (same results as Normalize)
+	template <class T, int N>
+	void
+	Vec<T, N>::Normalize(Span<Vec const> vectors, Span<Vec> normalized)
+	{
+		if (vectors.Size() != normalized.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		T magnitudes[kernels::BlockSize];
+		for(size_t i = 0; i < vectors.Size(); i += kernels::BlockSize)
+		{
+			size_t n = std::min(vectors.Size() - i, kernels::BlockSize);
+			Mod(Span<Vec const>(vectors.Data() + i, n), Span<T>(magnitudes, n));
+			for(size_t j = 0; j < n; j++)
+			{
+				Vec<T, N> res(vectors[i + j]);
+				for(auto& component : res.components)
+				{
+					component /= magnitudes[j];
+				}
+				normalized[i + j] = res;
+			}
+		}
+	}
+
+	// Appends a string literal to the buffer (Format helper)
+	static inline bool
+	FormatLiteral(char*& first, char* last, char const* text, size_t length)
+	{
+		if (static_cast<size_t>(last - first) < length)
+		{
+			return false;
+		}
+
+		::memcpy(first, text, length);
+		first += length;
+		return true;
+	}
+
+	template <class T, int N>
+	FormatResult
+	Vec<T, N>::Format(char* first, char* last) const
+	{
+		if (!first || (last < first) || !FormatLiteral(first, last, "(", 1))
+		{
+			return FormatResult{ last, std::errc::value_too_large };
+		}
+
+		for(int i = 0; i < N; i++)
+		{
+			FormatResult result = components[i].Format(first, last);
+			if (result.ec != std::errc())
+			{
+				return result;
+			}
+			first = result.ptr;
+			if ((i != (N - 1)) && !FormatLiteral(first, last, ", ", 2))
+			{
+				return FormatResult{ last, std::errc::value_too_large };
+			}
+		}
+
+		if (!FormatLiteral(first, last, ")", 1))
+		{
+			return FormatResult{ last, std::errc::value_too_large };
+		}
+
+		return FormatResult{ first, std::errc() };
+	}
+
+	template <class T, int N>
+	std::string
+	Vec<T, N>::ToString() const
+	{
+		char buffer[MaxFormatLength];
+		return std::string(buffer, Format(buffer, buffer + sizeof(buffer)).ptr);
+	}
+
+	// Vec3Medium and Vec4Medium: packed kernels (same results as the generic code)
+#if defined(SFPML_SSE2)
+	template <>
+	inline Vec<FixedPointMedium, 3>
+	Vec<FixedPointMedium, 3>::Cross(Vec const& first, Vec const& second)
+	{
+		Vec res(Uninitialized);
+		kernels::StorePacked<3>(kernels::CrossPacked(kernels::LoadPacked<3>(first.components), kernels::LoadPacked<3>(second.components)), res.components);
+		return res;
+	}
+
+	template <>
+	inline FixedPointMedium
+	Vec<FixedPointMedium, 3>::Mod() const
+	{
+		kernels::PackedVec v = kernels::LoadPacked<3>(components);
+		return FixedPointMedium::Sqrt(kernels::SumPacked<3>(kernels::MultiplyPacked(v, v)));
+	}
+
+	template <>
+	inline Vec<FixedPointMedium, 3>
+	Vec<FixedPointMedium, 3>::Normalize() const
+	{
+		FixedPointMedium mod = Mod();
+		if (static_cast<uint32_t>(mod) == 0)
+		{
+			throw FPException("Division by zero");
+		}
+
+		Vec res(Uninitialized);
+		kernels::StorePacked<3>(kernels::DividePacked(kernels::LoadPacked<3>(components), mod), res.components);
+		return res;
+	}
+
+	template <>
+	inline FixedPointMedium
+	Vec<FixedPointMedium, 4>::Mod() const
+	{
+		kernels::PackedVec v = kernels::LoadPacked<4>(components);
+		return FixedPointMedium::Sqrt(kernels::SumPacked<4>(kernels::MultiplyPacked(v, v)));
+	}
+
+	template <>
+	inline Vec<FixedPointMedium, 4>
+	Vec<FixedPointMedium, 4>::Normalize() const
+	{
+		FixedPointMedium mod = Mod();
+		if (static_cast<uint32_t>(mod) == 0)
+		{
+			throw FPException("Division by zero");
+		}
+
+		Vec res(Uninitialized);
+		kernels::StorePacked<4>(kernels::DividePacked(kernels::LoadPacked<4>(components), mod), res.components);
+		return res;
+	}
+#endif
+
+	// Helpers
+	typedef Vec<FixedPointSmall, 2> Vec2Small;
+	typedef Vec<FixedPointMedium, 2> Vec2Medium;
+	typedef Vec<FixedPointLarge, 2> Vec2Large;
+	typedef Vec<FixedPointSmall, 3> Vec3Small;
+	typedef Vec<FixedPointMedium, 3> Vec3Medium;
+	typedef Vec<FixedPointLarge, 3> Vec3Large;
+	typedef Vec<FixedPointSmall, 4> Vec4Small;
+	typedef Vec<FixedPointMedium, 4> Vec4Medium;
+	typedef Vec<FixedPointLarge, 4> Vec4Large;
+
+	static_assert(std::is_trivially_copyable<Vec4Small>::value && std::is_standard_layout<Vec4Small>::value, "Vec4Small must be trivially copyable and standard layout");
+	static_assert(std::is_trivially_copyable<Vec4Medium>::value && std::is_standard_layout<Vec4Medium>::value, "Vec4Medium must be trivially copyable and standard layout");
+	static_assert(std::is_trivially_copyable<Vec4Large>::value && std::is_standard_layout<Vec4Large>::value, "Vec4Large must be trivially copyable and standard layout");
+
+	// Matrix expressions
+	// Same scheme as the vector expressions: +, - and * (by a scalar) build nodes
+	// that are evaluated element by element when they are assigned to a Mat.
+	// The product of two matrices is computed immediately.
+
+	template <class T, int N>
+	class Mat;
+
+	template <class T, int N, class E>
+	class MatExpression
+	{
+	public:
+		E const& Self() const { return static_cast<E const&>(*this); }
+	};
+
+	template <class T, int N, class E>
+	using MatOperand = typename std::conditional<std::is_same<E, Mat<T, N>>::value, E const&, E const>::type;
+
+	template <class T, int N, class A, class B>
+	class MatSum : public MatExpression<T, N, MatSum<T, N, A, B>>
+	{
+		MatOperand<T, N, A> a;
+		MatOperand<T, N, B> b;
+
+	public:
+		MatSum(A const& a, B const& b) : a(a), b(b) {}
+
+		T Component(int row, int column) const { T x = a.Component(row, column); return x + b.Component(row, column); }
+	};
+
+	template <class T, int N, class A, class B>
+	class MatDifference : public MatExpression<T, N, MatDifference<T, N, A, B>>
+	{
+		MatOperand<T, N, A> a;
+		MatOperand<T, N, B> b;
+
+	public:
+		MatDifference(A const& a, B const& b) : a(a), b(b) {}
+
+		T Component(int row, int column) const { T x = a.Component(row, column); return x - b.Component(row, column); }
+	};
+
+	template <class T, int N, class A>
+	class MatScale : public MatExpression<T, N, MatScale<T, N, A>>
+	{
+		MatOperand<T, N, A> a;
+		T number;
+
+	public:
+		MatScale(A const& a, T const& number) : a(a), number(number) {}
+
+		T Component(int row, int column) const { T x = a.Component(row, column); return x * number; }
+	};
+
+	namespace kernels
+	{
+		template <class T, int N, class E>
+		inline void
+		Evaluate(MatExpression<T, N, E> const& expression, T (&components)[N][N])
+		{
+			for(int row = 0; row < N; ++row)
+			{
+				for(int column = 0; column < N; ++column)
+				{
+					components[row][column] = expression.Self().Component(row, column);
+				}
+			}
+		}
+	}
+
+	template <class T, int N, class A, class B>
+	inline MatSum<T, N, A, B>
+	operator+(MatExpression<T, N, A> const& a, MatExpression<T, N, B> const& b)
+	{
+		return MatSum<T, N, A, B>(a.Self(), b.Self());
+	}
+
+	template <class T, int N, class A, class B>
+	inline MatDifference<T, N, A, B>
+	operator-(MatExpression<T, N, A> const& a, MatExpression<T, N, B> const& b)
+	{
+		return MatDifference<T, N, A, B>(a.Self(), b.Self());
+	}
+
+	template <class T, int N, class A>
+	inline MatScale<T, N, A>
+	operator*(MatExpression<T, N, A> const& a, T const& number)
+	{
+		return MatScale<T, N, A>(a.Self(), number);
+	}
+
+	// Matrices
+	template <class T>
+	class DynMat;
+
+	// Row and column views
+	// Non-owning views of the components of a row (Stride 1) or of a column (Stride N)
+	// of a matrix: operator[] checks the index, Component does not, and both give
+	// the component itself (writable through the views of a non-const matrix).
+	// The views are vector expressions: they are used by the Vec operators without
+	// copies, and the views of a non-const matrix can be assigned a vector expression
+	// (evaluated first, so it can read the same matrix). A view must not outlive its
+	// matrix. The read-only Vec members work on a Vec copy of the components.
+	template <class T, int N, int Stride, class E>
+	class MatVector : public VecExpression<T, N, MatVector<T, N, Stride, E>>
+	{
+		E* first;
+
+	public:
+		explicit MatVector(E* first) : first(first) {}
+		MatVector(MatVector const&) = default;
+
+		MatVector const& operator=(MatVector const&) const;
+		template <class X>
+		MatVector const& operator=(VecExpression<T, N, X> const&) const;
+		E& operator[](uint32_t) const;
+		bool operator==(Vec<T, N> const& other) const { return Vec<T, N>(*this) == other; }
+		bool operator!=(Vec<T, N> const& other) const { return Vec<T, N>(*this) != other; }
+		T Mod() const { return Vec<T, N>(*this).Mod(); }
+		Vec<T, N> Normalize() const { return Vec<T, N>(*this).Normalize(); }
+		std::string ToString() const { return Vec<T, N>(*this).ToString(); }
+		FormatResult Format(char* start, char* last) const { return Vec<T, N>(*this).Format(start, last); }
+
+		E& Component(int index) const { return first[index * Stride]; }
+#if defined(SFPML_SSE2)
+		// Vec3Medium and Vec4Medium only
+		kernels::PackedVec
+		Packed() const
+		{
+			T values[N];
+			for(int i = 0; i < N; ++i)
+			{
+				values[i] = first[i * Stride];
+			}
+			return kernels::LoadPacked<N>(values);
+		}
+#endif
+	};
+
+	template <class T, int N>
+	using MatRow = MatVector<T, N, 1, T>;
+	template <class T, int N>
+	using MatConstRow = MatVector<T, N, 1, T const>;
+	template <class T, int N>
+	using MatColumn = MatVector<T, N, N, T>;
+	template <class T, int N>
+	using MatConstColumn = MatVector<T, N, N, T const>;
+
+	template <class T, int N, int Stride, class E>
+	MatVector<T, N, Stride, E> const&
+	MatVector<T, N, Stride, E>::operator=(MatVector const& other) const
+	{
+		return operator=(static_cast<VecExpression<T, N, MatVector> const&>(other));
+	}
+
+	template <class T, int N, int Stride, class E>
+	template <class X>
+	MatVector<T, N, Stride, E> const&
+	MatVector<T, N, Stride, E>::operator=(VecExpression<T, N, X> const& expression) const
+	{
+		T values[N];
+		kernels::Evaluate(expression, values);
+		for(int i = 0; i < N; ++i)
+		{
+			first[i * Stride] = values[i];
+		}
+
+		return *this;
+	}
+
+	template <class T, int N, int Stride, class E>
+	E&
+	MatVector<T, N, Stride, E>::operator[](uint32_t index) const
+	{
+		if (index >= N)
+		{
+			throw FPException("Subscript out of range");
+		}
+
+		return first[index * Stride];
+	}
+
+	template <class T, int N>
+	static T Det(typename std::enable_if<N == 2, Mat<T, N>>::type const&);
+	template <class T, int N>
+	static T Det(typename std::enable_if<N == 3, Mat<T, N>>::type const&);
+	template <class T, int N>
+	static T Det(typename std::enable_if<N == 4, Mat<T, N>>::type const&);
+	template <class T, int N>
+	static T Det(typename std::enable_if<(N > 4), Mat<T, N>>::type const&);
+	template <class T, int N>
+	static bool Inv(typename std::enable_if<N == 2, Mat<T, N>>::type const&, T (&)[N][N]);
+	template <class T, int N>
+	static bool Inv(typename std::enable_if<N == 3, Mat<T, N>>::type const&, T (&)[N][N]);
+	template <class T, int N>
+	static bool Inv(typename std::enable_if<N == 4, Mat<T, N>>::type const&, T (&)[N][N]);
+	template <class T, int N>
+	static bool Inv(typename std::enable_if<(N > 4), Mat<T, N>>::type const&, T (&)[N][N]);
+
+	template <class T, int N>
+	class Mat : public MatExpression<T, N, Mat<T, N>>
+	{
+		T components[N][N];
+
+		template <std::size_t... I>
+		Mat(UninitializedTag tag, std::index_sequence<I...>) : components{ (static_cast<void>(I), T(tag))... } {}
+
+		template <class U, int M>
+		friend class Mat;
+		template <class U>
+		friend class DynMat;
+
+	public:
+		Mat(bool = false);
+		explicit Mat(UninitializedTag tag) : Mat(tag, std::make_index_sequence<N * N>()) {}
+		Mat(std::initializer_list<T>);
+		Mat(std::vector<T> const&);
+		template <class E>
+		Mat(MatExpression<T, N, E> const&);
+
+		template <class E>
+		Mat& operator=(MatExpression<T, N, E> const&);
+		template <class E>
+		Mat& operator+=(MatExpression<T, N, E> const&);
+		template <class E>
+		Mat& operator-=(MatExpression<T, N, E> const&);
+		Mat& operator*=(T const&);
+		template <class E>
+		Mat& operator*=(MatExpression<T, N, E> const&);
+		static Mat Multiply(Mat const&, Mat const&);
+		MatRow<T, N> operator[](uint32_t);
+		MatConstRow<T, N> operator[](uint32_t) const;
+		MatRow<T, N> Row(int row) { return MatRow<T, N>(components[row]); }
+		MatConstRow<T, N> Row(int row) const { return MatConstRow<T, N>(components[row]); }
+		MatColumn<T, N> Column(int column) { return MatColumn<T, N>(&components[0][column]); }
+		MatConstColumn<T, N> Column(int column) const { return MatConstColumn<T, N>(&components[0][column]); }
+		bool operator==(Mat const&) const;
+		bool operator!=(Mat const&) const;
+
+		Mat<T, N - 1> ExtractMatrix(uint8_t, uint8_t);
+		Mat CoFactorMatrix();
+		T Det() const;
+		void Inv();
+		void InvAffine();
+		void Transpose();
+		static Mat Inv(Mat const&);
+		static Mat InvAffine(Mat const&);
+		static Mat Transpose(Mat const&);
+		Vec<T, N> Solve(Vec<T, N> const&) const;
+		std::string ToString() const;
+		FormatResult Format(char*, char*) const;
+
+		// Unchecked access for the expression templates
+		T const& Component(int row, int column) const { return components[row][column]; }
+
+		// Longest text written by Format: [(a, b, ...), (c, d, ...), ...]
+		enum { MaxFormatLength = 2 + (N * Vec<T, N>::MaxFormatLength) + ((N - 1) * 2) };
+	};
+
+	template <class T, int N>
+	Mat<T, N>::Mat(bool toIdentity)
+	: components()
+	{
+		if (toIdentity)
+		{
+			for(int row = 0; row < N; row++)
+			{
+				for(int column = 0; column < N; column++)
+				{
+					if (row == column)
+					{
+						components[row][column] = T(false, 1, 0);
+					}
+				}
+			}
+		}
+	}
+
+	template <class T, int N>
+	Mat<T, N>::Mat(std::initializer_list<T> list)
+	: Mat()
+	{
+		if (list.size() > (N * N))
+		{
+			throw(FPException("Invalid size"));
+		}
+
+		int row = 0;
+		int column = 0;
+		for(auto const& elem : list)
+		{
+			components[row][column++] = elem;
+			if (column >= N)
+			{
+				++row;
+				column = 0;
+			}
+		}
+	}
+
+	template <class T, int N>
+	Mat<T, N>::Mat(std::vector<T> const& values)
+	: Mat()
+	{
+		if (values.size() > (N * N))
+		{
+			throw(FPException("Invalid size"));
+		}
+
+		int row = 0;
+		int column = 0;
+		for(auto const& elem : values)
+		{
+			components[row][column++] = elem;
+			if (column >= N)
+			{
+				++row;
+				column = 0;
+			}
+		}
+	}
+
+	template <class T, int N>
+	template <class E>
+	Mat<T, N>::Mat(MatExpression<T, N, E> const& expression)
+	: Mat(Uninitialized)
+	{
+		kernels::Evaluate(expression, components);
+	}
+
+	template <class T, int N>
+	template <class E>
+	Mat<T, N>&
+	Mat<T, N>::operator=(MatExpression<T, N, E> const& expression)
+	{
+		kernels::Evaluate(expression, components);
+		return *this;
+	}
+
+	template <class T, int N>
+	template <class E>
+	Mat<T, N>&
+	Mat<T, N>::operator+=(MatExpression<T, N, E> const& expression)
+	{
+		kernels::Evaluate(MatSum<T, N, Mat, E>(*this, expression.Self()), components);
+		return *this;
+	}
+
+	template <class T, int N>
+	template <class E>
+	Mat<T, N>&
+	Mat<T, N>::operator-=(MatExpression<T, N, E> const& expression)
+	{
+		kernels::Evaluate(MatDifference<T, N, Mat, E>(*this, expression.Self()), components);
+		return *this;
+	}
+
+	template <class T, int N>
+	Mat<T, N>&
+	Mat<T, N>::operator*=(T const& value)
+	{
+		kernels::Evaluate(MatScale<T, N, Mat>(*this, value), components);
+		return *this;
+	}
+
+	template <class T, int N>
+	template <class E>
+	Mat<T, N>&
+	Mat<T, N>::operator*=(MatExpression<T, N, E> const& expression)
+	{
+		Mat<T, N> const& other = expression.Self();
+		*this = Multiply(*this, other);
+		return *this;
+	}
+
+	// Row per column product kernels
+	// Every element is the sum (from +0, in the order of the index) of the FixedPoint
+	// products of a row by a column. The 2x2, 3x3 and 4x4 loops have constant bounds
+	// and are unrolled; Mat3x3Medium and Mat4x4Medium compute a row of the product at
+	// a time on packed lanes (each element of the row of a broadcast and multiplied
+	// by a row of b), with the same results.
+
+	namespace kernels
+	{
+		template <class T, int N>
+		inline void
+		Multiply(T const (&a)[N][N], T const (&b)[N][N], T (&c)[N][N])
+		{
+			for(int row = 0; row < N; row++)
+			{
+				for(int column = 0; column < N; column++)
+				{
+					T sum(false, 0, 0);
+					for(int index = 0; index < N; index++)
+					{
+						T x = a[row][index];
+						sum += x * b[index][column];
+					}
+					c[row][column] = sum;
+				}
+			}
+		}
+
+#if defined(SFPML_SSE2)
+		template <int N>
+		inline void
+		MultiplyMatPacked(FixedPointMedium const (&a)[N][N], FixedPointMedium const (&b)[N][N], FixedPointMedium (&c)[N][N])
+		{
+			PackedVec rows[N];
+			for(int index = 0; index < N; index++)
+			{
+				rows[index] = LoadPacked<N>(b[index]);
+			}
+			for(int row = 0; row < N; row++)
+			{
+				PackedVec sum{ _mm_setzero_si128(), _mm_setzero_si128() };
+				for(int index = 0; index < N; index++)
+				{
+					sum = AddPacked(sum, MultiplyPacked(BroadcastPacked(a[row][index]), rows[index]));
+				}
+				StorePacked<N>(sum, c[row]);
+			}
+		}
+
+		inline void
+		Multiply(FixedPointMedium const (&a)[3][3], FixedPointMedium const (&b)[3][3], FixedPointMedium (&c)[3][3])
+		{
+			MultiplyMatPacked<3>(a, b, c);
+		}
+
+		inline void
+		Multiply(FixedPointMedium const (&a)[4][4], FixedPointMedium const (&b)[4][4], FixedPointMedium (&c)[4][4])
+		{
+			MultiplyMatPacked<4>(a, b, c);
+		}
+#endif
+	}
+
+	template <class T, int N>
+	Mat<T, N>
+	Mat<T, N>::Multiply(Mat const& first, Mat const& second)
+	{
+		Mat<T, N> result(Uninitialized);
+		kernels::Multiply(first.components, second.components, result.components);
+
+		return result;
+	}
+
+	// Row per column product; the operands are evaluated first if they are expressions
+	template <class T, int N, class A, class B>
+	inline Mat<T, N>
+	operator*(MatExpression<T, N, A> const& a, MatExpression<T, N, B> const& b)
+	{
+		Mat<T, N> const& first = a.Self();
+		Mat<T, N> const& second = b.Self();
+		return Mat<T, N>::Multiply(first, second);
+	}
+
+	// Matrix by vector product
+	// Every component is the dot product of a row by the vector (same operators
+	// and order as Vec operator*); the product is computed immediately, so the
+	// vector can be the destination (v = m * v).
+
+	template <class T, int N, class A, class B>
+	class MatVecProduct : public VecExpression<T, N, MatVecProduct<T, N, A, B>>
+	{
+		A const& m;
+		B const& v;
+
+	public:
+		MatVecProduct(A const& m, B const& v) : m(m), v(v) {}
+
+		T
+		Component(int row) const
+		{
+			T sum(false, 0);
+			for(int column = 0; column < N; ++column)
+			{
+				T x = m.Component(row, column);
+				sum += (x * v.Component(column));
+			}
+
+			return sum;
+		}
+#if defined(SFPML_SSE2)
+		kernels::PackedVec
+		Packed() const
+		{
+			kernels::PackedVec columns[4];
+			kernels::LoadColumnsPacked<N>(&m.Component(0, 0), columns);
+			return kernels::TransformPacked<N>(columns, v.Packed());
+		}
+#endif
+	};
+
+	template <class T, int N, class A, class B>
+	inline Vec<T, N>
+	operator*(MatExpression<T, N, A> const& a, VecExpression<T, N, B> const& b)
+	{
+		Mat<T, N> const& m = a.Self();
+		Vec<T, N> const& v = b.Self();
+		return Vec<T, N>(MatVecProduct<T, N, Mat<T, N>, Vec<T, N>>(m, v));
+	}
+
+	// Batch transform of points (homogeneous coordinates)
+	// Every point p gives (x, y, z, w) = m * (p, 1) and the result is
+	// (x / w, y / w, z / w), with the FixedPoint operators (the same results as
+	// those operators one point at a time). The points with w == 0 give (0, 0, 0)
+	// and are reported once all the points have been transformed.
+	// Q16.16 points run 4 at a time on SSE2 lanes (x, y, z and w of 4 points);
+	// large sets are split between the worker threads.
+
+	namespace kernels
+	{
+		const size_t TransformGrain = 4096;
+
+		template <class T>
+		inline unsigned
+		TransformPoints(Mat<T, 4> const& m, Vec<T, 3> const* points, Vec<T, 3>* transformed, size_t count)
+		{
+			unsigned errors = 0;
+			for(size_t i = 0; i < count; i++)
+			{
+				Vec<T, 4> point{ points[i].Component(0), points[i].Component(1), points[i].Component(2), T(false, 1, 0) };
+				Vec<T, 4> h = m * point;
+				T w = h[3];
+				if (static_cast<typename T::Number>(w).value.fixedPoint == 0)
+				{
+					errors |= DivisionByZeroFlag;
+					transformed[i] = Vec<T, 3>();
+					continue;
+				}
+
+				T x = h[0];
+				T y = h[1];
+				T z = h[2];
+				transformed[i] = Vec<T, 3>{ x / w, y / w, z / w };
+			}
+			return errors;
+		}
+
+#if defined(SFPML_SSE2)
+		inline unsigned
+		TransformPoints(Mat<FixedPointMedium, 4> const& m, Vec<FixedPointMedium, 3> const* points, Vec<FixedPointMedium, 3>* transformed, size_t count)
+		{
+			const __m128i one = _mm_set1_epi32(1 << 16);
+
+			// Matrix elements broadcast to all the lanes
+			PackedVec elements[4][4];
+			for(int row = 0; row < 4; row++)
+			{
+				for(int column = 0; column < 4; column++)
+				{
+					elements[row][column] = BroadcastPacked(m.Component(row, column));
+				}
+			}
+
+			unsigned errors = 0;
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				// Vec is standard layout: its address is the address of its components
+				PackedVec lanes[4];
+				for(int k = 0; k < 4; k++)
+				{
+					lanes[k] = LoadPacked<3>(reinterpret_cast<FixedPointMedium const*>(points + i + k));
+				}
+				TransposePacked(lanes);
+				lanes[3] = PackedVec{ _mm_setzero_si128(), one };
+
+				// Rows by (x, y, z, 1), added in the order of the dot product
+				PackedVec h[4];
+				for(int row = 0; row < 4; row++)
+				{
+					PackedVec sum{ _mm_setzero_si128(), _mm_setzero_si128() };
+					for(int column = 0; column < 4; column++)
+					{
+						sum = AddPacked(sum, MultiplyPacked(elements[row][column], lanes[column]));
+					}
+					h[row] = sum;
+				}
+
+				// Division by w (skipped when every w is +1, x / 1 == x)
+				__m128i zero = _mm_cmpeq_epi32(h[3].magnitudes, _mm_setzero_si128());
+				__m128i unit = _mm_andnot_si128(h[3].signs, _mm_cmpeq_epi32(h[3].magnitudes, one));
+				if (_mm_movemask_epi8(unit) != 0xFFFF)
+				{
+					PackedVec w{ h[3].signs, Select(zero, one, h[3].magnitudes) };
+					for(int k = 0; k < 3; k++)
+					{
+						h[k] = DivideLanesPacked(h[k], w);
+						h[k].signs = _mm_andnot_si128(zero, h[k].signs);
+						h[k].magnitudes = _mm_andnot_si128(zero, h[k].magnitudes);
+					}
+					if (_mm_movemask_epi8(zero))
+					{
+						errors |= DivisionByZeroFlag;
+					}
+				}
+
+				h[3] = PackedVec{ _mm_setzero_si128(), _mm_setzero_si128() };
+				TransposePacked(h);
+				for(int k = 0; k < 4; k++)
+				{
+					StorePacked<3>(h[k], reinterpret_cast<FixedPointMedium*>(transformed + i + k));
+				}
+			}
+
+			return errors | TransformPoints<FixedPointMedium>(m, points + i, transformed + i, count - i);
+		}
+#endif
+	}
+
+	template <class T>
+	void
+	TransformPoints(Mat<T, 4> const& m, Span<Vec<T, 3> const> points, Span<Vec<T, 3>> transformed)
+	{
+		if (points.Size() != transformed.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		Vec<T, 3> const* source = points.Data();
+		Vec<T, 3>* destination = transformed.Data();
+		kernels::ThrowErrors(kernels::ParallelFor(points.Size(), kernels::TransformGrain, [&m, source, destination](size_t first, size_t last)
+		{
+			return kernels::TransformPoints(m, source + first, destination + first, last - first);
+		}));
+	}
+
+	// Batch products (e.g. the transforms of a scene graph): product[i] = a[i] * b[i],
+	// with the Mat product kernels; the destination can be one of the operands.
+	// Large sets are split between the worker threads.
+
+	namespace kernels
+	{
+		const size_t MultiplyGrain = 1024;
+	}
+
+	template <class T, int N>
+	void
+	MultiplyMany(Span<Mat<T, N> const> a, Span<Mat<T, N> const> b, Span<Mat<T, N>> product)
+	{
+		if ((a.Size() != b.Size()) || (a.Size() != product.Size()))
+		{
+			throw FPException("Invalid size");
+		}
+
+		Mat<T, N> const* first = a.Data();
+		Mat<T, N> const* second = b.Data();
+		Mat<T, N>* destination = product.Data();
+		kernels::ParallelFor(a.Size(), kernels::MultiplyGrain, [first, second, destination](size_t begin, size_t end)
+		{
+			for(size_t i = begin; i < end; i++)
+			{
+				destination[i] = Mat<T, N>::Multiply(first[i], second[i]);
+			}
+			return 0u;
+		});
+	}
+
+	template <class T, int N>
+	MatRow<T, N>
+	Mat<T, N>::operator[](uint32_t row)
+	{
+		if (row >= N)
+		{
+			throw FPException("Subscript out of range");
+		}
+
+		return MatRow<T, N>(components[row]);
+	}
+
+	template <class T, int N>
+	MatConstRow<T, N>
+	Mat<T, N>::operator[](uint32_t row) const
+	{
+		if (row >= N)
+		{
+			throw FPException("Subscript out of range");
+		}
+
+		return MatConstRow<T, N>(components[row]);
+	}
+	
+	template <class T, int N>
+	bool
+	Mat<T, N>::operator==(Mat const& other) const
+	{
+		for(int row = 0; row < N; ++row)
+		{
+			for(int column = 0; column < N; ++column)
+			{
+				if (components[row][column] != other.components[row][column])
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	template <class T, int N>
+	bool
+	Mat<T, N>::operator!=(Mat const& other) const
+	{
+		return !operator==(other);
+	}
+
+	template <class T, int N>
+	T
+	Mat<T, N>::Det() const
+	{
+		return sfpmlib::Det<T, N>(*this);
+	}
+
+	template <class T, int N>
+	Mat<T, N - 1>
+	Mat<T, N>::ExtractMatrix(uint8_t row, uint8_t column)
+	{
+		if (N <= 2)
+		{
+			throw FPException("Invalid size");
+		}
+
+		Mat<T, N - 1> values(Uninitialized);
+		for(uint8_t i = 0, k = 0; i < N; i++)
+		{
+			if (i == row)
+			{
+				continue;
+			}
+			for(uint8_t j = 0, l = 0; j < N; j++)
+			{
+				if (j != column)
+				{
+					values.components[k][l++] = components[i][j];
+				}
+			}
+			k++;
+		}
+
+		return values;
+	}
+
+	template <class T, int N>
+	Mat<T, N>
+	Mat<T, N>::CoFactorMatrix()
+	{
+		Mat<T, N> values(Uninitialized);
+		for(uint8_t row = 0; row < N; row++)
+		{
+			for(uint8_t column = 0; column < N; column++)
+			{
+				T coeff((((row + column) % 2) == 0) ? false : true, 1, 0);
+				Mat<T, N - 1> c(ExtractMatrix(row, column));
+				
+				values.components[row][column] = coeff * c.Det();
+			}
+		}
+
+		return values;
+	}
+
+	template <class T, int N>
+	void
+	Mat<T, N>::Inv()
+	{
+		*this = Inv(*this);
+	}
+
+	template <class T, int N>
+	Mat<T, N>
+	Mat<T, N>::Inv(Mat const& m)
+	{
+		// Computed aside, so nothing is written to the destination when it throws
+		T inverse[N][N];
+		if (!sfpmlib::Inv<T, N>(m, inverse))
+		{
+			throw FPException("Determinant equal to 0");
+		}
+
+		Mat<T, N> result(Uninitialized);
+		std::copy(&inverse[0][0], &inverse[0][0] + (N * N), &result.components[0][0]);
+		return result;
+	}
+
+	template <class T, int N>
+	void
+	Mat<T, N>::InvAffine()
+	{
+		*this = InvAffine(*this);
+	}
+
+	// Rigid transform (orthonormal rotation block, translation in the last column,
+	// last row 0 ... 0 1): the inverse rotation is the transposed block and the
+	// inverse translation is -transposed(R) * t. Nothing is checked.
+	template <class T, int N>
+	Mat<T, N>
+	Mat<T, N>::InvAffine(Mat const& m)
+	{
+		Mat<T, N> result(Uninitialized);
+		for(int row = 0; row < (N - 1); row++)
+		{
+			T translation(false, 0, 0);
+			for(int column = 0; column < (N - 1); column++)
+			{
+				T x = m.components[column][row];
+				result.components[row][column] = x;
+				translation -= x * m.components[column][N - 1];
+			}
+			result.components[row][N - 1] = translation;
+			result.components[N - 1][row] = T(false, 0, 0);
+		}
+		result.components[N - 1][N - 1] = T(false, 1, 0);
+
+		return result;
+	}
+
+	template <class T, int N>
+	void
+	Mat<T, N>::Transpose()
+	{
+		Mat<T, N> result(Uninitialized);
+
+		for(int row = 0; row < N; row++)
+		{
+			for(int column = 0; column < N; column++)
+			{
+				result.components[column][row] = components[row][column];
+			}
+		}
+
+		*this = result;
+	}
+
+	template <class T, int N>
+	Mat<T, N>
+	Mat<T, N>::Transpose(Mat const& m)
+	{
+		Mat<T, N> result(m);
+		result.Transpose();
+
+		return result;
+	}
+
+	template <class T, int N>
+	FormatResult
+	Mat<T, N>::Format(char* first, char* last) const
+	{
+		if (!first || (last < first) || !FormatLiteral(first, last, "[", 1))
+		{
+			return FormatResult{ last, std::errc::value_too_large };
+		}
+
+		for(int row = 0; row < N; row++)
+		{
+			if (!FormatLiteral(first, last, "(", 1))
+			{
+				return FormatResult{ last, std::errc::value_too_large };
+			}
+			for(int column = 0; column < N; column++)
+			{
+				FormatResult result = components[row][column].Format(first, last);
+				if (result.ec != std::errc())
+				{
+					return result;
+				}
+				first = result.ptr;
+				if ((column != (N - 1)) && !FormatLiteral(first, last, ", ", 2))
+				{
+					return FormatResult{ last, std::errc::value_too_large };
+				}
+			}
+			if (!FormatLiteral(first, last, ")", 1))
+			{
+				return FormatResult{ last, std::errc::value_too_large };
+			}
+			if ((row != (N - 1)) && !FormatLiteral(first, last, ", ", 2))
+			{
+				return FormatResult{ last, std::errc::value_too_large };
+			}
+		}
+
+		if (!FormatLiteral(first, last, "]", 1))
+		{
+			return FormatResult{ last, std::errc::value_too_large };
+		}
+
+		return FormatResult{ first, std::errc() };
+	}
+
+	template <class T, int N>
+	std::string
+	Mat<T, N>::ToString() const
+	{
+		char buffer[MaxFormatLength];
+		return std::string(buffer, Format(buffer, buffer + sizeof(buffer)).ptr);
+	}
+
+	// SFINAE
+	template <class T, int N>
+	static T
+	Det(typename std::enable_if<N == 2, Mat<T, N>>::type const& m)
+	{
+		T a = m.Component(0, 0);
+		T b = m.Component(0, 1);
+		return a * m.Component(1, 1) - b * m.Component(1, 0);
+	}
+
+	// x multiplied by the cofactor sign (+1 or -1): the product only changes the sign
+	// (of zero too), so it is done without the multiplication
+	template <class T>
+	static T
+	Signed(T const& x, bool negative)
+	{
+		typename T::Number number = x;
+		number.sign = (number.sign != negative);
+		return T(number);
+	}
+
+	// Cofactor expansion of a 3x3 determinant over its 1st row (a, b, c), given the
+	// 2x2 determinants of the other 2 rows: the same operations, in the same order,
+	// as the Laplace expansion, so the unrolled determinants give the same results.
+	template <class T>
+	static T
+	Laplace3(T a, T b, T c, T const& bc, T const& ac, T const& ab)
+	{
+		T result(false, 0, 0);
+		result += a * bc;
+		result += Signed(b, true) * ac;
+		result += c * ab;
+
+		return result;
+	}
+
+	// 2x2 determinant of the columns i and j of 2 rows
+	template <class T, int N>
+	static T
+	Det2(Mat<T, N> const& m, int first, int second, int i, int j)
+	{
+		T a = m.Component(first, i);
+		T b = m.Component(first, j);
+		return a * m.Component(second, j) - b * m.Component(second, i);
+	}
+
+	template <class T, int N>
+	static T
+	Det(typename std::enable_if<N == 3, Mat<T, N>>::type const& m)
+	{
+		return Laplace3(m.Component(0, 0), m.Component(0, 1), m.Component(0, 2), Det2(m, 1, 2, 1, 2), Det2(m, 1, 2, 0, 2), Det2(m, 1, 2, 0, 1));
+	}
+
+	// The 3x3 minors of the 1st row share the 6 2x2 determinants of the last 2 rows
+	template <class T, int N>
+	static T
+	Det(typename std::enable_if<N == 4, Mat<T, N>>::type const& m)
+	{
+		T d01 = Det2(m, 2, 3, 0, 1);
+		T d02 = Det2(m, 2, 3, 0, 2);
+		T d03 = Det2(m, 2, 3, 0, 3);
+		T d12 = Det2(m, 2, 3, 1, 2);
+		T d13 = Det2(m, 2, 3, 1, 3);
+		T d23 = Det2(m, 2, 3, 2, 3);
+
+		T m10 = m.Component(1, 0);
+		T m11 = m.Component(1, 1);
+		T m12 = m.Component(1, 2);
+		T m13 = m.Component(1, 3);
+		T minors[4] = { Laplace3(m11, m12, m13, d23, d13, d12), Laplace3(m10, m12, m13, d23, d03, d02),
+						Laplace3(m10, m11, m13, d13, d03, d01), Laplace3(m10, m11, m12, d12, d02, d01) };
+
+		T result(false, 0, 0);
+		for(int i = 0; i < 4; i++)
+		{
+			result += Signed(m.Component(0, i), (i % 2) != 0) * minors[i];
+		}
+
+		return result;
+	}
+
+	// LU decomposition with partial pivoting (in place, on a copy of the components):
+	// the determinant is the product of the pivots, negated for an odd number of
+	// row swaps.
+	template <class T, int N>
+	static T
+	Det(typename std::enable_if<(N > 4), Mat<T, N>>::type const& m)
+	{
+		T lu[N][N];
+		for(int row = 0; row < N; row++)
+		{
+			for(int column = 0; column < N; column++)
+			{
+				lu[row][column] = m.Component(row, column);
+			}
+		}
+
+		T result(false, 1, 0);
+		bool negative = false;
+		for(int k = 0; k < N; k++)
+		{
+			// Pivot: largest magnitude of the column
+			int pivot = k;
+			for(int row = k + 1; row < N; row++)
+			{
+				if (static_cast<typename T::Number>(lu[row][k]).value.fixedPoint > static_cast<typename T::Number>(lu[pivot][k]).value.fixedPoint)
+				{
+					pivot = row;
+				}
+			}
+			if (static_cast<typename T::Number>(lu[pivot][k]).value.fixedPoint == 0)
+			{
+				return T(false, 0, 0);
+			}
+			if (pivot != k)
+			{
+				for(int column = k; column < N; column++)
+				{
+					std::swap(lu[k][column], lu[pivot][column]);
+				}
+				negative = !negative;
+			}
+
+			for(int row = k + 1; row < N; row++)
+			{
+				T factor = lu[row][k] / lu[k][k];
+				for(int column = k + 1; column < N; column++)
+				{
+					lu[row][column] -= factor * lu[k][column];
+				}
+			}
+			result *= lu[k][k];
+		}
+
+		return Signed(result, negative);
+	}
+
+	// Inverses: the closed forms (2x2, 3x3, 4x4) are the transposed cofactor matrix
+	// scaled by 1 / det, with the same operations as CoFactorMatrix and Det
+
+	// Cofactors scaled by 1 / det into the transposed positions
+	template <class T, int N>
+	static void
+	Adjugate(T const (&minors)[N][N], T const& det, T (&result)[N][N])
+	{
+		T invDet = T(false, 1, 0) / det;
+		for(int row = 0; row < N; row++)
+		{
+			for(int column = 0; column < N; column++)
+			{
+				result[column][row] = Signed(minors[row][column], ((row + column) % 2) != 0) * invDet;
+			}
+		}
+	}
+
+	template <class T, int N>
+	static bool
+	Inv(typename std::enable_if<N == 2, Mat<T, N>>::type const& m, T (&result)[N][N])
+	{
+		T det = Det<T, N>(m);
+		if (static_cast<typename T::Number>(det).value.fixedPoint == 0)
+		{
+			return false;
+		}
+
+		T minors[2][2] = { { m.Component(1, 1), m.Component(1, 0) }, { m.Component(0, 1), m.Component(0, 0) } };
+		Adjugate(minors, det, result);
+
+		return true;
+	}
+
+	template <class T, int N>
+	static bool
+	Inv(typename std::enable_if<N == 3, Mat<T, N>>::type const& m, T (&result)[N][N])
+	{
+		T minors[3][3];
+		for(int row = 0; row < 3; row++)
+		{
+			int first = (row == 0) ? 1 : 0;
+			int second = (row == 2) ? 1 : 2;
+			for(int column = 0; column < 3; column++)
+			{
+				minors[row][column] = Det2(m, first, second, (column == 0) ? 1 : 0, (column == 2) ? 1 : 2);
+			}
+		}
+
+		T det = Laplace3(m.Component(0, 0), m.Component(0, 1), m.Component(0, 2), minors[0][0], minors[0][1], minors[0][2]);
+		if (static_cast<typename T::Number>(det).value.fixedPoint == 0)
+		{
+			return false;
+		}
+
+		Adjugate(minors, det, result);
+
+		return true;
+	}
+
+	// The 3x3 minors are expanded over their 1st row: the 2x2 determinants of their
+	// last 2 rows (rows 2-3, 1-3 or 1-2) are computed once for the 6 column pairs
+	template <class T, int N>
+	static bool
+	Inv(typename std::enable_if<N == 4, Mat<T, N>>::type const& m, T (&result)[N][N])
+	{
+		static int const pairs[4][4] = { { -1, 0, 1, 2 }, { 0, -1, 3, 4 }, { 1, 3, -1, 5 }, { 2, 4, 5, -1 } };
+		static int const rows[4][3] = { { 1, 2, 3 }, { 0, 2, 3 }, { 0, 1, 3 }, { 0, 1, 2 } };
+
+		T d[3][6];
+		for(int k = 0; k < 3; k++)
+		{
+			int first = rows[(k == 0) ? 0 : (k + 1)][1];
+			int second = rows[(k == 0) ? 0 : (k + 1)][2];
+			for(int i = 0; i < 4; i++)
+			{
+				for(int j = i + 1; j < 4; j++)
+				{
+					d[k][pairs[i][j]] = Det2(m, first, second, i, j);
+				}
+			}
+		}
+
+		T minors[4][4];
+		for(int row = 0; row < 4; row++)
+		{
+			// Pair of the last 2 rows of the minor: 2-3 for the rows 0 and 1, then 1-3 and 1-2
+			T const* pair = d[(row < 2) ? 0 : (row - 1)];
+			int first = rows[row][0];
+			for(int column = 0; column < 4; column++)
+			{
+				int c0 = rows[column][0];
+				int c1 = rows[column][1];
+				int c2 = rows[column][2];
+				minors[row][column] = Laplace3(m.Component(first, c0), m.Component(first, c1), m.Component(first, c2), pair[pairs[c1][c2]], pair[pairs[c0][c2]], pair[pairs[c0][c1]]);
+			}
+		}
+
+		T det(false, 0, 0);
+		for(int i = 0; i < 4; i++)
+		{
+			det += Signed(m.Component(0, i), (i % 2) != 0) * minors[0][i];
+		}
+		if (static_cast<typename T::Number>(det).value.fixedPoint == 0)
+		{
+			return false;
+		}
+
+		Adjugate(minors, det, result);
+
+		return true;
+	}
+
+	// Gauss-Jordan elimination with partial pivoting (on a copy of the components)
+	template <class T, int N>
+	static bool
+	Inv(typename std::enable_if<(N > 4), Mat<T, N>>::type const& m, T (&result)[N][N])
+	{
+		T a[N][N];
+		for(int row = 0; row < N; row++)
+		{
+			for(int column = 0; column < N; column++)
+			{
+				a[row][column] = m.Component(row, column);
+				result[row][column] = T(false, (row == column) ? 1 : 0, 0);
+			}
+		}
+
+		for(int k = 0; k < N; k++)
+		{
+			// Pivot: largest magnitude of the column
+			int pivot = k;
+			for(int row = k + 1; row < N; row++)
+			{
+				if (static_cast<typename T::Number>(a[row][k]).value.fixedPoint > static_cast<typename T::Number>(a[pivot][k]).value.fixedPoint)
+				{
+					pivot = row;
+				}
+			}
+			if (static_cast<typename T::Number>(a[pivot][k]).value.fixedPoint == 0)
+			{
+				return false;
+			}
+			if (pivot != k)
+			{
+				for(int column = 0; column < N; column++)
+				{
+					std::swap(a[k][column], a[pivot][column]);
+					std::swap(result[k][column], result[pivot][column]);
+				}
+			}
+
+			for(int row = 0; row < N; row++)
+			{
+				if (row == k)
+				{
+					continue;
+				}
+				T factor = a[row][k] / a[k][k];
+				for(int column = k; column < N; column++)
+				{
+					a[row][column] -= factor * a[k][column];
+				}
+				for(int column = 0; column < N; column++)
+				{
+					result[row][column] -= factor * result[k][column];
+				}
+			}
+		}
+
+		// The rows are divided by their pivots last: no rounding in the elimination factors
+		for(int row = 0; row < N; row++)
+		{
+			for(int column = 0; column < N; column++)
+			{
+				result[row][column] = result[row][column] / a[row][row];
+			}
+		}
+
+		return true;
+	}
+
+	// Batch inverses and determinants (the same results as Inv and Det). Q16.16 3x3 and
+	// 4x4 matrices run 4 at a time, one matrix per SSE2 lane: the matrices are transposed
+	// to structure of arrays (every register holds the same component of 4 matrices),
+	// so the closed forms run unchanged on the lanes. Singular matrices do not throw:
+	// their inverse is the zero matrix and their element of the mask is set.
+
+	namespace kernels
+	{
+		template <class T, int N>
+		inline unsigned
+		InvMatrices(Mat<T, N> const* m, Mat<T, N>* inverse, bool* singular, size_t count)
+		{
+			unsigned flags = 0;
+			for(size_t i = 0; i < count; i++)
+			{
+				// Local result: the destination can be the source
+				T result[N][N];
+				singular[i] = !sfpmlib::Inv<T, N>(m[i], result);
+				if (singular[i])
+				{
+					flags |= DivisionByZeroFlag;
+					inverse[i] = Mat<T, N>();
+					continue;
+				}
+				std::copy(&result[0][0], &result[0][0] + (N * N), reinterpret_cast<T*>(inverse + i));
+			}
+			return flags;
+		}
+
+		template <class T, int N>
+		inline void
+		DetMatrices(Mat<T, N> const* m, T* det, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				det[i] = sfpmlib::Det<T, N>(m[i]);
+			}
+		}
+
+#if defined(SFPML_SSE2)
+		// lanes[row][column]: the component of the 4 matrices (Mat is standard layout,
+		// its address is the address of its components)
+		template <int N>
+		inline void
+		LoadLanes(Mat<FixedPointMedium, N> const* m, PackedVec (&lanes)[N][N])
+		{
+			for(int row = 0; row < N; row++)
+			{
+				PackedVec rows[4];
+				for(int i = 0; i < 4; i++)
+				{
+					rows[i] = LoadPacked<N>(reinterpret_cast<FixedPointMedium const*>(m + i) + (row * N));
+				}
+				TransposePacked(rows);
+				for(int column = 0; column < N; column++)
+				{
+					lanes[row][column] = rows[column];
+				}
+			}
+		}
+
+		template <int N>
+		inline void
+		StoreLanes(PackedVec const (&lanes)[N][N], Mat<FixedPointMedium, N>* m)
+		{
+			for(int row = 0; row < N; row++)
+			{
+				PackedVec columns[4];
+				for(int column = 0; column < 4; column++)
+				{
+					columns[column] = (column < N) ? lanes[row][column] : PackedVec{ _mm_setzero_si128(), _mm_setzero_si128() };
+				}
+				TransposePacked(columns);
+				for(int i = 0; i < 4; i++)
+				{
+					StorePacked<N>(columns[i], reinterpret_cast<FixedPointMedium*>(m + i) + (row * N));
+				}
+			}
+		}
+
+		// Signed
+		inline PackedVec
+		SignedPacked(PackedVec const& x, bool negative)
+		{
+			return negative ? PackedVec{ _mm_xor_si128(x.signs, _mm_set1_epi32(-1)), x.magnitudes } : x;
+		}
+
+		// Laplace3
+		inline PackedVec
+		Laplace3Packed(PackedVec const& a, PackedVec const& b, PackedVec const& c, PackedVec const& bc, PackedVec const& ac, PackedVec const& ab)
+		{
+			PackedVec result{ _mm_setzero_si128(), _mm_setzero_si128() };
+			result = AddPacked(result, MultiplyPacked(a, bc));
+			result = AddPacked(result, MultiplyPacked(SignedPacked(b, true), ac));
+			result = AddPacked(result, MultiplyPacked(c, ab));
+			return result;
+		}
+
+		// Det2
+		template <int N>
+		inline PackedVec
+		Det2Packed(PackedVec const (&m)[N][N], int first, int second, int i, int j)
+		{
+			return SubtractPacked(MultiplyPacked(m[first][i], m[second][j]), MultiplyPacked(m[first][j], m[second][i]));
+		}
+
+		// Det<T, 3>
+		inline PackedVec
+		DetPacked(PackedVec const (&m)[3][3])
+		{
+			return Laplace3Packed(m[0][0], m[0][1], m[0][2], Det2Packed(m, 1, 2, 1, 2), Det2Packed(m, 1, 2, 0, 2), Det2Packed(m, 1, 2, 0, 1));
+		}
+
+		// Det<T, 4>
+		inline PackedVec
+		DetPacked(PackedVec const (&m)[4][4])
+		{
+			PackedVec d01 = Det2Packed(m, 2, 3, 0, 1);
+			PackedVec d02 = Det2Packed(m, 2, 3, 0, 2);
+			PackedVec d03 = Det2Packed(m, 2, 3, 0, 3);
+			PackedVec d12 = Det2Packed(m, 2, 3, 1, 2);
+			PackedVec d13 = Det2Packed(m, 2, 3, 1, 3);
+			PackedVec d23 = Det2Packed(m, 2, 3, 2, 3);
+			PackedVec minors[4] = { Laplace3Packed(m[1][1], m[1][2], m[1][3], d23, d13, d12), Laplace3Packed(m[1][0], m[1][2], m[1][3], d23, d03, d02),
+									Laplace3Packed(m[1][0], m[1][1], m[1][3], d13, d03, d01), Laplace3Packed(m[1][0], m[1][1], m[1][2], d12, d02, d01) };
+
+			PackedVec result{ _mm_setzero_si128(), _mm_setzero_si128() };
+			for(int i = 0; i < 4; i++)
+			{
+				result = AddPacked(result, MultiplyPacked(SignedPacked(m[0][i], (i % 2) != 0), minors[i]));
+			}
+			return result;
+		}
+
+		// Minors and determinant of Inv<T, 3>
+		inline PackedVec
+		MinorsPacked(PackedVec const (&m)[3][3], PackedVec (&minors)[3][3])
+		{
+			for(int row = 0; row < 3; row++)
+			{
+				int first = (row == 0) ? 1 : 0;
+				int second = (row == 2) ? 1 : 2;
+				for(int column = 0; column < 3; column++)
+				{
+					minors[row][column] = Det2Packed(m, first, second, (column == 0) ? 1 : 0, (column == 2) ? 1 : 2);
+				}
+			}
+			return Laplace3Packed(m[0][0], m[0][1], m[0][2], minors[0][0], minors[0][1], minors[0][2]);
+		}
+
+		// Minors and determinant of Inv<T, 4>
+		inline PackedVec
+		MinorsPacked(PackedVec const (&m)[4][4], PackedVec (&minors)[4][4])
+		{
+			static int const pairs[4][4] = { { -1, 0, 1, 2 }, { 0, -1, 3, 4 }, { 1, 3, -1, 5 }, { 2, 4, 5, -1 } };
+			static int const rows[4][3] = { { 1, 2, 3 }, { 0, 2, 3 }, { 0, 1, 3 }, { 0, 1, 2 } };
+
+			PackedVec d[3][6];
+			for(int k = 0; k < 3; k++)
+			{
+				int first = rows[(k == 0) ? 0 : (k + 1)][1];
+				int second = rows[(k == 0) ? 0 : (k + 1)][2];
+				for(int i = 0; i < 4; i++)
+				{
+					for(int j = i + 1; j < 4; j++)
+					{
+						d[k][pairs[i][j]] = Det2Packed(m, first, second, i, j);
+					}
+				}
+			}
+
+			for(int row = 0; row < 4; row++)
+			{
+				PackedVec const* pair = d[(row < 2) ? 0 : (row - 1)];
+				int first = rows[row][0];
+				for(int column = 0; column < 4; column++)
+				{
+					int c0 = rows[column][0];
+					int c1 = rows[column][1];
+					int c2 = rows[column][2];
+					minors[row][column] = Laplace3Packed(m[first][c0], m[first][c1], m[first][c2], pair[pairs[c1][c2]], pair[pairs[c0][c2]], pair[pairs[c0][c1]]);
+				}
+			}
+
+			PackedVec det{ _mm_setzero_si128(), _mm_setzero_si128() };
+			for(int i = 0; i < 4; i++)
+			{
+				det = AddPacked(det, MultiplyPacked(SignedPacked(m[0][i], (i % 2) != 0), minors[0][i]));
+			}
+			return det;
+		}
+
+		// 4 matrices: Adjugate on the lanes, the singular lanes give the zero matrix
+		template <int N>
+		inline unsigned
+		InvPacked(Mat<FixedPointMedium, N> const* m, Mat<FixedPointMedium, N>* inverse, bool* singular)
+		{
+			PackedVec lanes[N][N];
+			PackedVec minors[N][N];
+			LoadLanes(m, lanes);
+			PackedVec det = MinorsPacked(lanes, minors);
+
+			__m128i zero = _mm_cmpeq_epi32(det.magnitudes, _mm_setzero_si128());
+			PackedVec one{ _mm_setzero_si128(), _mm_set1_epi32(0x10000) };
+			PackedVec invDet = DivideLanesPacked(one, PackedVec{ _mm_andnot_si128(zero, det.signs), Select(zero, one.magnitudes, det.magnitudes) });
+			for(int row = 0; row < N; row++)
+			{
+				for(int column = 0; column < N; column++)
+				{
+					PackedVec x = MultiplyPacked(SignedPacked(minors[row][column], ((row + column) % 2) != 0), invDet);
+					lanes[column][row] = PackedVec{ _mm_andnot_si128(zero, x.signs), _mm_andnot_si128(zero, x.magnitudes) };
+				}
+			}
+			StoreLanes(lanes, inverse);
+
+			int mask = _mm_movemask_ps(_mm_castsi128_ps(zero));
+			for(int i = 0; i < 4; i++)
+			{
+				singular[i] = ((mask >> i) & 1) != 0;
+			}
+			return (mask != 0) ? DivisionByZeroFlag : 0;
+		}
+
+		template <int N>
+		inline unsigned
+		InvMatricesPacked(Mat<FixedPointMedium, N> const* m, Mat<FixedPointMedium, N>* inverse, bool* singular, size_t count)
+		{
+			unsigned flags = 0;
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				flags |= InvPacked<N>(m + i, inverse + i, singular + i);
+			}
+			return flags | InvMatrices<FixedPointMedium, N>(m + i, inverse + i, singular + i, count - i);
+		}
+
+		inline unsigned
+		InvMatrices(Mat<FixedPointMedium, 3> const* m, Mat<FixedPointMedium, 3>* inverse, bool* singular, size_t count)
+		{
+			return InvMatricesPacked<3>(m, inverse, singular, count);
+		}
+
+		inline unsigned
+		InvMatrices(Mat<FixedPointMedium, 4> const* m, Mat<FixedPointMedium, 4>* inverse, bool* singular, size_t count)
+		{
+			return InvMatricesPacked<4>(m, inverse, singular, count);
+		}
+
+		template <int N>
+		inline void
+		DetMatricesPacked(Mat<FixedPointMedium, N> const* m, FixedPointMedium* det, size_t count)
+		{
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				PackedVec lanes[N][N];
+				LoadLanes(m + i, lanes);
+				StorePacked<4>(DetPacked(lanes), det + i);
+			}
+			DetMatrices<FixedPointMedium, N>(m + i, det + i, count - i);
+		}
+
+		inline void
+		DetMatrices(Mat<FixedPointMedium, 3> const* m, FixedPointMedium* det, size_t count)
+		{
+			DetMatricesPacked<3>(m, det, count);
+		}
+
+		inline void
+		DetMatrices(Mat<FixedPointMedium, 4> const* m, FixedPointMedium* det, size_t count)
+		{
+			DetMatricesPacked<4>(m, det, count);
+		}
+#endif
+	}
+
+	// inverse[i] = m[i]^-1 (the destination can be the source); singular[i] is set for
+	// the singular matrices (zero inverse). Returns true when there is at least one.
+	template <class T, int N>
+	bool
+	InvMany(Span<Mat<T, N> const> m, Span<Mat<T, N>> inverse, Span<bool> singular)
+	{
+		if ((m.Size() != inverse.Size()) || (m.Size() != singular.Size()))
+		{
+			throw FPException("Invalid size");
+		}
+
+		Mat<T, N> const* source = m.Data();
+		Mat<T, N>* destination = inverse.Data();
+		bool* mask = singular.Data();
+		unsigned flags = kernels::ParallelFor(m.Size(), kernels::MultiplyGrain, [source, destination, mask](size_t first, size_t last)
+		{
+			return kernels::InvMatrices(source + first, destination + first, mask + first, last - first);
+		});
+		return flags != 0;
+	}
+
+	// det[i] = det(m[i]) (0 for the singular matrices)
+	template <class T, int N>
+	void
+	DetMany(Span<Mat<T, N> const> m, Span<T> det)
+	{
+		if (m.Size() != det.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		Mat<T, N> const* source = m.Data();
+		T* destination = det.Data();
+		kernels::ParallelFor(m.Size(), kernels::MultiplyGrain, [source, destination](size_t first, size_t last)
+		{
+			kernels::DetMatrices(source + first, destination + first, last - first);
+			return 0u;
+		});
+	}
+
+	// Helpers
+	typedef Mat<FixedPointSmall, 2> Mat2x2Small;
+	typedef Mat<FixedPointMedium, 2> Mat2x2Medium;
+	typedef Mat<FixedPointLarge, 2> Mat2x2Large;
+	typedef Mat<FixedPointSmall, 3> Mat3x3Small;
+	typedef Mat<FixedPointMedium, 3> Mat3x3Medium;
+	typedef Mat<FixedPointLarge, 3> Mat3x3Large;
+	typedef Mat<FixedPointSmall, 4> Mat4x4Small;
+	typedef Mat<FixedPointMedium, 4> Mat4x4Medium;
+	typedef Mat<FixedPointLarge, 4> Mat4x4Large;
+
+	static_assert(std::is_trivially_copyable<Mat4x4Small>::value && std::is_standard_layout<Mat4x4Small>::value, "Mat4x4Small must be trivially copyable and standard layout");
+	static_assert(std::is_trivially_copyable<Mat4x4Medium>::value && std::is_standard_layout<Mat4x4Medium>::value, "Mat4x4Medium must be trivially copyable and standard layout");
+	static_assert(std::is_trivially_copyable<Mat4x4Large>::value && std::is_standard_layout<Mat4x4Large>::value, "Mat4x4Large must be trivially copyable and standard layout");
+
+	// Dynamic size matrices
+	// Components on the heap, row major, for sizes known at run time (hundreds to
+	// thousands of rows). Mat<T, N> blocks can be read and written with Block and
+	// SetBlock.
+	// The product adds the FixedPoint products (magnitudes truncated as by operator*)
+	// in a wide signed accumulator (64 bits, 128 bits for Q32.32): the sums are
+	// exact, so the result does not depend on the order of the additions, the cache
+	// blocks, the SIMD lanes or the thread count. It is the Mat product whenever no
+	// partial sum overflows (a zero result is +0; larger sums wrap as the FixedPoint
+	// magnitudes do).
+	// Q8.8 and Q16.16 products run on cache blocks packed for the SSE2/AVX2 kernels
+	// (4x4 tiles of 64 bits accumulators); the row blocks are split between the
+	// worker threads.
+
+	namespace kernels
+	{
+		const size_t ProductRowBlock = 64;
+		const size_t ProductColumnBlock = 256;
+		const size_t ProductDepthBlock = 256;
+
+		// Exact sum of FixedPoint products
+		template <typename T>
+		struct ProductSum
+		{
+			static const int F = sizeof(typename FixedPoint<T>::FractionalPart) * 8;
+
+			int64_t sum = 0;
+
+			void
+			Add(FixedPoint<T> const& a, FixedPoint<T> const& b)
+			{
+				typename FixedPoint<T>::Number x = a;
+				typename FixedPoint<T>::Number y = b;
+				int64_t product = static_cast<int64_t>(static_cast<T>((static_cast<uint64_t>(x.value.fixedPoint) * y.value.fixedPoint) >> F));
+				sum += (x.sign != y.sign) ? -product : product;
+			}
+
+			FixedPoint<T>
+			Result() const
+			{
+				T magnitude = static_cast<T>((sum < 0) ? (0 - static_cast<uint64_t>(sum)) : static_cast<uint64_t>(sum));
+				return FixedPoint<T>((sum < 0) && magnitude, magnitude);
+			}
+		};
+
+		// Q32.32: 128 bits (two's complement high and low words)
+		template <>
+		struct ProductSum<uint64_t>
+		{
+			uint64_t high = 0;
+			uint64_t low = 0;
+
+			void
+			Add(FixedPointLarge const& a, FixedPointLarge const& b)
+			{
+				FixedPointLarge::Number x = a;
+				FixedPointLarge::Number y = b;
+				uint64_t productHigh;
+				uint64_t productLow;
+				MultiplyWide(x.value.fixedPoint, y.value.fixedPoint, productHigh, productLow);
+				uint64_t product = (productHigh << 32) | (productLow >> 32);
+				if (x.sign != y.sign)
+				{
+					high -= (low < product) ? 1 : 0;
+					low -= product;
+				}
+				else
+				{
+					low += product;
+					high += (low < product) ? 1 : 0;
+				}
+			}
+
+			FixedPointLarge
+			Result() const
+			{
+				bool negative = (static_cast<int64_t>(high) < 0);
+				uint64_t magnitude = negative ? (0 - low) : low;
+				return FixedPointLarge(negative && magnitude, magnitude);
+			}
+		};
+
+		// Rows [first, last) of a * b (k x n), row by row
+		template <typename T>
+		inline unsigned
+		MultiplyRows(FixedPoint<T> const* a, FixedPoint<T> const* b, FixedPoint<T>* c, size_t first, size_t last, size_t k, size_t n)
+		{
+			std::vector<ProductSum<T>> sums(n);
+			for(size_t row = first; row < last; row++)
+			{
+				std::fill(sums.begin(), sums.end(), ProductSum<T>());
+				for(size_t i = 0; i < k; i++)
+				{
+					FixedPoint<T> x = a[(row * k) + i];
+					FixedPoint<T> const* line = b + (i * n);
+					for(size_t column = 0; column < n; column++)
+					{
+						sums[column].Add(x, line[column]);
+					}
+				}
+				for(size_t column = 0; column < n; column++)
+				{
+					c[(row * n) + column] = sums[column].Result();
+				}
+			}
+			return 0;
+		}
+
+		// Packed operand: the magnitude in the low 32 bits, the upper 32 bits all
+		// ones for a negative value (ignored by the 32 x 32 => 64 bits products)
+		template <typename T>
+		inline uint64_t
+		PackOperand(FixedPoint<T> const& x)
+		{
+			typename FixedPoint<T>::Number number = x;
+			return number.value.fixedPoint | (number.sign ? 0xFFFFFFFF00000000ull : 0);
+		}
+
+		// 4x4 tile: c[r][j] += sum over i of a[i][r] * b[i][j] (4 values per depth step)
+		template <int F>
+		inline void
+		ProductTileScalar(size_t depth, uint64_t const* a, uint64_t const* b, int64_t* c, size_t stride)
+		{
+			const uint64_t mask = (1ull << (2 * F)) - 1;
+			int64_t sums[4][4] = {};
+			for(size_t i = 0; i < depth; i++, a += 4, b += 4)
+			{
+				for(int r = 0; r < 4; r++)
+				{
+					for(int j = 0; j < 4; j++)
+					{
+						int64_t product = static_cast<int64_t>((((a[r] & 0xFFFFFFFF) * (b[j] & 0xFFFFFFFF)) >> F) & mask);
+						sums[r][j] += ((a[r] ^ b[j]) >> 63) ? -product : product;
+					}
+				}
+			}
+			for(int r = 0; r < 4; r++)
+			{
+				for(int j = 0; j < 4; j++)
+				{
+					c[(r * stride) + j] += sums[r][j];
+				}
+			}
+		}
+
+#if defined(SFPML_SSE2)
+		template <int F>
+		inline void
+		ProductTileSse2(size_t depth, uint64_t const* a, uint64_t const* b, int64_t* c, size_t stride)
+		{
+			const __m128i mask = _mm_set1_epi64x(static_cast<int64_t>((1ull << (2 * F)) - 1));
+			__m128i sums[4][2];
+			for(int r = 0; r < 4; r++)
+			{
+				sums[r][0] = _mm_setzero_si128();
+				sums[r][1] = _mm_setzero_si128();
+			}
+			for(size_t i = 0; i < depth; i++, a += 4, b += 4)
+			{
+				__m128i columns[2] = { _mm_loadu_si128(reinterpret_cast<__m128i const*>(b)), _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + 2)) };
+				for(int r = 0; r < 4; r++)
+				{
+					__m128i x = _mm_set1_epi64x(static_cast<int64_t>(a[r]));
+					for(int h = 0; h < 2; h++)
+					{
+						// Truncated magnitude, negated (two's complement) when the signs differ
+						__m128i product = _mm_and_si128(_mm_srli_epi64(_mm_mul_epu32(x, columns[h]), F), mask);
+						__m128i negative = _mm_shuffle_epi32(_mm_xor_si128(x, columns[h]), _MM_SHUFFLE(3, 3, 1, 1));
+						sums[r][h] = _mm_add_epi64(sums[r][h], _mm_sub_epi64(_mm_xor_si128(product, negative), negative));
+					}
+				}
+			}
+			for(int r = 0; r < 4; r++)
+			{
+				for(int h = 0; h < 2; h++)
+				{
+					__m128i* destination = reinterpret_cast<__m128i*>(c + (r * stride) + (2 * h));
+					_mm_storeu_si128(destination, _mm_add_epi64(_mm_loadu_si128(destination), sums[r][h]));
+				}
+			}
+		}
+
+		template <int F>
+		SFPML_TARGET("avx2")
+		inline void
+		ProductTileAvx2(size_t depth, uint64_t const* a, uint64_t const* b, int64_t* c, size_t stride)
+		{
+			const __m256i mask = _mm256_set1_epi64x(static_cast<int64_t>((1ull << (2 * F)) - 1));
+			__m256i sums[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+			for(size_t i = 0; i < depth; i++, a += 4, b += 4)
+			{
+				__m256i columns = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b));
+				for(int r = 0; r < 4; r++)
+				{
+					__m256i x = _mm256_set1_epi64x(static_cast<int64_t>(a[r]));
+					__m256i product = _mm256_and_si256(_mm256_srli_epi64(_mm256_mul_epu32(x, columns), F), mask);
+					__m256i negative = _mm256_shuffle_epi32(_mm256_xor_si256(x, columns), _MM_SHUFFLE(3, 3, 1, 1));
+					sums[r] = _mm256_add_epi64(sums[r], _mm256_sub_epi64(_mm256_xor_si256(product, negative), negative));
+				}
+			}
+			for(int r = 0; r < 4; r++)
+			{
+				__m256i* destination = reinterpret_cast<__m256i*>(c + (r * stride));
+				_mm256_storeu_si256(destination, _mm256_add_epi64(_mm256_loadu_si256(destination), sums[r]));
+			}
+		}
+
+		template <int F>
+		inline void
+		ProductTile(size_t depth, uint64_t const* a, uint64_t const* b, int64_t* c, size_t stride)
+		{
+			static void (* const table[])(size_t, uint64_t const*, uint64_t const*, int64_t*, size_t) = { ProductTileScalar<F>, ProductTileSse2<F>, ProductTileAvx2<F>, ProductTileAvx2<F> };
+			table[Level()](depth, a, b, c, stride);
+		}
+#else
+		template <int F>
+		inline void
+		ProductTile(size_t depth, uint64_t const* a, uint64_t const* b, int64_t* c, size_t stride)
+		{
+			ProductTileScalar<F>(depth, a, b, c, stride);
+		}
+#endif
+
+		// Rows [first, last) of a * b (k x n) on cache blocks: rows of a by columns
+		// of b by depth, both packed in 4 wide panels (padded with zeros)
+		template <typename T>
+		inline unsigned
+		MultiplyRowsPacked(FixedPoint<T> const* a, FixedPoint<T> const* b, FixedPoint<T>* c, size_t first, size_t last, size_t k, size_t n)
+		{
+			const int F = sizeof(typename FixedPoint<T>::FractionalPart) * 8;
+			std::vector<uint64_t> packedA(ProductRowBlock * ProductDepthBlock);
+			std::vector<uint64_t> packedB(ProductDepthBlock * ProductColumnBlock);
+			std::vector<int64_t> sums(ProductRowBlock * ProductColumnBlock);
+
+			for(size_t row = first; row < last; row += ProductRowBlock)
+			{
+				size_t rows = std::min(ProductRowBlock, last - row);
+				size_t panelRows = (rows + 3) & ~size_t(3);
+				for(size_t column = 0; column < n; column += ProductColumnBlock)
+				{
+					size_t columns = std::min(ProductColumnBlock, n - column);
+					size_t panelColumns = (columns + 3) & ~size_t(3);
+					std::fill(sums.begin(), sums.end(), 0);
+					for(size_t i = 0; i < k; i += ProductDepthBlock)
+					{
+						size_t depth = std::min(ProductDepthBlock, k - i);
+						for(size_t r = 0; r < panelRows; r++)
+						{
+							uint64_t* panel = packedA.data() + ((r / 4) * depth * 4) + (r % 4);
+							for(size_t d = 0; d < depth; d++)
+							{
+								panel[d * 4] = (r < rows) ? PackOperand(a[((row + r) * k) + i + d]) : 0;
+							}
+						}
+						for(size_t d = 0; d < depth; d++)
+						{
+							FixedPoint<T> const* line = b + ((i + d) * n) + column;
+							for(size_t j = 0; j < panelColumns; j++)
+							{
+								packedB[((j / 4) * depth * 4) + (d * 4) + (j % 4)] = (j < columns) ? PackOperand(line[j]) : 0;
+							}
+						}
+
+						for(size_t j = 0; j < panelColumns; j += 4)
+						{
+							for(size_t r = 0; r < panelRows; r += 4)
+							{
+								ProductTile<F>(depth, packedA.data() + (r * depth), packedB.data() + (j * depth), sums.data() + (r * ProductColumnBlock) + j, ProductColumnBlock);
+							}
+						}
+					}
+
+					for(size_t r = 0; r < rows; r++)
+					{
+						for(size_t j = 0; j < columns; j++)
+						{
+							ProductSum<T> sum;
+							sum.sum = sums[(r * ProductColumnBlock) + j];
+							c[((row + r) * n) + column + j] = sum.Result();
+						}
+					}
+				}
+			}
+			return 0;
+		}
+
+		inline unsigned
+		MultiplyRows(FixedPointSmall const* a, FixedPointSmall const* b, FixedPointSmall* c, size_t first, size_t last, size_t k, size_t n)
+		{
+			return MultiplyRowsPacked(a, b, c, first, last, k, n);
+		}
+
+		inline unsigned
+		MultiplyRows(FixedPointMedium const* a, FixedPointMedium const* b, FixedPointMedium* c, size_t first, size_t last, size_t k, size_t n)
+		{
+			return MultiplyRowsPacked(a, b, c, first, last, k, n);
+		}
+	}
+
+	template <class T>
+	class DynMat
+	{
+		size_t rows;
+		size_t columns;
+		std::vector<T> components;
+
+	public:
+		DynMat() : rows(0), columns(0) {}
+		DynMat(size_t, size_t, bool = false);
+		template <int N>
+		explicit DynMat(Mat<T, N> const&);
+
+		size_t Rows() const { return rows; }
+		size_t Columns() const { return columns; }
+		T* Data() { return components.data(); }
+		T const* Data() const { return components.data(); }
+
+		// Unchecked access
+		T& operator()(size_t row, size_t column) { return components[(row * columns) + column]; }
+		T const& operator()(size_t row, size_t column) const { return components[(row * columns) + column]; }
+		// Checked access
+		T& At(size_t, size_t);
+		T const& At(size_t, size_t) const;
+
+		template <int N>
+		Mat<T, N> Block(size_t, size_t) const;
+		template <int N>
+		void SetBlock(size_t, size_t, Mat<T, N> const&);
+
+		DynMat& operator+=(DynMat const&);
+		DynMat& operator-=(DynMat const&);
+		DynMat& operator*=(T const&);
+		DynMat operator+(DynMat const&) const;
+		DynMat operator-(DynMat const&) const;
+		DynMat operator*(T const&) const;
+		DynMat operator*(DynMat const&) const;
+		bool operator==(DynMat const&) const;
+		bool operator!=(DynMat const&) const;
+
+		static DynMat Multiply(DynMat const&, DynMat const&);
+		static DynMat Transpose(DynMat const&);
+		DynMat Solve(DynMat const&) const;
+		std::string ToString() const;
+		FormatResult Format(char*, char*) const;
+	};
+
+	template <class T>
+	DynMat<T>::DynMat(size_t rows, size_t columns, bool toIdentity)
+	: rows(rows), columns(columns), components(rows * columns)
+	{
+		if (toIdentity)
+		{
+			for(size_t i = 0; (i < rows) && (i < columns); i++)
+			{
+				components[(i * columns) + i] = T(false, 1, 0);
+			}
+		}
+	}
+
+	template <class T>
+	template <int N>
+	DynMat<T>::DynMat(Mat<T, N> const& m)
+	: DynMat(N, N)
+	{
+		SetBlock(0, 0, m);
+	}
+
+	template <class T>
+	T&
+	DynMat<T>::At(size_t row, size_t column)
+	{
+		if ((row >= rows) || (column >= columns))
+		{
+			throw FPException("Subscript out of range");
+		}
+
+		return components[(row * columns) + column];
+	}
+
+	template <class T>
+	T const&
+	DynMat<T>::At(size_t row, size_t column) const
+	{
+		if ((row >= rows) || (column >= columns))
+		{
+			throw FPException("Subscript out of range");
+		}
+
+		return components[(row * columns) + column];
+	}
+
+	template <class T>
+	template <int N>
+	Mat<T, N>
+	DynMat<T>::Block(size_t row, size_t column) const
+	{
+		if (((row + N) > rows) || ((column + N) > columns))
+		{
+			throw FPException("Invalid size");
+		}
+
+		Mat<T, N> result(Uninitialized);
+		for(int i = 0; i < N; i++)
+		{
+			for(int j = 0; j < N; j++)
+			{
+				result.components[i][j] = components[((row + i) * columns) + column + j];
+			}
+		}
+
+		return result;
+	}
+
+	template <class T>
+	template <int N>
+	void
+	DynMat<T>::SetBlock(size_t row, size_t column, Mat<T, N> const& m)
+	{
+		if (((row + N) > rows) || ((column + N) > columns))
+		{
+			throw FPException("Invalid size");
+		}
+
+		for(int i = 0; i < N; i++)
+		{
+			for(int j = 0; j < N; j++)
+			{
+				components[((row + i) * columns) + column + j] = m.Component(i, j);
+			}
+		}
+	}
+
+	template <class T>
+	DynMat<T>&
+	DynMat<T>::operator+=(DynMat const& other)
+	{
+		if ((rows != other.rows) || (columns != other.columns))
+		{
+			throw FPException("Invalid size");
+		}
+
+		for(size_t i = 0; i < components.size(); i++)
+		{
+			components[i] += other.components[i];
+		}
+
+		return *this;
+	}
+
+	template <class T>
+	DynMat<T>&
+	DynMat<T>::operator-=(DynMat const& other)
+	{
+		if ((rows != other.rows) || (columns != other.columns))
+		{
+			throw FPException("Invalid size");
+		}
+
+		for(size_t i = 0; i < components.size(); i++)
+		{
+			components[i] -= other.components[i];
+		}
+
+		return *this;
+	}
+
+	template <class T>
+	DynMat<T>&
+	DynMat<T>::operator*=(T const& number)
+	{
+		for(auto& component : components)
+		{
+			component *= number;
+		}
+
+		return *this;
+	}
+
+	template <class T>
+	DynMat<T>
+	DynMat<T>::operator+(DynMat const& other) const
+	{
+		DynMat<T> result(*this);
+		result += other;
+
+		return result;
+	}
+
+	template <class T>
+	DynMat<T>
+	DynMat<T>::operator-(DynMat const& other) const
+	{
+		DynMat<T> result(*this);
+		result -= other;
+
+		return result;
+	}
+
+	template <class T>
+	DynMat<T>
+	DynMat<T>::operator*(T const& number) const
+	{
+		DynMat<T> result(*this);
+		result *= number;
+
+		return result;
+	}
+
+	template <class T>
+	DynMat<T>
+	DynMat<T>::operator*(DynMat const& other) const
+	{
+		return Multiply(*this, other);
+	}
+
+	template <class T>
+	bool
+	DynMat<T>::operator==(DynMat const& other) const
+	{
+		return (rows == other.rows) && (columns == other.columns) && (components == other.components);
+	}
+
+	template <class T>
+	bool
+	DynMat<T>::operator!=(DynMat const& other) const
+	{
+		return !operator==(other);
+	}
+
+	template <class T>
+	DynMat<T>
+	DynMat<T>::Multiply(DynMat const& a, DynMat const& b)
+	{
+		if (a.columns != b.rows)
+		{
+			throw FPException("Invalid size");
+		}
+
+		DynMat<T> result(a.rows, b.columns);
+		T const* first = a.components.data();
+		T const* second = b.components.data();
+		T* destination = result.components.data();
+		size_t k = a.columns;
+		size_t n = b.columns;
+		kernels::ParallelFor(a.rows, kernels::ProductRowBlock, [first, second, destination, k, n](size_t begin, size_t end)
+		{
+			return kernels::MultiplyRows(first, second, destination, begin, end, k, n);
+		});
+
+		return result;
+	}
+
+	template <class T>
+	DynMat<T>
+	DynMat<T>::Transpose(DynMat const& m)
+	{
+		DynMat<T> result(m.columns, m.rows);
+		for(size_t row = 0; row < m.rows; row++)
+		{
+			for(size_t column = 0; column < m.columns; column++)
+			{
+				result.components[(column * m.rows) + row] = m.components[(row * m.columns) + column];
+			}
+		}
+
+		return result;
+	}
+
+	template <class T>
+	FormatResult
+	DynMat<T>::Format(char* first, char* last) const
+	{
+		if (!first || (last < first) || !FormatLiteral(first, last, "[", 1))
+		{
+			return FormatResult{ last, std::errc::value_too_large };
+		}
+
+		for(size_t row = 0; row < rows; row++)
+		{
+			if (!FormatLiteral(first, last, "(", 1))
+			{
+				return FormatResult{ last, std::errc::value_too_large };
+			}
+			for(size_t column = 0; column < columns; column++)
+			{
+				FormatResult result = components[(row * columns) + column].Format(first, last);
+				if (result.ec != std::errc())
+				{
+					return result;
+				}
+				first = result.ptr;
+				if ((column != (columns - 1)) && !FormatLiteral(first, last, ", ", 2))
+				{
+					return FormatResult{ last, std::errc::value_too_large };
+				}
+			}
+			if (!FormatLiteral(first, last, ")", 1))
+			{
+				return FormatResult{ last, std::errc::value_too_large };
+			}
+			if ((row != (rows - 1)) && !FormatLiteral(first, last, ", ", 2))
+			{
+				return FormatResult{ last, std::errc::value_too_large };
+			}
+		}
+
+		if (!FormatLiteral(first, last, "]", 1))
+		{
+			return FormatResult{ last, std::errc::value_too_large };
+		}
+
+		return FormatResult{ first, std::errc() };
+	}
+
+	template <class T>
+	std::string
+	DynMat<T>::ToString() const
+	{
+		// [(a, b, ...), (c, d, ...), ...]
+		std::vector<char> buffer(2 + (rows * (2 + (columns * (T::MaxFormatLength + 2)))));
+		return std::string(buffer.data(), Format(buffer.data(), buffer.data() + buffer.size()).ptr);
+	}
+
+	// Helpers
+	typedef DynMat<FixedPointSmall> DynMatSmall;
+	typedef DynMat<FixedPointMedium> DynMatMedium;
+	typedef DynMat<FixedPointLarge> DynMatLarge;
+
+	// Quaternions
+	// Rotations as unit quaternions w + xi + yj + zk, stored as (x, y, z, w) in a
+	// Vec<T, 4>: sums, scales and dot products use the vector operators (packed for
+	// Q16.16). The products are sums of the 4 components of the 2nd quaternion
+	// (permuted, with sign changes) scaled by the components of the 1st, so the
+	// generic and packed code give the same results.
+	// Slerp uses the polynomial coefficients of D. Eberly ("A Fast and Accurate
+	// Algorithm for Computing SLERP"): only products and sums, no inverse cosine and
+	// no division, within 2e-5 of sin(t * angle) / sin(angle).
+
+	template <class T>
+	class Quat
+	{
+		Vec<T, 4> components;
+
+		explicit Quat(Vec<T, 4> const& components) : components(components) {}
+
+	public:
+		Quat() : components{ T(false, 0, 0), T(false, 0, 0), T(false, 0, 0), T(false, 1, 0) } {}
+		Quat(T const& w, Vec<T, 3> const& v) : components{ v.Component(0), v.Component(1), v.Component(2), w } {}
+		Quat(T const& w, T const& x, T const& y, T const& z) : components{ x, y, z, w } {}
+
+		T W() const { return components.Component(3); }
+		Vec<T, 3> V() const { return Vec<T, 3>{ components.Component(0), components.Component(1), components.Component(2) }; }
+
+		Quat operator*(Quat const&) const;
+		Quat& operator*=(Quat const&);
+		bool operator==(Quat const& other) const { return components == other.components; }
+		bool operator!=(Quat const& other) const { return components != other.components; }
+
+		Quat Conjugate() const;
+		T Dot(Quat const& other) const { return components * other.components; }
+		Quat Normalize() const;
+		Vec<T, 3> Rotate(Vec<T, 3> const&) const;
+		Mat<T, 3> ToMat() const;
+		static Quat FromMat(Mat<T, 3> const&);
+		static Quat FromAxisAngle(Vec<T, 3> const&, T const&);
+		static Quat Nlerp(Quat const&, Quat const&, T const&);
+		static Quat Slerp(Quat const&, Quat const&, T const&);
+
+		static void Multiply(Span<Quat const>, Span<Quat const>, Span<Quat>);
+		static void Normalize(Span<Quat const>, Span<Quat>);
+		static void Rotate(Quat const&, Span<Vec<T, 3> const>, Span<Vec<T, 3>>);
+		static void Rotate(Span<Quat const>, Span<Vec<T, 3> const>, Span<Vec<T, 3>>);
+		static void Slerp(Span<Quat const>, Span<Quat const>, Span<T const>, Span<Quat>);
+
+		std::string ToString() const { return components.ToString(); }
+		FormatResult Format(char* first, char* last) const { return components.Format(first, last); }
+
+		// Longest text written by Format: (x, y, z, w)
+		enum { MaxFormatLength = Vec<T, 4>::MaxFormatLength };
+	};
+
+	template <class T>
+	Quat<T>
+	Quat<T>::operator*(Quat const& other) const
+	{
+		T x = other.components.Component(0);
+		T y = other.components.Component(1);
+		T z = other.components.Component(2);
+		T w = other.components.Component(3);
+		T minusX = Signed(x, true);
+		T minusY = Signed(y, true);
+		T minusZ = Signed(z, true);
+
+		// (w1 + x1 i + y1 j + z1 k) * q2, with the components of q2 for i, j and k permuted
+		Vec<T, 4> i{ w, minusZ, y, minusX };
+		Vec<T, 4> j{ z, w, minusX, minusY };
+		Vec<T, 4> k{ minusY, x, w, minusZ };
+		return Quat(Vec<T, 4>(other.components * components.Component(3) + i * components.Component(0) + j * components.Component(1) + k * components.Component(2)));
+	}
+
+	template <class T>
+	Quat<T>&
+	Quat<T>::operator*=(Quat const& other)
+	{
+		*this = *this * other;
+		return *this;
+	}
+
+	template <class T>
+	Quat<T>
+	Quat<T>::Conjugate() const
+	{
+		return Quat(components.Component(3), Signed(components.Component(0), true), Signed(components.Component(1), true), Signed(components.Component(2), true));
+	}
+
+	// Scaled by 1 / sqrt(q . q) (the reciprocal square root of the batch RSqrt)
+	template <class T>
+	Quat<T>
+	Quat<T>::Normalize() const
+	{
+		T reciprocal = T(false, 1, 0) / T::Sqrt(Dot(*this));
+		return Quat(Vec<T, 4>(components * reciprocal));
+	}
+
+	// v + w t + u x t, with t = 2 (u x v) and u the vector part
+	template <class T>
+	Vec<T, 3>
+	Quat<T>::Rotate(Vec<T, 3> const& v) const
+	{
+		Vec<T, 3> u = V();
+		Vec<T, 3> t = Vec<T, 3>::Cross(u, v) * T(false, 2, 0);
+		return v + t * components.Component(3) + Vec<T, 3>::Cross(u, t);
+	}
+
+	template <class T>
+	Mat<T, 3>
+	Quat<T>::ToMat() const
+	{
+		T one(false, 1, 0);
+		T two(false, 2, 0);
+		T x = components.Component(0);
+		T y = components.Component(1);
+		T z = components.Component(2);
+		T w = components.Component(3);
+		T xx = x * x;
+		T yy = y * y;
+		T zz = z * z;
+		T xy = x * y;
+		T xz = x * z;
+		T yz = y * z;
+		T wx = w * x;
+		T wy = w * y;
+		T wz = w * z;
+
+		return Mat<T, 3>{ one - two * (yy + zz), two * (xy - wz), two * (xz + wy),
+						  two * (xy + wz), one - two * (xx + zz), two * (yz - wx),
+						  two * (xz - wy), two * (yz + wx), one - two * (xx + yy) };
+	}
+
+	// Rotation matrix to quaternion (S. W. Shepperd): the square root is taken on the
+	// largest of the trace and the diagonal elements
+	template <class T>
+	Quat<T>
+	Quat<T>::FromMat(Mat<T, 3> const& m)
+	{
+		T one(false, 1, 0);
+		T two(false, 2, 0);
+		T quarter = T::FromDouble(0.25);
+		T m00 = m.Component(0, 0);
+		T m11 = m.Component(1, 1);
+		T m22 = m.Component(2, 2);
+		T m01 = m.Component(0, 1);
+		T m10 = m.Component(1, 0);
+		T m02 = m.Component(0, 2);
+		T m20 = m.Component(2, 0);
+		T m12 = m.Component(1, 2);
+		T m21 = m.Component(2, 1);
+		T trace = m00 + m11 + m22;
+
+		if (trace > T(false, 0, 0))
+		{
+			T s = T::Sqrt(trace + one) * two;
+			return Quat(quarter * s, (m21 - m12) / s, (m02 - m20) / s, (m10 - m01) / s);
+		}
+		if ((m00 > m11) && (m00 > m22))
+		{
+			T s = T::Sqrt(one + m00 - m11 - m22) * two;
+			return Quat((m21 - m12) / s, quarter * s, (m01 + m10) / s, (m02 + m20) / s);
+		}
+		if (m11 > m22)
+		{
+			T s = T::Sqrt(one + m11 - m00 - m22) * two;
+			return Quat((m02 - m20) / s, (m01 + m10) / s, quarter * s, (m12 + m21) / s);
+		}
+		T s = T::Sqrt(one + m22 - m00 - m11) * two;
+		return Quat((m10 - m01) / s, (m02 + m20) / s, (m12 + m21) / s, quarter * s);
+	}
+
+	// Rotation of angle radians around a unit axis
+	template <class T>
+	Quat<T>
+	Quat<T>::FromAxisAngle(Vec<T, 3> const& axis, T const& angle)
+	{
+		T half = angle;
+		half /= T(false, 2, 0);
+		return Quat(T::Cos(half), Vec<T, 3>(axis * T::Sin(half)));
+	}
+
+	// Normalized linear interpolation (along the shortest path)
+	template <class T>
+	Quat<T>
+	Quat<T>::Nlerp(Quat const& a, Quat const& b, T const& t)
+	{
+		T x = t;
+		T weight = T(false, 1, 0) - x;
+		if (T::IsNegative(a.Dot(b)))
+		{
+			x = Signed(x, true);
+		}
+
+		return Quat(Vec<T, 4>(a.components * weight + b.components * x)).Normalize();
+	}
+
+	// Spherical linear interpolation (along the shortest path)
+	template <class T>
+	Quat<T>
+	Quat<T>::Slerp(Quat const& a, Quat const& b, T const& t)
+	{
+		// u[i] = 1 / (i (2i + 1)), v[i] = i / (2i + 1), the last ones scaled by 1 + mu
+		static const double onePlusMu = 1.85298109240830;
+		static const T u[8] = { T::FromDouble(1.0 / 3.0), T::FromDouble(1.0 / 10.0), T::FromDouble(1.0 / 21.0), T::FromDouble(1.0 / 36.0),
+								T::FromDouble(1.0 / 55.0), T::FromDouble(1.0 / 78.0), T::FromDouble(1.0 / 105.0), T::FromDouble(onePlusMu / 136.0) };
+		static const T v[8] = { T::FromDouble(1.0 / 3.0), T::FromDouble(2.0 / 5.0), T::FromDouble(3.0 / 7.0), T::FromDouble(4.0 / 9.0),
+								T::FromDouble(5.0 / 11.0), T::FromDouble(6.0 / 13.0), T::FromDouble(7.0 / 15.0), T::FromDouble(onePlusMu * 8.0 / 17.0) };
+
+		T one(false, 1, 0);
+		T cosine = a.Dot(b);
+		bool opposite = T::IsNegative(cosine);
+		T x = Signed(cosine, opposite) - one;
+		T tb = t;
+		T ta = one - tb;
+		T squareA = ta * ta;
+		T squareB = tb * tb;
+
+		// sin(t * angle) / sin(angle) = t (1 + b[0] (1 + b[1] (1 + ... (1 + b[7]))))
+		// with b[i] = (u[i] t^2 - v[i]) (cos(angle) - 1)
+		T sumA = one;
+		T sumB = one;
+		for(int i = 7; i >= 0; i--)
+		{
+			T ui = u[i];
+			sumA = one + (ui * squareA - v[i]) * x * sumA;
+			sumB = one + (ui * squareB - v[i]) * x * sumB;
+		}
+		T weightA = ta * sumA;
+		T weightB = Signed(tb * sumB, opposite);
+
+		return Quat(Vec<T, 4>(a.components * weightA + b.components * weightB));
+	}
+
+	// Batch functions (same results as the functions on a single quaternion); the
+	// rotations of large sets of vectors are split between the worker threads
+
+	template <class T>
+	void
+	Quat<T>::Multiply(Span<Quat const> a, Span<Quat const> b, Span<Quat> product)
+	{
+		if ((a.Size() != b.Size()) || (a.Size() != product.Size()))
+		{
+			throw FPException("Invalid size");
+		}
+
+		for(size_t i = 0; i < a.Size(); i++)
+		{
+			product[i] = a[i] * b[i];
+		}
+	}
+
+	// The reciprocal square roots of a block are computed together (batch RSqrt)
+	template <class T>
+	void
+	Quat<T>::Normalize(Span<Quat const> quaternions, Span<Quat> normalized)
+	{
+		if (quaternions.Size() != normalized.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		T dots[kernels::BlockSize];
+		for(size_t i = 0; i < quaternions.Size(); i += kernels::BlockSize)
+		{
+			size_t n = std::min(quaternions.Size() - i, kernels::BlockSize);
+			for(size_t j = 0; j < n; j++)
+			{
+				dots[j] = quaternions[i + j].Dot(quaternions[i + j]);
+			}
+
+			T::RSqrt(Span<T const>(dots, n), Span<T>(dots, n));
+			for(size_t j = 0; j < n; j++)
+			{
+				normalized[i + j] = Quat(Vec<T, 4>(quaternions[i + j].components * dots[j]));
+			}
+		}
+	}
+
+	template <class T>
+	void
+	Quat<T>::Rotate(Quat const& q, Span<Vec<T, 3> const> vectors, Span<Vec<T, 3>> rotated)
+	{
+		if (vectors.Size() != rotated.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		Vec<T, 3> const* source = vectors.Data();
+		Vec<T, 3>* destination = rotated.Data();
+		kernels::ParallelFor(vectors.Size(), kernels::TransformGrain, [&q, source, destination](size_t first, size_t last)
+		{
+			for(size_t i = first; i < last; i++)
+			{
+				destination[i] = q.Rotate(source[i]);
+			}
+			return 0u;
+		});
+	}
+
+	template <class T>
+	void
+	Quat<T>::Rotate(Span<Quat const> quaternions, Span<Vec<T, 3> const> vectors, Span<Vec<T, 3>> rotated)
+	{
+		if ((quaternions.Size() != vectors.Size()) || (vectors.Size() != rotated.Size()))
+		{
+			throw FPException("Invalid size");
+		}
+
+		Quat const* q = quaternions.Data();
+		Vec<T, 3> const* source = vectors.Data();
+		Vec<T, 3>* destination = rotated.Data();
+		kernels::ParallelFor(vectors.Size(), kernels::TransformGrain, [q, source, destination](size_t first, size_t last)
+		{
+			for(size_t i = first; i < last; i++)
+			{
+				destination[i] = q[i].Rotate(source[i]);
+			}
+			return 0u;
+		});
+	}
+
+	template <class T>
+	void
+	Quat<T>::Slerp(Span<Quat const> a, Span<Quat const> b, Span<T const> t, Span<Quat> interpolated)
+	{
+		if ((a.Size() != b.Size()) || (a.Size() != t.Size()) || (a.Size() != interpolated.Size()))
+		{
+			throw FPException("Invalid size");
+		}
+
+		for(size_t i = 0; i < a.Size(); i++)
+		{
+			interpolated[i] = Slerp(a[i], b[i], t[i]);
+		}
+	}
+
+	// Helpers
+	typedef Quat<FixedPointSmall> QuatSmall;
+	typedef Quat<FixedPointMedium> QuatMedium;
+	typedef Quat<FixedPointLarge> QuatLarge;
+
+	// Affine transforms
+	// 3x4 matrices [L | t]: the 4x4 matrices whose last row is 0 0 0 1, without
+	// that row. The products, point transforms and rigid inverses leave out the
+	// terms of the last row (x * 0 and x * 1), so they give the same results as the
+	// Mat<T, 4> operations (the product is 36 multiplications instead of 64).
+
+	template <class T>
+	class Affine3
+	{
+		T components[3][4];
+
+		template <std::size_t... I>
+		Affine3(UninitializedTag tag, std::index_sequence<I...>) : components{ (static_cast<void>(I), T(tag))... } {}
+
+		// Row of L by a vector, added in the order of the dot product
+		T LinearRow(int row, Vec<T, 3> const& v) const
+		{
+			T sum(false, 0, 0);
+			for(int column = 0; column < 3; column++)
+			{
+				T x = components[row][column];
+				sum += x * v.Component(column);
+			}
+			return sum;
+		}
+
+	public:
+		Affine3(bool = false);
+		explicit Affine3(UninitializedTag tag) : Affine3(tag, std::make_index_sequence<12>()) {}
+		Affine3(Mat<T, 3> const&, Vec<T, 3> const&);
+		explicit Affine3(Mat<T, 4> const&);
+
+		Affine3 operator*(Affine3 const&) const;
+		Affine3& operator*=(Affine3 const&);
+		bool operator==(Affine3 const&) const;
+		bool operator!=(Affine3 const&) const;
+
+		Mat<T, 3> Linear() const;
+		Vec<T, 3> Translation() const;
+		Mat<T, 4> ToMat() const;
+		Vec<T, 3> TransformPoint(Vec<T, 3> const&) const;
+		Vec<T, 3> TransformDirection(Vec<T, 3> const&) const;
+		void Inv();
+		static Affine3 Inv(Affine3 const&);
+		static Affine3 InvRigid(Affine3 const&);
+		static Affine3 InvUniformScale(Affine3 const&);
+		std::string ToString() const;
+		FormatResult Format(char*, char*) const;
+
+		// Unchecked access
+		T const& Component(int row, int column) const { return components[row][column]; }
+
+		// Longest text written by Format: [(a, b, c, d), (e, f, g, h), (i, j, k, l)]
+		enum { MaxFormatLength = 2 + (3 * Vec<T, 4>::MaxFormatLength) + (2 * 2) };
+	};
+
+	template <class T>
+	Affine3<T>::Affine3(bool toIdentity)
+	: components()
+	{
+		if (toIdentity)
+		{
+			for(int row = 0; row < 3; row++)
+			{
+				components[row][row] = T(false, 1, 0);
+			}
+		}
+	}
+
+	template <class T>
+	Affine3<T>::Affine3(Mat<T, 3> const& linear, Vec<T, 3> const& translation)
+	{
+		for(int row = 0; row < 3; row++)
+		{
+			for(int column = 0; column < 3; column++)
+			{
+				components[row][column] = linear.Component(row, column);
+			}
+			components[row][3] = translation.Component(row);
+		}
+	}
+
+	// The 3 upper rows (the last one is not checked)
+	template <class T>
+	Affine3<T>::Affine3(Mat<T, 4> const& m)
+	{
+		for(int row = 0; row < 3; row++)
+		{
+			for(int column = 0; column < 4; column++)
+			{
+				components[row][column] = m.Component(row, column);
+			}
+		}
+	}
+
+	// Composition kernels: [L1 | t1] * [L2 | t2] = [L1 L2 | L1 t2 + t1]
+	// Every element is the sum (from +0, in the order of the index) of 3 products,
+	// plus t1 in the last column. Affine3Medium computes a row at a time on packed
+	// lanes (like the Mat4x4Medium product), with the same results.
+
+	namespace kernels
+	{
+		template <class T>
+		inline void
+		Compose(T const (&a)[3][4], T const (&b)[3][4], T (&c)[3][4])
+		{
+			for(int row = 0; row < 3; row++)
+			{
+				for(int column = 0; column < 4; column++)
+				{
+					T sum(false, 0, 0);
+					for(int index = 0; index < 3; index++)
+					{
+						T x = a[row][index];
+						sum += x * b[index][column];
+					}
+					if (column == 3)
+					{
+						sum += a[row][3];
+					}
+					c[row][column] = sum;
+				}
+			}
+		}
+
+#if defined(SFPML_SSE2)
+		inline void
+		Compose(FixedPointMedium const (&a)[3][4], FixedPointMedium const (&b)[3][4], FixedPointMedium (&c)[3][4])
+		{
+			// t1 is only added to the last lane (x + 0 would turn -0 into +0)
+			const __m128i last = _mm_set_epi32(-1, 0, 0, 0);
+
+			PackedVec rows[3];
+			for(int index = 0; index < 3; index++)
+			{
+				rows[index] = LoadPacked<4>(b[index]);
+			}
+			for(int row = 0; row < 3; row++)
+			{
+				PackedVec sum{ _mm_setzero_si128(), _mm_setzero_si128() };
+				for(int index = 0; index < 3; index++)
+				{
+					sum = AddPacked(sum, MultiplyPacked(BroadcastPacked(a[row][index]), rows[index]));
+				}
+				PackedVec translated = AddPacked(sum, BroadcastPacked(a[row][3]));
+				sum.signs = Select(last, translated.signs, sum.signs);
+				sum.magnitudes = Select(last, translated.magnitudes, sum.magnitudes);
+				StorePacked<4>(sum, c[row]);
+			}
+		}
+#endif
+	}
+
+	template <class T>
+	Affine3<T>
+	Affine3<T>::operator*(Affine3 const& other) const
+	{
+		Affine3<T> result(Uninitialized);
+		kernels::Compose(components, other.components, result.components);
+
+		return result;
+	}
+
+	template <class T>
+	Affine3<T>&
+	Affine3<T>::operator*=(Affine3 const& other)
+	{
+		*this = *this * other;
 		return *this;
 	}
 
-	template <class T, int N>
-	Vec<T, N>
-	Vec<T, N>::operator-(Vec const& other)
+	template <class T>
+	bool
+	Affine3<T>::operator==(Affine3 const& other) const
+	{
+		for(int row = 0; row < 3; row++)
+		{
+			for(int column = 0; column < 4; column++)
+			{
+				if (components[row][column] != other.components[row][column])
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	template <class T>
+	bool
+	Affine3<T>::operator!=(Affine3 const& other) const
 	{
-		std::vector<T> v;
-		for(int i = 0; i < N; ++i)
+		return !(*this == other);
+	}
+
+	template <class T>
+	Mat<T, 3>
+	Affine3<T>::Linear() const
+	{
+		return Mat<T, 3>{ components[0][0], components[0][1], components[0][2],
+						  components[1][0], components[1][1], components[1][2],
+						  components[2][0], components[2][1], components[2][2] };
+	}
+
+	template <class T>
+	Vec<T, 3>
+	Affine3<T>::Translation() const
+	{
+		return Vec<T, 3>{ components[0][3], components[1][3], components[2][3] };
+	}
+
+	template <class T>
+	Mat<T, 4>
+	Affine3<T>::ToMat() const
+	{
+		T zero(false, 0, 0);
+		return Mat<T, 4>{ components[0][0], components[0][1], components[0][2], components[0][3],
+						  components[1][0], components[1][1], components[1][2], components[1][3],
+						  components[2][0], components[2][1], components[2][2], components[2][3],
+						  zero, zero, zero, T(false, 1, 0) };
+	}
+
+	// L p + t
+	template <class T>
+	Vec<T, 3>
+	Affine3<T>::TransformPoint(Vec<T, 3> const& point) const
+	{
+		return Vec<T, 3>{ LinearRow(0, point) + components[0][3], LinearRow(1, point) + components[1][3], LinearRow(2, point) + components[2][3] };
+	}
+
+	// L d (no translation)
+	template <class T>
+	Vec<T, 3>
+	Affine3<T>::TransformDirection(Vec<T, 3> const& direction) const
+	{
+		return Vec<T, 3>{ LinearRow(0, direction), LinearRow(1, direction), LinearRow(2, direction) };
+	}
+
+	template <class T>
+	void
+	Affine3<T>::Inv()
+	{
+		*this = Inv(*this);
+	}
+
+	// [L | t]^-1 = [L^-1 | -L^-1 t], with the closed form 3x3 inverse
+	template <class T>
+	Affine3<T>
+	Affine3<T>::Inv(Affine3 const& a)
+	{
+		T inverse[3][3];
+		if (!sfpmlib::Inv<T, 3>(a.Linear(), inverse))
+		{
+			throw FPException("Determinant equal to 0");
+		}
+
+		Affine3<T> result(Uninitialized);
+		for(int row = 0; row < 3; row++)
 		{
-			v.push_back(components[i] - other.components[i]);
+			T translation(false, 0, 0);
+			for(int column = 0; column < 3; column++)
+			{
+				T x = inverse[row][column];
+				result.components[row][column] = x;
+				translation -= x * a.components[column][3];
+			}
+			result.components[row][3] = translation;
 		}
 
-		return Vec(v);
+		return result;
 	}
 
-	template <class T, int N>
-	Vec<T, N>
-	Vec<T, N>::operator-=(Vec const& other)
+	// Rigid transform (orthonormal L): the inverse is [transposed(L) | -transposed(L) t],
+	// the same results as Mat<T, 4>::InvAffine. Nothing is checked.
+	template <class T>
+	Affine3<T>
+	Affine3<T>::InvRigid(Affine3 const& a)
 	{
-		*this = *this - other;
-		return *this;
+		Affine3<T> result(Uninitialized);
+		for(int row = 0; row < 3; row++)
+		{
+			T translation(false, 0, 0);
+			for(int column = 0; column < 3; column++)
+			{
+				T x = a.components[column][row];
+				result.components[row][column] = x;
+				translation -= x * a.components[column][3];
+			}
+			result.components[row][3] = translation;
+		}
+
+		return result;
 	}
 
-	template <class T, int N>
-	T
-	Vec<T, N>::operator*(Vec const& other)
+	// Rotation and uniform scale (L = s R): the inverse is transposed(L) / s^2, with s^2
+	// the squared length of the 1st row of L (the translation is divided once, after
+	// the sum). Only a zero scale is checked.
+	template <class T>
+	Affine3<T>
+	Affine3<T>::InvUniformScale(Affine3 const& a)
 	{
-		T sum(false, 0);
-		for(int i = 0; i < N; ++i)
+		Vec<T, 3> first{ a.components[0][0], a.components[0][1], a.components[0][2] };
+		T scale = a.LinearRow(0, first);
+		if (static_cast<typename T::Number>(scale).value.fixedPoint == 0)
+		{
+			throw FPException("Determinant equal to 0");
+		}
+
+		Affine3<T> result(Uninitialized);
+		for(int row = 0; row < 3; row++)
 		{
-			sum += (components[i] * other.components[i]);
+			T translation(false, 0, 0);
+			for(int column = 0; column < 3; column++)
+			{
+				T x = a.components[column][row];
+				translation -= x * a.components[column][3];
+				result.components[row][column] = x / scale;
+			}
+			result.components[row][3] = translation / scale;
 		}
 
-		return sum;
+		return result;
 	}
 
-	template <class T, int N>
-	Vec<T, N>
-	Vec<T, N>::operator*(T const& number)
+	template <class T>
+	FormatResult
+	Affine3<T>::Format(char* first, char* last) const
 	{
-		Vec<T, N> v(*this);
-		for(int i = 0; i < N; ++i)
+		if (!first || (last < first) || !FormatLiteral(first, last, "[", 1))
 		{
-			v.components[i] *= number;
+			return FormatResult{ last, std::errc::value_too_large };
 		}
 
-		return v;
+		for(int row = 0; row < 3; row++)
+		{
+			if (!FormatLiteral(first, last, "(", 1))
+			{
+				return FormatResult{ last, std::errc::value_too_large };
+			}
+			for(int column = 0; column < 4; column++)
+			{
+				FormatResult result = components[row][column].Format(first, last);
+				if (result.ec != std::errc())
+				{
+					return result;
+				}
+				first = result.ptr;
+				if ((column != 3) && !FormatLiteral(first, last, ", ", 2))
+				{
+					return FormatResult{ last, std::errc::value_too_large };
+				}
+			}
+			if (!FormatLiteral(first, last, ")", 1))
+			{
+				return FormatResult{ last, std::errc::value_too_large };
+			}
+			if ((row != 2) && !FormatLiteral(first, last, ", ", 2))
+			{
+				return FormatResult{ last, std::errc::value_too_large };
+			}
+		}
+
+		if (!FormatLiteral(first, last, "]", 1))
+		{
+			return FormatResult{ last, std::errc::value_too_large };
+		}
+
+		return FormatResult{ first, std::errc() };
 	}
 
-	template <class T, int N>
-	Vec<T, N>
-	Vec<T, N>::operator*=(T const& number)
+	template <class T>
+	std::string
+	Affine3<T>::ToString() const
 	{
-		*this = *this * number;
-		return *this;
+		char buffer[MaxFormatLength];
+		return std::string(buffer, Format(buffer, buffer + sizeof(buffer)).ptr);
 	}
 
-	// https://www.andreaminini.org/matematica/spazio-vettoriale/prodotto-vettoriale-spazio
-	template <class T, int N>
-	Vec<T, N>
-	Vec<T, N>::Cross(Vec const& first, Vec const& second)
+	// Batch transforms of points (L p + t) and directions (L d), the same results as
+	// TransformPoint/TransformDirection. Q16.16 vectors run 4 at a time on SSE2 lanes
+	// (x, y and z of 4 vectors); large sets are split between the worker threads.
+
+	namespace kernels
 	{
-		if (N != 3)
+		template <class T>
+		inline unsigned
+		TransformAffine(Affine3<T> const& a, Vec<T, 3> const* vectors, Vec<T, 3>* transformed, size_t count, bool points)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				transformed[i] = points ? a.TransformPoint(vectors[i]) : a.TransformDirection(vectors[i]);
+			}
+			return 0;
+		}
+
+#if defined(SFPML_SSE2)
+		inline unsigned
+		TransformAffine(Affine3<FixedPointMedium> const& a, Vec<FixedPointMedium, 3> const* vectors, Vec<FixedPointMedium, 3>* transformed, size_t count, bool points)
+		{
+			// Elements broadcast to all the lanes
+			PackedVec elements[3][4];
+			for(int row = 0; row < 3; row++)
+			{
+				for(int column = 0; column < 4; column++)
+				{
+					elements[row][column] = BroadcastPacked(a.Component(row, column));
+				}
+			}
+
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				// Vec is standard layout: its address is the address of its components
+				PackedVec lanes[4];
+				for(int k = 0; k < 4; k++)
+				{
+					lanes[k] = LoadPacked<3>(reinterpret_cast<FixedPointMedium const*>(vectors + i + k));
+				}
+				TransposePacked(lanes);
+
+				PackedVec h[4];
+				for(int row = 0; row < 3; row++)
+				{
+					PackedVec sum{ _mm_setzero_si128(), _mm_setzero_si128() };
+					for(int column = 0; column < 3; column++)
+					{
+						sum = AddPacked(sum, MultiplyPacked(elements[row][column], lanes[column]));
+					}
+					h[row] = points ? AddPacked(sum, elements[row][3]) : sum;
+				}
+
+				h[3] = PackedVec{ _mm_setzero_si128(), _mm_setzero_si128() };
+				TransposePacked(h);
+				for(int k = 0; k < 4; k++)
+				{
+					StorePacked<3>(h[k], reinterpret_cast<FixedPointMedium*>(transformed + i + k));
+				}
+			}
+
+			return TransformAffine<FixedPointMedium>(a, vectors + i, transformed + i, count - i, points);
+		}
+#endif
+	}
+
+	template <class T>
+	void
+	TransformPoints(Affine3<T> const& a, Span<Vec<T, 3> const> points, Span<Vec<T, 3>> transformed)
+	{
+		if (points.Size() != transformed.Size())
 		{
 			throw FPException("Invalid size");
 		}
 
-		// 1st component
-		//		| y1 y2 |
-		//  det	| z1 z2 |
-		// 2nd component
-		//		| x1 x2 |
-		// -det	| z1 z2 |
-		// 3rd component
-		//		| x1 x2 |
-		//	det | y1 y2 |
-		T components[N] = {};
-		memcpy(components, first.components, N * sizeof(T));
+		Vec<T, 3> const* source = points.Data();
+		Vec<T, 3>* destination = transformed.Data();
+		kernels::ParallelFor(points.Size(), kernels::TransformGrain, [&a, source, destination](size_t first, size_t last)
+		{
+			return kernels::TransformAffine(a, source + first, destination + first, last - first, true);
+		});
+	}
 
-		T det1 = components[1] * second.components[2];
-		det1 -= components[2] * second.components[1];
-		T det2 = components[0] * second.components[2];
-		det2 -= components[2] * second.components[0];
-		det2 *= T(true, 1, 0);
-		T det3 = components[0] * second.components[1];
-		det3 -= components[1] * second.components[0];
+	template <class T>
+	void
+	TransformDirections(Affine3<T> const& a, Span<Vec<T, 3> const> directions, Span<Vec<T, 3>> transformed)
+	{
+		if (directions.Size() != transformed.Size())
+		{
+			throw FPException("Invalid size");
+		}
 
-		return Vec<T, N>{ det1, det2, det3 };
+		Vec<T, 3> const* source = directions.Data();
+		Vec<T, 3>* destination = transformed.Data();
+		kernels::ParallelFor(directions.Size(), kernels::TransformGrain, [&a, source, destination](size_t first, size_t last)
+		{
+			return kernels::TransformAffine(a, source + first, destination + first, last - first, false);
+		});
 	}
 
-	template <class T, int N>
-	T
-	Vec<T, N>::Angle(Vec const& first, Vec const& second)
+	// Batch compositions (e.g. the world transforms of a hierarchy): product[i] = a[i] * b[i];
+	// the destination can be one of the operands. Large sets are split between the worker threads.
+	template <class T>
+	void
+	MultiplyMany(Span<Affine3<T> const> a, Span<Affine3<T> const> b, Span<Affine3<T>> product)
 	{
-		Vec<T, N> a(first);
-		Vec<T, N> b(second);
+		if ((a.Size() != b.Size()) || (a.Size() != product.Size()))
+		{
+			throw FPException("Invalid size");
+		}
 
-		// Compute the cosine of the angle between the 2 vectors
-		T cosine = a * b;					// Dot Product
-		cosine /= (a.Mod() * b.Mod());		// Divide by the product of the 2 vectors magnitude
-		if (cosine == T(false, 0))
+		Affine3<T> const* first = a.Data();
+		Affine3<T> const* second = b.Data();
+		Affine3<T>* destination = product.Data();
+		kernels::ParallelFor(a.Size(), kernels::MultiplyGrain, [first, second, destination](size_t begin, size_t end)
 		{
-			// Angle between the 2 vectors is PI/2
-			return T::FromString("1.570796326");
+			for(size_t i = begin; i < end; i++)
+			{
+				destination[i] = first[i] * second[i];
+			}
+			return 0u;
+		});
+	}
+
+	// Helpers
+	typedef Affine3<FixedPointSmall> Affine3Small;
+	typedef Affine3<FixedPointMedium> Affine3Medium;
+	typedef Affine3<FixedPointLarge> Affine3Large;
+
+	// Linear systems
+	// LU (partial pivoting), Cholesky (symmetric positive definite matrices) and
+	// Householder QR (full column rank; least squares with more rows than columns)
+	// factorizations of Mat and DynMat, kept to solve any number of right hand sides.
+	// The kernels work in place on row major arrays, the right hand sides being the
+	// columns of a row major n x k array, so every step updates whole rows
+	// (y -= s * x on packed lanes for Q16.16).
+	// The factorizations are right looking and blocked: a panel of SolveBlock columns
+	// is factored, then the trailing matrix is updated on the worker threads (LU and
+	// Cholesky by rows, QR by columns). Every element gets its updates in the order of
+	// the unblocked elimination, so the results do not depend on the block size or on
+	// the number of threads; the substitutions split the columns between the threads.
+
+	namespace kernels
+	{
+		const size_t SolveBlock = 64;
+		const size_t SolveGrain = 64;
+
+		// Raw magnitude (pivots and zero checks)
+		template <class T>
+		inline auto
+		Magnitude(T const& x) -> decltype(static_cast<typename T::Number>(x).value.fixedPoint)
+		{
+			return static_cast<typename T::Number>(x).value.fixedPoint;
 		}
 
-		// Compute the sine of the angle between the 2 vectors
-		T sine = T::Sqrt(T(false, 1, 0) - T::Pow(cosine, 2));
+		// y[i] += s * x[i]
+		template <class T>
+		inline void
+		AddScaled(T* y, T const* x, T const& s, size_t count)
+		{
+			T scale = s;
+			for(size_t i = 0; i < count; i++)
+			{
+				y[i] += scale * x[i];
+			}
+		}
 
-		// Compute the tangent of the angle between the 2 vectors
-		T tangent = sine / cosine;
+		// y[i] -= s * x[i]
+		template <class T>
+		inline void
+		SubtractScaled(T* y, T const* x, T const& s, size_t count)
+		{
+			T scale = s;
+			for(size_t i = 0; i < count; i++)
+			{
+				y[i] -= scale * x[i];
+			}
+		}
+
+#if defined(SFPML_SSE2)
+		inline void
+		AddScaled(FixedPointMedium* y, FixedPointMedium const* x, FixedPointMedium const& s, size_t count)
+		{
+			PackedVec scale = BroadcastPacked(s);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				StorePacked<4>(AddPacked(LoadPacked<4>(y + i), MultiplyPacked(scale, LoadPacked<4>(x + i))), y + i);
+			}
+			AddScaled<FixedPointMedium>(y + i, x + i, s, count - i);
+		}
+
+		inline void
+		SubtractScaled(FixedPointMedium* y, FixedPointMedium const* x, FixedPointMedium const& s, size_t count)
+		{
+			PackedVec scale = BroadcastPacked(s);
+			size_t i = 0;
+			for(; (i + 4) <= count; i += 4)
+			{
+				StorePacked<4>(SubtractPacked(LoadPacked<4>(y + i), MultiplyPacked(scale, LoadPacked<4>(x + i))), y + i);
+			}
+			SubtractScaled<FixedPointMedium>(y + i, x + i, s, count - i);
+		}
+#endif
+
+		// P A = L U (unit L below the diagonal, U on and above it); pivots[k] is the row
+		// swapped with row k. False when a pivot is 0.
+		template <class T>
+		inline bool
+		FactorLU(T* a, size_t n, size_t* pivots)
+		{
+			for(size_t first = 0; first < n; first += SolveBlock)
+			{
+				size_t last = std::min(n, first + SolveBlock);
+
+				// Panel (columns first to last), every row below the diagonal
+				for(size_t k = first; k < last; k++)
+				{
+					size_t pivot = k;
+					for(size_t row = k + 1; row < n; row++)
+					{
+						if (Magnitude(a[(row * n) + k]) > Magnitude(a[(pivot * n) + k]))
+						{
+							pivot = row;
+						}
+					}
+					if (Magnitude(a[(pivot * n) + k]) == 0)
+					{
+						return false;
+					}
+					pivots[k] = pivot;
+					if (pivot != k)
+					{
+						std::swap_ranges(a + (k * n), a + ((k + 1) * n), a + (pivot * n));
+					}
+
+					T* top = a + (k * n);
+					for(size_t row = k + 1; row < n; row++)
+					{
+						T* current = a + (row * n);
+						current[k] = current[k] / top[k];
+						SubtractScaled(current + k + 1, top + k + 1, current[k], last - k - 1);
+					}
+				}
+
+				// Rows of U right of the panel (substitution by the unit L of the panel)
+				for(size_t k = first + 1; k < last; k++)
+				{
+					for(size_t p = first; p < k; p++)
+					{
+						SubtractScaled(a + (k * n) + last, a + (p * n) + last, a[(k * n) + p], n - last);
+					}
+				}
+
+				// Trailing matrix
+				ParallelFor(n - last, SolveGrain, [a, n, first, last](size_t begin, size_t end)
+				{
+					for(size_t row = last + begin; row < (last + end); row++)
+					{
+						for(size_t p = first; p < last; p++)
+						{
+							SubtractScaled(a + (row * n) + last, a + (p * n) + last, a[(row * n) + p], n - last);
+						}
+					}
+					return 0u;
+				});
+			}
+
+			return true;
+		}
+
+		// Row swaps, L y = P b, U x = y
+		template <class T>
+		inline void
+		SolveLU(T const* lu, size_t const* pivots, size_t n, T* b, size_t k)
+		{
+			ParallelFor(k, SolveGrain, [lu, pivots, n, b, k](size_t begin, size_t end)
+			{
+				size_t width = end - begin;
+				for(size_t row = 0; row < n; row++)
+				{
+					if (pivots[row] != row)
+					{
+						std::swap_ranges(b + (row * k) + begin, b + (row * k) + end, b + (pivots[row] * k) + begin);
+					}
+				}
+				for(size_t row = 1; row < n; row++)
+				{
+					for(size_t p = 0; p < row; p++)
+					{
+						SubtractScaled(b + (row * k) + begin, b + (p * k) + begin, lu[(row * n) + p], width);
+					}
+				}
+				for(size_t row = n; row-- > 0;)
+				{
+					for(size_t p = row + 1; p < n; p++)
+					{
+						SubtractScaled(b + (row * k) + begin, b + (p * k) + begin, lu[(row * n) + p], width);
+					}
+					for(size_t column = begin; column < end; column++)
+					{
+						b[(row * k) + column] /= lu[(row * n) + row];
+					}
+				}
+				return 0u;
+			});
+		}
+
+		// A = L transposed(L), in the lower triangle (the upper one is left as is).
+		// False when A is not positive definite (pivot <= 0).
+		template <class T>
+		inline bool
+		FactorCholesky(T* a, size_t n)
+		{
+			for(size_t first = 0; first < n; first += SolveBlock)
+			{
+				size_t last = std::min(n, first + SolveBlock);
+
+				// Panel (columns first to last), every row below the diagonal
+				for(size_t k = first; k < last; k++)
+				{
+					T* top = a + (k * n);
+					if (T::IsNegative(top[k]) || (Magnitude(top[k]) == 0))
+					{
+						return false;
+					}
+					top[k] = T::Sqrt(top[k]);
+
+					for(size_t row = k + 1; row < n; row++)
+					{
+						T* current = a + (row * n);
+						current[k] = current[k] / top[k];
+						T x = current[k];
+						for(size_t column = k + 1; column < std::min(last, row + 1); column++)
+						{
+							current[column] -= x * a[(column * n) + k];
+						}
+					}
+				}
 
-		// Compute the arctan in order to get the angle between the 2 vectors.
-		// Use Taylor formula.
-		T res(false, 0);
-		for(uint8_t i = 0; i < 10; i++)
-		{
-			T val = T::Pow(tangent, (2 * i) + 1);
-			val /= T(((i % 2) == 0) ? false : true, (2 * i) + 1, 0);
+				// Trailing lower triangle, with the panel transposed (its columns become rows)
+				if (last == n)
+				{
+					break;
+				}
+				size_t width = n - last;
+				std::vector<T> panel((last - first) * width);
+				for(size_t row = last; row < n; row++)
+				{
+					for(size_t p = first; p < last; p++)
+					{
+						panel[((p - first) * width) + (row - last)] = a[(row * n) + p];
+					}
+				}
+				T const* columns = panel.data();
+				ParallelFor(width, SolveGrain, [a, n, first, last, columns, width](size_t begin, size_t end)
+				{
+					for(size_t row = last + begin; row < (last + end); row++)
+					{
+						T* current = a + (row * n);
+						for(size_t p = first; p < last; p++)
+						{
+							SubtractScaled(current + last, columns + ((p - first) * width), current[p], row - last + 1);
+						}
+					}
+					return 0u;
+				});
+			}
 
-			res += val;
+			return true;
 		}
 
-		return res;
-	}
-
-	template <class T, int N>
-	T
-	Vec<T, N>::operator[](uint32_t index) const
-	{
-		if (index >= N)
+		// L y = b, transposed(L) x = y
+		template <class T>
+		inline void
+		SolveCholesky(T const* l, size_t n, T* b, size_t k)
 		{
-			throw FPException("Subscript out of range");
+			ParallelFor(k, SolveGrain, [l, n, b, k](size_t begin, size_t end)
+			{
+				size_t width = end - begin;
+				for(size_t row = 0; row < n; row++)
+				{
+					for(size_t p = 0; p < row; p++)
+					{
+						SubtractScaled(b + (row * k) + begin, b + (p * k) + begin, l[(row * n) + p], width);
+					}
+					for(size_t column = begin; column < end; column++)
+					{
+						b[(row * k) + column] /= l[(row * n) + row];
+					}
+				}
+				for(size_t row = n; row-- > 0;)
+				{
+					for(size_t p = row + 1; p < n; p++)
+					{
+						SubtractScaled(b + (row * k) + begin, b + (p * k) + begin, l[(p * n) + row], width);
+					}
+					for(size_t column = begin; column < end; column++)
+					{
+						b[(row * k) + column] /= l[(row * n) + row];
+					}
+				}
+				return 0u;
+			});
 		}
 
-		return components[index];
-	}
-
-	template <class T, int N>
-	bool
-	Vec<T, N>::operator==(Vec const& other) const
-	{
-		for(int i = 0; i < N; ++i)
+		// Reflection (I - v transposed(v) / divisor) of the columns first to last of a
+		// rows x columns array, rows k and below (v in column k of the factorization)
+		template <class T>
+		inline void
+		Reflect(T const* qr, size_t columns, size_t k, T const& divisor, T* a, size_t rows, size_t stride, size_t first, size_t last)
 		{
-			if (components[i] != other.components[i])
+			T w[BlockSize];
+			for(size_t column = first; column < last; column += BlockSize)
 			{
-				return false;
+				size_t width = std::min(last - column, BlockSize);
+				std::fill(w, w + width, T(false, 0, 0));
+				for(size_t row = k; row < rows; row++)
+				{
+					AddScaled(w, a + (row * stride) + column, qr[(row * columns) + k], width);
+				}
+				for(size_t i = 0; i < width; i++)
+				{
+					w[i] /= divisor;
+				}
+				for(size_t row = k; row < rows; row++)
+				{
+					SubtractScaled(a + (row * stride) + column, w, qr[(row * columns) + k], width);
+				}
 			}
 		}
 
-		return true;
-	}
+		// A = Q R (rows >= columns): R above the diagonal and in diagonal, the
+		// Householder vectors on and below the diagonal, with v.v / 2 in divisors.
+		// Every column is scaled by its largest magnitude before its norm is taken.
+		// The reflections of a panel of SolveBlock columns are applied to the panel,
+		// then to the trailing columns on the worker threads (every column gets them in
+		// order, so the results are those of the unblocked factorization).
+		// False when the columns are linearly dependent.
+		template <class T>
+		inline bool
+		FactorQR(T* a, size_t rows, size_t columns, T* diagonal, T* divisors)
+		{
+			for(size_t first = 0; first < columns; first += SolveBlock)
+			{
+				size_t last = std::min(columns, first + SolveBlock);
 
-	template <class T, int N>
-	bool
-	Vec<T, N>::operator!=(Vec const& other) const
-	{
-		return !operator==(other);
-	}
+				for(size_t k = first; k < last; k++)
+				{
+					size_t largest = k;
+					for(size_t row = k + 1; row < rows; row++)
+					{
+						if (Magnitude(a[(row * columns) + k]) > Magnitude(a[(largest * columns) + k]))
+						{
+							largest = row;
+						}
+					}
+					if (Magnitude(a[(largest * columns) + k]) == 0)
+					{
+						return false;
+					}
 
-	template <class T, int N>
-	T
-	Vec<T, N>::Mod() const
-	{
-		T sum(false, 0);
-		for(int i = 0; i < N; ++i)
-		{
-			sum += T::Pow(components[i], 2);
+					T scale = T::Abs(a[(largest * columns) + k]);
+					T squares(false, 0, 0);
+					for(size_t row = k; row < rows; row++)
+					{
+						T u = a[(row * columns) + k] / scale;
+						a[(row * columns) + k] = u;
+						squares += u * u;
+					}
+
+					// v = u + sign(u0) |u| e0, v.v / 2 = |u| (|u| + |u0|), R[k][k] = -sign(u0) |x|
+					T norm = T::Sqrt(squares);
+					T head = a[(k * columns) + k];
+					bool negative = T::IsNegative(head);
+					head = T::Abs(head) + norm;
+					a[(k * columns) + k] = Signed(head, negative);
+					divisors[k] = norm * head;
+					diagonal[k] = Signed(scale * norm, !negative);
+
+					Reflect(a, columns, k, divisors[k], a, rows, columns, k + 1, last);
+				}
+
+				// Trailing columns
+				ParallelFor(columns - last, SolveGrain, [a, rows, columns, first, last, divisors](size_t begin, size_t end)
+				{
+					for(size_t k = first; k < last; k++)
+					{
+						Reflect(a, columns, k, divisors[k], a, rows, columns, last + begin, last + end);
+					}
+					return 0u;
+				});
+			}
+
+			return true;
 		}
 
-		return T::Sqrt(sum);
+		// transposed(Q) b, then R x = (transposed(Q) b) in the first columns rows of b
+		template <class T>
+		inline void
+		SolveQR(T const* qr, T const* diagonal, T const* divisors, size_t rows, size_t columns, T* b, size_t k)
+		{
+			ParallelFor(k, SolveGrain, [qr, diagonal, divisors, rows, columns, b, k](size_t begin, size_t end)
+			{
+				for(size_t p = 0; p < columns; p++)
+				{
+					Reflect(qr, columns, p, divisors[p], b, rows, k, begin, end);
+				}
+				for(size_t row = columns; row-- > 0;)
+				{
+					for(size_t p = row + 1; p < columns; p++)
+					{
+						SubtractScaled(b + (row * k) + begin, b + (p * k) + begin, qr[(row * columns) + p], end - begin);
+					}
+					for(size_t column = begin; column < end; column++)
+					{
+						b[(row * k) + column] /= diagonal[row];
+					}
+				}
+				return 0u;
+			});
+		}
 	}
 
+	// Factorizations of Mat<T, N> (no allocations); Solve with a span solves one system
+	// per vector (the destination can be the source), on the worker threads for large sets
+
 	template <class T, int N>
-	Vec<T, N>
-	Vec<T, N>::Normalize() const
+	class LU
 	{
-		T mod = Mod();
-		Vec<T, N> res(*this);
+		T lu[N][N];
+		size_t pivots[N];
 
-		for(auto& component : res.components)
-		{
-			component /= mod;
-		}
+	public:
+		explicit LU(Mat<T, N> const&);
 
-		return res;
-	}
+		Vec<T, N> Solve(Vec<T, N> const&) const;
+		void Solve(Span<Vec<T, N> const>, Span<Vec<T, N>>) const;
+		T Det() const;
+	};
 
 	template <class T, int N>
-	std::string
-	Vec<T, N>::ToString() const
+	class Cholesky
 	{
-		std::stringstream ss;
-		ss << "(";
-		for(int i = 0; i < N; i++)
-		{
-			ss << components[i].ToString();
-			if (i != (N - 1))
-			{
-				ss << ", ";
-			}
-		}
-		ss << ")";
+		T l[N][N];
 
-		return ss.str();
-	}
+	public:
+		explicit Cholesky(Mat<T, N> const&);
 
-	// Helpers
-	typedef Vec<FixedPointSmall, 2> Vec2Small;
-	typedef Vec<FixedPointMedium, 2> Vec2Medium;
-	typedef Vec<FixedPointLarge, 2> Vec2Large;
-	typedef Vec<FixedPointSmall, 3> Vec3Small;
-	typedef Vec<FixedPointMedium, 3> Vec3Medium;
-	typedef Vec<FixedPointLarge, 3> Vec3Large;
-	typedef Vec<FixedPointSmall, 4> Vec4Small;
-	typedef Vec<FixedPointMedium, 4> Vec4Medium;
-	typedef Vec<FixedPointLarge, 4> Vec4Large;
+		Vec<T, N> Solve(Vec<T, N> const&) const;
+		void Solve(Span<Vec<T, N> const>, Span<Vec<T, N>>) const;
+	};
 
-	// Matrices
 	template <class T, int N>
-	class Mat
+	class QR
 	{
-		T components[N][N];
+		T qr[N][N];
+		T diagonal[N];
+		T divisors[N];
 
 	public:
-		Mat(bool = false);
-		Mat(Mat const&);
-		Mat(std::initializer_list<T>);
-		Mat(std::vector<T> const&);
-
-		Mat operator+(Mat const&);
-		Mat operator+=(Mat const&);
-		Mat operator-(Mat const&);
-		Mat operator-=(Mat const&);
-		Mat operator*(T const&);
-		Mat operator*=(T const&);
-		Mat operator*(Mat const&);
-		Mat operator*=(Mat const&);
-		Vec<T, N> operator[](uint32_t) const;
-		bool operator==(Mat const&) const;
-		bool operator!=(Mat const&) const;
+		explicit QR(Mat<T, N> const&);
 
-		Mat<T, N - 1> ExtractMatrix(uint8_t, uint8_t);
-		Mat CoFactorMatrix();
-		T Det() const;
-		void Inv();
-		void Transpose();
-		static Mat Inv(Mat const&);
-		static Mat Transpose(Mat const&);
-		std::string ToString() const;
+		Vec<T, N> Solve(Vec<T, N> const&) const;
+		void Solve(Span<Vec<T, N> const>, Span<Vec<T, N>>) const;
 	};
 
-	template <class T, int N>
-	Mat<T, N>::Mat(bool toIdentity)
+	namespace kernels
 	{
-		::memset(components, 0, N * N * sizeof(T));
-		if (toIdentity)
+		// Copy of a matrix into the array of a factorization
+		template <class T, int N>
+		inline void
+		CopyMat(Mat<T, N> const& m, T (&a)[N][N])
 		{
 			for(int row = 0; row < N; row++)
 			{
 				for(int column = 0; column < N; column++)
 				{
-					if (row == column)
-					{
-						components[row][column] = T(false, 1, 0);
-					}
+					a[row][column] = m.Component(row, column);
 				}
 			}
 		}
+
+		// Solves every system in place, after copying the right hand sides; Vec is
+		// standard layout: its address is the address of its components
+		template <class T, int N, class F>
+		inline void
+		SolveEach(Span<Vec<T, N> const> b, Span<Vec<T, N>> x, F const& solve)
+		{
+			if (b.Size() != x.Size())
+			{
+				throw FPException("Invalid size");
+			}
+
+			Vec<T, N> const* source = b.Data();
+			Vec<T, N>* destination = x.Data();
+			ParallelFor(b.Size(), TransformGrain, [source, destination, &solve](size_t first, size_t last)
+			{
+				for(size_t i = first; i < last; i++)
+				{
+					destination[i] = source[i];
+					solve(reinterpret_cast<T*>(destination + i));
+				}
+				return 0u;
+			});
+		}
 	}
 
 	template <class T, int N>
-	Mat<T, N>::Mat(Mat const& other)
+	LU<T, N>::LU(Mat<T, N> const& m)
 	{
-		::memcpy(components, other.components, sizeof(T) * N * N);
+		kernels::CopyMat(m, lu);
+		if (!kernels::FactorLU(&lu[0][0], N, pivots))
+		{
+			throw FPException("Determinant equal to 0");
+		}
 	}
 
 	template <class T, int N>
-	Mat<T, N>::Mat(std::initializer_list<T> list)
-	: Mat()
+	Vec<T, N>
+	LU<T, N>::Solve(Vec<T, N> const& b) const
 	{
-		if (list.size() > (N * N))
-		{
-			throw(FPException("Invalid size"));
-		}
+		Vec<T, N> x(b);
+		kernels::SolveLU(&lu[0][0], pivots, N, reinterpret_cast<T*>(&x), 1);
 
-		int row = 0;
-		int column = 0;
-		for(auto const& elem : list)
-		{
-			components[row][column++] = elem;
-			if (column >= N)
-			{
-				++row;
-				column = 0;
-			}
-		}
+		return x;
 	}
 
 	template <class T, int N>
-	Mat<T, N>::Mat(std::vector<T> const& values)
-	: Mat()
+	void
+	LU<T, N>::Solve(Span<Vec<T, N> const> b, Span<Vec<T, N>> x) const
 	{
-		if (values.size() > (N * N))
-		{
-			throw(FPException("Invalid size"));
-		}
+		kernels::SolveEach(b, x, [this](T* components) { kernels::SolveLU(&lu[0][0], pivots, N, components, 1); });
+	}
 
-		int row = 0;
-		int column = 0;
-		for(auto const& elem : values)
+	// Product of the pivots, negated by an odd number of row swaps
+	template <class T, int N>
+	T
+	LU<T, N>::Det() const
+	{
+		T result(false, 1, 0);
+		bool negative = false;
+		for(int k = 0; k < N; k++)
 		{
-			components[row][column++] = elem;
-			if (column >= N)
-			{
-				++row;
-				column = 0;
-			}
+			result *= lu[k][k];
+			negative = (negative != (pivots[k] != static_cast<size_t>(k)));
 		}
+
+		return Signed(result, negative);
 	}
 
 	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::operator+(Mat const& other)
+	Cholesky<T, N>::Cholesky(Mat<T, N> const& m)
 	{
-		Mat<T, N> result;
-		for(int row = 0; row < N; ++row)
+		kernels::CopyMat(m, l);
+		if (!kernels::FactorCholesky(&l[0][0], N))
 		{
-			for(int column = 0; column < N; ++column)
-			{
-				result.components[row][column] = components[row][column] + other.components[row][column];
-			}
+			throw FPException("Matrix not positive definite");
 		}
+	}
 
-		return result;
+	template <class T, int N>
+	Vec<T, N>
+	Cholesky<T, N>::Solve(Vec<T, N> const& b) const
+	{
+		Vec<T, N> x(b);
+		kernels::SolveCholesky(&l[0][0], N, reinterpret_cast<T*>(&x), 1);
+
+		return x;
 	}
 
 	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::operator+=(Mat const& other)
+	void
+	Cholesky<T, N>::Solve(Span<Vec<T, N> const> b, Span<Vec<T, N>> x) const
 	{
-		*this = *this + other;
-		return *this;
+		kernels::SolveEach(b, x, [this](T* components) { kernels::SolveCholesky(&l[0][0], N, components, 1); });
 	}
 
 	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::operator-(Mat const& other)
+	QR<T, N>::QR(Mat<T, N> const& m)
 	{
-		Mat<T, N> result;
-		for(int row = 0; row < N; ++row)
+		kernels::CopyMat(m, qr);
+		if (!kernels::FactorQR(&qr[0][0], N, N, diagonal, divisors))
 		{
-			for(int column = 0; column < N; ++column)
-			{
-				result.components[row][column] = components[row][column] - other.components[row][column];
-			}
+			throw FPException("Determinant equal to 0");
 		}
-
-		return result;
 	}
 
 	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::operator-=(Mat const& other)
+	Vec<T, N>
+	QR<T, N>::Solve(Vec<T, N> const& b) const
 	{
-		*this = *this - other;
-		return *this;
+		Vec<T, N> x(b);
+		kernels::SolveQR(&qr[0][0], diagonal, divisors, N, N, reinterpret_cast<T*>(&x), 1);
+
+		return x;
 	}
 
 	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::operator*(T const& value)
+	void
+	QR<T, N>::Solve(Span<Vec<T, N> const> b, Span<Vec<T, N>> x) const
 	{
-		Mat<T, N> result;
-		for(int row = 0; row < N; ++row)
-		{
-			for(int column = 0; column < N; ++column)
-			{
-				result.components[row][column] = components[row][column] * value;
-			}
-		}
-
-		return result;
+		kernels::SolveEach(b, x, [this](T* components) { kernels::SolveQR(&qr[0][0], diagonal, divisors, N, N, components, 1); });
 	}
 
+	// A x = b by LU decomposition
 	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::operator*=(T const& value)
+	Vec<T, N>
+	Mat<T, N>::Solve(Vec<T, N> const& b) const
 	{
-		*this = *this * value;
-		return *this;
+		return LU<T, N>(*this).Solve(b);
 	}
 
+	// Batch of small systems: x[i] solves m[i] x = b[i] (LU decomposition), the
+	// destination can be the source. The singular systems give (0, ..., 0) and are
+	// reported once all the systems have been solved.
 	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::operator*(Mat const& other)
+	void
+	SolveMany(Span<Mat<T, N> const> m, Span<Vec<T, N> const> b, Span<Vec<T, N>> x)
 	{
-		Mat<T, N> result;
+		if ((m.Size() != b.Size()) || (b.Size() != x.Size()))
+		{
+			throw FPException("Invalid size");
+		}
 
-		for(int row = 0; row < N; row++)
+		Mat<T, N> const* matrices = m.Data();
+		Vec<T, N> const* source = b.Data();
+		Vec<T, N>* destination = x.Data();
+		unsigned errors = kernels::ParallelFor(m.Size(), kernels::MultiplyGrain, [matrices, source, destination](size_t first, size_t last)
 		{
-			for(int column = 0; column < N; column++)
+			unsigned flags = 0;
+			for(size_t i = first; i < last; i++)
 			{
-				for(int index = 0; index < N; index++)
+				T lu[N][N];
+				size_t pivots[N];
+				kernels::CopyMat(matrices[i], lu);
+				if (!kernels::FactorLU(&lu[0][0], N, pivots))
 				{
-					result.components[row][column] += components[row][index] * other.components[index][column];
+					flags |= kernels::DivisionByZeroFlag;
+					destination[i] = Vec<T, N>();
+					continue;
 				}
+				destination[i] = source[i];
+				kernels::SolveLU(&lu[0][0], pivots, N, reinterpret_cast<T*>(destination + i), 1);
 			}
-		}
-
-		return result;
+			return flags;
+		});
+		kernels::ThrowErrors(errors);
 	}
 
-	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::operator*=(Mat const& other)
+	// Factorizations of DynMat (QR: rows >= columns, least squares solution when there
+	// are more rows); Solve takes the right hand sides as the columns of a matrix
+
+	template <class T>
+	class DynLU
 	{
-		*this = *this * other;
-		return *this;
-	}
+		size_t size;
+		std::vector<T> lu;
+		std::vector<size_t> pivots;
 
-	template <class T, int N>
-	Vec<T, N>
-	Mat<T, N>::operator[](uint32_t row) const
+	public:
+		explicit DynLU(DynMat<T> const&);
+
+		DynMat<T> Solve(DynMat<T> const&) const;
+		T Det() const;
+	};
+
+	template <class T>
+	class DynCholesky
 	{
-		if (row >= N)
+		size_t size;
+		std::vector<T> l;
+
+	public:
+		explicit DynCholesky(DynMat<T> const&);
+
+		DynMat<T> Solve(DynMat<T> const&) const;
+	};
+
+	template <class T>
+	class DynQR
+	{
+		size_t rows;
+		size_t columns;
+		std::vector<T> qr;
+		std::vector<T> diagonal;
+		std::vector<T> divisors;
+
+	public:
+		explicit DynQR(DynMat<T> const&);
+
+		DynMat<T> Solve(DynMat<T> const&) const;
+	};
+
+	template <class T>
+	DynLU<T>::DynLU(DynMat<T> const& m)
+	: size(m.Rows()), lu(m.Data(), m.Data() + (m.Rows() * m.Columns())), pivots(m.Rows())
+	{
+		if (m.Rows() != m.Columns())
 		{
-			throw FPException("Subscript out of range");
+			throw FPException("Invalid size");
 		}
-
-		std::vector<T> values;
-		for(int column = 0; column < N; column++)
+		if (!kernels::FactorLU(lu.data(), size, pivots.data()))
 		{
-			values.push_back(components[row][column]);
+			throw FPException("Determinant equal to 0");
 		}
-
-		return Vec<T, N>(values);
 	}
-	
-	template <class T, int N>
-	bool
-	Mat<T, N>::operator==(Mat const& other) const
+
+	template <class T>
+	DynMat<T>
+	DynLU<T>::Solve(DynMat<T> const& b) const
 	{
-		for(int row = 0; row < N; ++row)
+		if (b.Rows() != size)
 		{
-			for(int column = 0; column < N; ++column)
-			{
-				if (components[row][column] != other.components[row][column])
-				{
-					return false;
-				}
-			}
+			throw FPException("Invalid size");
 		}
 
-		return true;
-	}
+		DynMat<T> x(b);
+		kernels::SolveLU(lu.data(), pivots.data(), size, x.Data(), x.Columns());
 
-	template <class T, int N>
-	bool
-	Mat<T, N>::operator!=(Mat const& other) const
-	{
-		return !operator==(other);
+		return x;
 	}
 
-	template <class T, int N>
+	template <class T>
 	T
-	Mat<T, N>::Det() const
+	DynLU<T>::Det() const
 	{
-		return ::Det<T, N>(*this);
+		T result(false, 1, 0);
+		bool negative = false;
+		for(size_t k = 0; k < size; k++)
+		{
+			result *= lu[(k * size) + k];
+			negative = (negative != (pivots[k] != k));
+		}
+
+		return Signed(result, negative);
 	}
 
-	template <class T, int N>
-	Mat<T, N - 1>
-	Mat<T, N>::ExtractMatrix(uint8_t row, uint8_t column)
+	template <class T>
+	DynCholesky<T>::DynCholesky(DynMat<T> const& m)
+	: size(m.Rows()), l(m.Data(), m.Data() + (m.Rows() * m.Columns()))
 	{
-		if (N <= 2)
+		if (m.Rows() != m.Columns())
 		{
 			throw FPException("Invalid size");
 		}
-
-		std::vector<T> values;
-		for(uint8_t i = 0; i < N; i++)
+		if (!kernels::FactorCholesky(l.data(), size))
 		{
-			for(uint8_t j = 0; j < N; j++)
-			{
-				if ((i != row) && (j != column))
-				{
-					values.push_back(components[i][j]);
-				}
-			}
+			throw FPException("Matrix not positive definite");
 		}
-
-		return Mat<T, N - 1>(values);
 	}
 
-	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::CoFactorMatrix()
+	template <class T>
+	DynMat<T>
+	DynCholesky<T>::Solve(DynMat<T> const& b) const
 	{
-		std::vector<T> values;
-		for(uint8_t row = 0; row < N; row++)
+		if (b.Rows() != size)
 		{
-			for(uint8_t column = 0; column < N; column++)
-			{
-				T coeff((((row + column) % 2) == 0) ? false : true, 1, 0);
-				Mat<T, N - 1> c(ExtractMatrix(row, column));
-				
-				values.push_back(coeff * c.Det());
-			}
+			throw FPException("Invalid size");
 		}
 
-		return Mat<T, N>(values);
+		DynMat<T> x(b);
+		kernels::SolveCholesky(l.data(), size, x.Data(), x.Columns());
+
+		return x;
 	}
 
-	template <class T, int N>
-	void
-	Mat<T, N>::Inv()
+	template <class T>
+	DynQR<T>::DynQR(DynMat<T> const& m)
+	: rows(m.Rows()), columns(m.Columns()), qr(m.Data(), m.Data() + (m.Rows() * m.Columns())), diagonal(m.Columns()), divisors(m.Columns())
 	{
-		T det = Det();
-		if (det == T(false, 0, 0))
+		if (m.Rows() < m.Columns())
+		{
+			throw FPException("Invalid size");
+		}
+		if (!kernels::FactorQR(qr.data(), rows, columns, diagonal.data(), divisors.data()))
 		{
 			throw FPException("Determinant equal to 0");
 		}
+	}
+
+	// columns x k solution of the rows x k right hand sides
+	template <class T>
+	DynMat<T>
+	DynQR<T>::Solve(DynMat<T> const& b) const
+	{
+		if (b.Rows() != rows)
+		{
+			throw FPException("Invalid size");
+		}
 
-		Mat<T, N> cofactorMatrix(CoFactorMatrix());
-		cofactorMatrix.Transpose();
-		T invDet = T(false, 1, 0) / det;
-		cofactorMatrix *= invDet;
+		DynMat<T> y(b);
+		kernels::SolveQR(qr.data(), diagonal.data(), divisors.data(), rows, columns, y.Data(), y.Columns());
 
-		*this = cofactorMatrix;
+		DynMat<T> x(columns, y.Columns());
+		std::copy(y.Data(), y.Data() + (columns * y.Columns()), x.Data());
+		return x;
 	}
 
-	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::Inv(Mat const& m)
+	// A X = B by LU decomposition (B and X: one right hand side per column)
+	template <class T>
+	DynMat<T>
+	DynMat<T>::Solve(DynMat const& b) const
 	{
-		Mat<T, N> result(m);
-		result.Inv();
-
-		return result;
+		return DynLU<T>(*this).Solve(b);
 	}
 
-	template <class T, int N>
-	void
-	Mat<T, N>::Transpose()
+	// Eigen-decomposition and singular value decomposition of 3x3 matrices
+	// Cyclic Jacobi rotations: at most sweeps passes over the 3 off-diagonal elements,
+	// stopping early once they are all 0, so the cost is bounded for real time use.
+	// Q8.8 and Q16.16 converge in 3 sweeps and Q32.32 in 4: the default JacobiSweeps
+	// is one more, which costs nothing once converged. The rotation is computed
+	// from the difference of the diagonal elements and twice the off-diagonal element,
+	// both scaled by the largest of them, so nothing leaves the range. The SVD follows
+	// A. McAdams et al. ("Computing the Singular Value Decomposition of 3x3 matrices
+	// with minimal branching and elementary floating point operations"): the Jacobi
+	// eigenvectors of transposed(A) A give V, the Givens QR decomposition of A V gives
+	// U and the singular values. A is scaled by its largest magnitude first, so
+	// transposed(A) A stays in range.
+
+	// Eigenvalues (descending) and unit eigenvectors (columns of a rotation)
+	template <class T>
+	struct Eigen3
 	{
-		Mat<T, N> result;
+		Vec<T, 3> values;
+		Mat<T, 3> vectors;
+	};
 
-		for(int row = 0; row < N; row++)
+	// A = U diag(singular) transposed(V), U and V rotations: the singular values are in
+	// descending order of magnitude, the last one is negative when det(A) < 0
+	template <class T>
+	struct SVD3
+	{
+		Mat<T, 3> u;
+		Vec<T, 3> singular;
+		Mat<T, 3> v;
+	};
+
+	namespace kernels
+	{
+		const int JacobiSweeps = 5;
+		const size_t DecompositionGrain = 1024;
+
+		template <class T>
+		inline Mat<T, 3>
+		ToMat3(T const (&a)[3][3])
 		{
-			for(int column = 0; column < N; column++)
+			return Mat<T, 3>{ a[0][0], a[0][1], a[0][2], a[1][0], a[1][1], a[1][2], a[2][0], a[2][1], a[2][2] };
+		}
+
+		// Square root of 1 <= x <= 2 (the rotations): the Babylonian iteration of Sqrt
+		// from 1.5, stopped once it repeats a value (fixed point or 2-cycle, the smaller
+		// one is kept) instead of running one iteration per bit
+		template <class T>
+		inline T
+		RootNearOne(T const& x)
+		{
+			const int bits = sizeof(typename T::FractionalPart) * 8;
+			T half(false, 0, static_cast<typename T::FractionalPart>(static_cast<typename T::FractionalPart>(1) << (bits - 1)));
+			T root(false, 1, static_cast<typename T::FractionalPart>(static_cast<typename T::FractionalPart>(1) << (bits - 1)));
+			T previous(false, 0, 0);
+			for(int i = 0; i < (2 * bits); i++)
 			{
-				result.components[column][row] = components[row][column];
+				T value = x;
+				T next = (root + (value / root)) * half;
+				if (next == root)
+				{
+					return root;
+				}
+				if (next == previous)
+				{
+					return (next < root) ? next : root;
+				}
+				previous = root;
+				root = next;
 			}
+			return root;
 		}
 
-		*this = result;
-	}
+		// Symmetric a becomes diagonal, v (identity on entry) accumulates the rotations
+		template <class T>
+		inline void
+		Jacobi3(T (&a)[3][3], T (&v)[3][3], int sweeps)
+		{
+			static const int pairs[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+			T one(false, 1, 0);
+			T two(false, 2, 0);
+			for(int sweep = 0; sweep < sweeps; sweep++)
+			{
+				bool rotated = false;
+				for(auto const& pair : pairs)
+				{
+					int p = pair[0];
+					int q = pair[1];
+					int r = 3 - p - q;
+					if (Magnitude(a[p][q]) == 0)
+					{
+						continue;
+					}
+					rotated = true;
+
+					// t = tan(angle) = sign(d) 2 a[p][q] / (|d| + sqrt(d^2 + 4 a[p][q]^2)), d = a[q][q] - a[p][p]
+					T d = a[q][q] - a[p][p];
+					T o = two * a[p][q];
+					T largest = (Magnitude(d) > Magnitude(o)) ? T::Abs(d) : T::Abs(o);
+					T x = d / largest;
+					T y = o / largest;
+					T root = RootNearOne(x * x + y * y);
+					T t = Signed(y / (T::Abs(x) + root), T::IsNegative(d));
+					T c = one / RootNearOne(one + t * t);
+					T s = t * c;
+
+					T shift = t * a[p][q];
+					a[p][p] -= shift;
+					a[q][q] += shift;
+					a[p][q] = T(false, 0, 0);
+					a[q][p] = T(false, 0, 0);
+					T rp = a[r][p];
+					T rq = a[r][q];
+					a[r][p] = c * rp - s * rq;
+					a[r][q] = s * rp + c * rq;
+					a[p][r] = a[r][p];
+					a[q][r] = a[r][q];
+					for(int row = 0; row < 3; row++)
+					{
+						T vp = v[row][p];
+						T vq = v[row][q];
+						v[row][p] = c * vp - s * vq;
+						v[row][q] = s * vp + c * vq;
+					}
+				}
+				if (!rotated)
+				{
+					break;
+				}
+			}
+		}
 
-	template <class T, int N>
-	Mat<T, N>
-	Mat<T, N>::Transpose(Mat const& m)
-	{
-		Mat<T, N> result(m);
-		result.Transpose();
+		// Diagonal of a in descending order, with the columns of v; every swap negates
+		// a column, so v stays a rotation
+		template <class T>
+		inline void
+		SortEigen3(T (&a)[3][3], T (&v)[3][3])
+		{
+			static const int pairs[3][2] = { { 0, 1 }, { 1, 2 }, { 0, 1 } };
+			for(auto const& pair : pairs)
+			{
+				int i = pair[0];
+				int j = pair[1];
+				if (a[j][j] > a[i][i])
+				{
+					std::swap(a[i][i], a[j][j]);
+					for(int row = 0; row < 3; row++)
+					{
+						T x = v[row][i];
+						v[row][i] = v[row][j];
+						v[row][j] = Signed(x, true);
+					}
+				}
+			}
+		}
 
-		return result;
-	}
+		// Rotation of rows p and q of b zeroing b[q][column] (b[p][column] >= 0 after it),
+		// accumulated in the columns p and q of u
+		template <class T>
+		inline void
+		Givens3(T (&b)[3][3], T (&u)[3][3], int p, int q, int column)
+		{
+			T x = b[p][column];
+			T y = b[q][column];
+			if ((Magnitude(x) == 0) && (Magnitude(y) == 0))
+			{
+				return;
+			}
 
-	template <class T, int N>
-	std::string
-	Mat<T, N>::ToString() const
-	{
-		std::stringstream ss;
-		ss << "[";
+			T largest = (Magnitude(x) > Magnitude(y)) ? T::Abs(x) : T::Abs(y);
+			x /= largest;
+			y /= largest;
+			T root = RootNearOne(x * x + y * y);
+			T c = x / root;
+			T s = y / root;
+			for(int j = 0; j < 3; j++)
+			{
+				T bp = b[p][j];
+				T bq = b[q][j];
+				b[p][j] = c * bp + s * bq;
+				b[q][j] = c * bq - s * bp;
+			}
+			b[q][column] = T(false, 0, 0);
+			for(int row = 0; row < 3; row++)
+			{
+				T up = u[row][p];
+				T uq = u[row][q];
+				u[row][p] = c * up + s * uq;
+				u[row][q] = c * uq - s * up;
+			}
+		}
 
-		for(int row = 0; row < N; row++)
+		template <class T>
+		inline Eigen3<T>
+		EigenSymmetric(Mat<T, 3> const& m, int sweeps)
 		{
-			ss << "(";
-			for(int column = 0; column < N; column++)
+			T a[3][3];
+			T v[3][3] = {};
+			CopyMat(m, a);
+			for(int row = 0; row < 3; row++)
+			{
+				v[row][row] = T(false, 1, 0);
+			}
+
+			Jacobi3(a, v, sweeps);
+			SortEigen3(a, v);
+			return Eigen3<T>{ Vec<T, 3>{ a[0][0], a[1][1], a[2][2] }, ToMat3(v) };
+		}
+
+		template <class T>
+		inline SVD3<T>
+		SVD(Mat<T, 3> const& m, int sweeps)
+		{
+			T zero(false, 0, 0);
+			T largest = zero;
+			for(int row = 0; row < 3; row++)
+			{
+				for(int column = 0; column < 3; column++)
+				{
+					if (Magnitude(m.Component(row, column)) > Magnitude(largest))
+					{
+						largest = T::Abs(m.Component(row, column));
+					}
+				}
+			}
+			if (Magnitude(largest) == 0)
 			{
-				ss << components[row][column].ToString();
-				if (column != (N - 1))
+				return SVD3<T>{ Mat<T, 3>(true), Vec<T, 3>{ zero, zero, zero }, Mat<T, 3>(true) };
+			}
+
+			// Eigenvectors of transposed(A) A (A scaled)
+			T a[3][3];
+			for(int row = 0; row < 3; row++)
+			{
+				for(int column = 0; column < 3; column++)
+				{
+					T x = m.Component(row, column);
+					a[row][column] = x / largest;
+				}
+			}
+			T s[3][3];
+			T v[3][3] = {};
+			for(int row = 0; row < 3; row++)
+			{
+				for(int column = 0; column < 3; column++)
 				{
-					ss << ", ";
+					T sum(false, 0, 0);
+					for(int index = 0; index < 3; index++)
+					{
+						T x = a[index][row];
+						sum += x * a[index][column];
+					}
+					s[row][column] = sum;
 				}
+				v[row][row] = T(false, 1, 0);
 			}
-			ss << ")";
-			if (row != (N - 1))
+			Jacobi3(s, v, sweeps);
+			SortEigen3(s, v);
+
+			// A V = U R (Givens rotations), R diagonal up to the rounding errors
+			T b[3][3];
+			T u[3][3] = {};
+			for(int row = 0; row < 3; row++)
 			{
-				ss << ", ";
+				for(int column = 0; column < 3; column++)
+				{
+					T sum(false, 0, 0);
+					for(int index = 0; index < 3; index++)
+					{
+						T x = a[row][index];
+						sum += x * v[index][column];
+					}
+					b[row][column] = sum;
+				}
+				u[row][row] = T(false, 1, 0);
 			}
+			Givens3(b, u, 0, 1, 0);
+			Givens3(b, u, 0, 2, 0);
+			Givens3(b, u, 1, 2, 1);
+
+			return SVD3<T>{ ToMat3(u), Vec<T, 3>{ b[0][0] * largest, b[1][1] * largest, b[2][2] * largest }, ToMat3(v) };
 		}
+	}
 
-		ss << "]";
-		return ss.str();
+	// Symmetric matrix (the lower triangle must mirror the upper one), e.g. the principal
+	// axes and variances of a covariance matrix or of an inertia tensor
+	template <class T>
+	Eigen3<T>
+	EigenSymmetric(Mat<T, 3> const& m, int sweeps = kernels::JacobiSweeps)
+	{
+		return kernels::EigenSymmetric(m, sweeps);
 	}
 
-	// SFINAE
-	template <class T, int N>
-	static T
-	Det(typename std::enable_if<N == 2, Mat<T, N>>::type m)
+	template <class T>
+	SVD3<T>
+	SVD(Mat<T, 3> const& m, int sweeps = kernels::JacobiSweeps)
 	{
-		return m[0][0] * m[1][1] - m[0][1] * m[1][0];
+		return kernels::SVD(m, sweeps);
 	}
 
-	// Laplace rows develop
-	template <class T, int N>
-	static T
-	Det(typename std::enable_if<N != 2, Mat<T, N>>::type m)
+	// Rotation R of the polar decomposition m = R S (U transposed(V)). Best fit rotation
+	// (Kabsch) of the centered points p[i] onto q[i]: m = sum of q[i] transposed(p[i]).
+	template <class T>
+	Mat<T, 3>
+	NearestRotation(Mat<T, 3> const& m, int sweeps = kernels::JacobiSweeps)
 	{
-		T result(false, 0, 0);
+		SVD3<T> svd = kernels::SVD(m, sweeps);
+		return Mat<T, 3>::Multiply(svd.u, Mat<T, 3>::Transpose(svd.v));
+	}
 
-		// Iterate all the columns of the 1st row (develop is made over the 1st row)
-		for(int i = 0; i < N; i++)
+	// Batch decompositions (same results as the functions on a single matrix), split
+	// between the worker threads
+	template <class T>
+	void
+	EigenSymmetricMany(Span<Mat<T, 3> const> m, Span<Eigen3<T>> result, int sweeps = kernels::JacobiSweeps)
+	{
+		if (m.Size() != result.Size())
 		{
-			T coeff(((i % 2) == 0) ? false : true, 1, 0);
+			throw FPException("Invalid size");
+		}
 
-			// Compute Cofactor matrix
-			std::vector<T> values;
-			for(int j = 1; j < N; j++)
+		Mat<T, 3> const* source = m.Data();
+		Eigen3<T>* destination = result.Data();
+		kernels::ParallelFor(m.Size(), kernels::DecompositionGrain, [source, destination, sweeps](size_t first, size_t last)
+		{
+			for(size_t i = first; i < last; i++)
 			{
-				for(int k = 0; k < N; k++)
-				{
-					if (k != i)
-					{
-						values.push_back(m[j][k]);
-					}
-				}
+				destination[i] = kernels::EigenSymmetric(source[i], sweeps);
 			}
-			Mat<T, N - 1> mm(values);
-			// Compute partial result
-			result += coeff * m[0][i] * Det<T, N - 1>(mm);
+			return 0u;
+		});
+	}
+
+	template <class T>
+	void
+	SVDMany(Span<Mat<T, 3> const> m, Span<SVD3<T>> result, int sweeps = kernels::JacobiSweeps)
+	{
+		if (m.Size() != result.Size())
+		{
+			throw FPException("Invalid size");
 		}
 
-		return result;
+		Mat<T, 3> const* source = m.Data();
+		SVD3<T>* destination = result.Data();
+		kernels::ParallelFor(m.Size(), kernels::DecompositionGrain, [source, destination, sweeps](size_t first, size_t last)
+		{
+			for(size_t i = first; i < last; i++)
+			{
+				destination[i] = kernels::SVD(source[i], sweeps);
+			}
+			return 0u;
+		});
 	}
 
-	// Helpers
-	typedef Mat<FixedPointSmall, 2> Mat2x2Small;
-	typedef Mat<FixedPointMedium, 2> Mat2x2Medium;
-	typedef Mat<FixedPointLarge, 2> Mat2x2Large;
-	typedef Mat<FixedPointSmall, 3> Mat3x3Small;
-	typedef Mat<FixedPointMedium, 3> Mat3x3Medium;
-	typedef Mat<FixedPointLarge, 3> Mat3x3Large;
-	typedef Mat<FixedPointSmall, 4> Mat4x4Small;
-	typedef Mat<FixedPointMedium, 4> Mat4x4Medium;
-	typedef Mat<FixedPointLarge, 4> Mat4x4Large;
+	// Batch polar rotations / best fit rotations
+	template <class T>
+	void
+	NearestRotationMany(Span<Mat<T, 3> const> m, Span<Mat<T, 3>> rotation, int sweeps = kernels::JacobiSweeps)
+	{
+		if (m.Size() != rotation.Size())
+		{
+			throw FPException("Invalid size");
+		}
+
+		Mat<T, 3> const* source = m.Data();
+		Mat<T, 3>* destination = rotation.Data();
+		kernels::ParallelFor(m.Size(), kernels::DecompositionGrain, [source, destination, sweeps](size_t first, size_t last)
+		{
+			for(size_t i = first; i < last; i++)
+			{
+				destination[i] = NearestRotation(source[i], sweeps);
+			}
+			return 0u;
+		});
+	}
 }
 #endif
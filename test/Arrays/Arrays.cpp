@@ -0,0 +1,372 @@
+// Arrays.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+
+#include <iostream>
+#include <cstdlib>
+#include <random>
+#include <new>
+#include "..\..\src\SFPMLib.h"
+
+using namespace sfpmlib;
+
+// Allocation hook: counts the live blocks and makes the next allocation fail on request
+static size_t liveBlocks = 0;
+static bool failNextAllocation = false;
+
+void*
+operator new(size_t size)
+{
+	void* block = failNextAllocation ? nullptr : malloc(size ? size : 1);
+	failNextAllocation = false;
+	if (!block)
+	{
+		throw std::bad_alloc();
+	}
+	++liveBlocks;
+	return block;
+}
+
+void
+operator delete(void* block) noexcept
+{
+	if (block)
+	{
+		--liveBlocks;
+		free(block);
+	}
+}
+
+void
+operator delete(void* block, size_t) noexcept
+{
+	if (block)
+	{
+		--liveBlocks;
+		free(block);
+	}
+}
+
+// Element-wise operations of FixedPointArray checked against the same
+// operations computed with doubles (at most one unit of difference in the last bit).
+template <class T>
+void ArrayFP(char const* name, double start, double end, double increment)
+{
+	using FP = FixedPoint<T>;
+	using Array = FixedPointArray<T>;
+
+	std::string s("ArrayFP");
+	s += name;
+	s += ".txt";
+
+	FILE* f = fopen(s.c_str(), "w");
+	if (f)
+	{
+		std::vector<FP> a;
+		std::vector<FP> b;
+		for(double arg = start; arg < end; arg += increment)
+		{
+			a.push_back(FP::FromDouble(arg));
+			b.push_back(FP::FromDouble(1.0 + ((end - arg) / 7.0)));
+		}
+
+		Array x(a);
+		Array y(b);
+		Array sum = x + y;
+		Array difference = x - y;
+		Array product = x * y;
+		Array quotient = x / y;
+		Array minimum = Array::Min(x, y);
+		Array maximum = Array::Max(x, y);
+		Array absolute = Array::Abs(x);
+		FP low = FP::FromDouble(start / 2.0);
+		FP high = FP::FromDouble(end / 3.0);
+		Array clamped = Array::Clamp(x, low, high);
+		Array accumulator(y);
+		accumulator.MultiplyAccumulate(x, y);
+
+		const double epsilon = FP(false, 0, 1).ToDouble();
+		size_t mismatches = 0;
+		for(size_t i = 0; i < a.size(); i++)
+		{
+			double u = a[i].ToDouble();
+			double v = b[i].ToDouble();
+			double clamp = (u < low.ToDouble()) ? low.ToDouble() : ((u > high.ToDouble()) ? high.ToDouble() : u);
+			double expected[] = { u + v, u - v, u * v, u / v, (u < v) ? u : v, (u > v) ? u : v, fabs(u), clamp, v + (u * v) };
+			Array const* results[] = { &sum, &difference, &product, &quotient, &minimum, &maximum, &absolute, &clamped, &accumulator };
+			for(size_t j = 0; j < 9; j++)
+			{
+				if (fabs(results[j]->Get(i).ToDouble() - expected[j]) > epsilon)
+				{
+					++mismatches;
+				}
+			}
+			fprintf(f, "%s;%s;%s;%s;%s;%s\n", a[i].ToString().c_str(), b[i].ToString().c_str(), sum.Get(i).ToString().c_str(), difference.Get(i).ToString().c_str(), product.Get(i).ToString().c_str(), quotient.Get(i).ToString().c_str());
+		}
+		std::cout << "Array/double mismatches: " << mismatches << std::endl;
+
+		fclose(f);
+	}
+}
+
+// Sums, differences, products and multiply-accumulates that overflow saturate to the
+// limits of the raw values
+template <class T>
+void SaturationFP(char const* name)
+{
+	using Array = FixedPointArray<T>;
+	using Raw = typename Array::Raw;
+
+	const Raw largest = std::numeric_limits<Raw>::max();
+	const Raw smallest = std::numeric_limits<Raw>::min();
+	const Raw two = static_cast<Raw>(static_cast<Raw>(2) << (sizeof(Raw) * 4));
+	Raw a[] = { largest, smallest, largest, smallest, two };
+	Raw b[] = { largest, smallest, smallest, two, largest };
+	Raw c[] = { largest, largest, smallest, smallest, 0 };
+	Array x(5);
+	Array y(5);
+	Array accumulator(5);
+	for(size_t i = 0; i < 5; i++)
+	{
+		x.Data()[i] = a[i];
+		y.Data()[i] = b[i];
+		accumulator.Data()[i] = c[i];
+	}
+
+	Array sum = x + y;
+	Array difference = x - y;
+	Array product = x * y;
+	accumulator.MultiplyAccumulate(x, y);
+
+	Raw sums[] = { largest, smallest };
+	Raw differences[] = { 0, 0, largest, smallest };
+	Raw products[] = { largest, largest, smallest, smallest, largest };
+	Raw accumulators[] = { largest, largest, smallest, smallest, largest };
+	size_t mismatches = 0;
+	for(size_t i = 0; i < 5; i++)
+	{
+		mismatches += (i < 2) && (sum.Data()[i] != sums[i]);
+		mismatches += (i >= 2) && (i < 4) && (difference.Data()[i] != differences[i]);
+		mismatches += (product.Data()[i] != products[i]);
+		mismatches += (accumulator.Data()[i] != accumulators[i]);
+	}
+	std::cout << name << " saturation mismatches: " << mismatches << std::endl;
+}
+
+// Every FixedPointArray operation, on every instruction set supported by the CPU,
+// gives the same results as the scalar kernels. The raw values mix random magnitudes
+// with the limits (saturated sums, differences and products), small divisors and
+// zero divisors, over lengths that leave a tail after the SIMD loops.
+const size_t DispatchOperations = 10;
+
+template <class T>
+void DispatchResults(FixedPointArray<T> const& x, FixedPointArray<T> const& y, FixedPointArray<T> const& z, FixedPointArray<T>* results)
+{
+	using FP = FixedPoint<T>;
+	using Array = FixedPointArray<T>;
+	using Raw = typename Array::Raw;
+
+	results[0] = x + y;
+	results[1] = x - y;
+	results[2] = x * y;
+	results[3] = x;
+	try
+	{
+		results[3] /= y;
+	}
+	catch(FPException const&)
+	{
+		// The elements divided by zero hold the saturated value
+	}
+	results[4] = z;
+	results[4].MultiplyAccumulate(x, y);
+	results[5] = Array::Min(x, y);
+	results[6] = Array::Max(x, y);
+	results[7] = Array::Abs(x);
+	results[8] = Array::Clamp(x, Array::FromRaw(std::numeric_limits<Raw>::min()), Array::FromRaw(std::numeric_limits<Raw>::max()));
+	results[9] = Array::Clamp(x, FP(true, 1, 0), FP(false, 0, 0x80));
+}
+
+template <class T>
+void DispatchFP(char const* name)
+{
+	using Array = FixedPointArray<T>;
+	using Raw = typename Array::Raw;
+
+	const Raw largest = std::numeric_limits<Raw>::max();
+	const Raw smallest = std::numeric_limits<Raw>::min();
+	const Raw special[] = { largest, smallest, static_cast<Raw>(largest - 1), static_cast<Raw>(smallest + 1), 0, 1, -1, 2, -2, static_cast<Raw>(largest / 2), static_cast<Raw>(smallest / 2) };
+	const size_t specials = sizeof(special) / sizeof(special[0]);
+	const size_t lengths[] = { 1, 2, 3, 5, 7, 9, 15, 17, 31, 33, 63, 65, 1000, 4099 };
+
+	std::mt19937_64 generator(sizeof(T));
+	InstructionSet supported = SupportedInstructionSet();
+	size_t mismatches = 0;
+	for(size_t length : lengths)
+	{
+		Array x(length);
+		Array y(length);
+		Array z(length);
+		Array* arrays[] = { &x, &y, &z };
+		for(Array* array : arrays)
+		{
+			for(size_t i = 0; i < length; i++)
+			{
+				// A quarter of special values, the others with magnitudes spread over every power of two
+				if ((generator() % 4) == 0)
+				{
+					array->Data()[i] = special[generator() % specials];
+				}
+				else
+				{
+					T magnitude = static_cast<T>(static_cast<T>(generator()) >> (generator() % (sizeof(T) * 8)));
+					array->Data()[i] = static_cast<Raw>(((generator() % 2) != 0) ? static_cast<T>(0 - magnitude) : magnitude);
+				}
+			}
+		}
+
+		SetInstructionSet(InstructionSet::Scalar);
+		Array expected[DispatchOperations];
+		DispatchResults(x, y, z, expected);
+		InstructionSet sets[] = { InstructionSet::Sse2, InstructionSet::Avx2, InstructionSet::Avx512 };
+		for(InstructionSet set : sets)
+		{
+			if (set > supported)
+			{
+				break;
+			}
+
+			SetInstructionSet(set);
+			Array results[DispatchOperations];
+			DispatchResults(x, y, z, results);
+			for(size_t j = 0; j < DispatchOperations; j++)
+			{
+				for(size_t i = 0; i < length; i++)
+				{
+					mismatches += (results[j].Data()[i] != expected[j].Data()[i]);
+				}
+			}
+		}
+	}
+	SetInstructionSet(supported);
+	std::cout << name << " instruction set/scalar mismatches: " << mismatches << std::endl;
+}
+
+// Range of the raw values: the limits are stored exactly, the values beyond them throw
+template <class T>
+void RangeFP(char const* name)
+{
+	using FP = FixedPoint<T>;
+	using Array = FixedPointArray<T>;
+	using Raw = typename Array::Raw;
+
+	const T largest = static_cast<T>(std::numeric_limits<Raw>::max());
+	FP inside[] = { FP(false, largest), FP(true, static_cast<T>(largest + 1)), FP(false, 0), FP(true, 1) };
+	FP outside[] = { FP(false, static_cast<T>(largest + 1)), FP(true, static_cast<T>(largest + 2)), FP(false, std::numeric_limits<T>::max()), FP(true, std::numeric_limits<T>::max()) };
+
+	size_t mismatches = 0;
+	Array x(4);
+	for(size_t i = 0; i < 4; i++)
+	{
+		x.Set(i, inside[i]);
+		mismatches += (x.Get(i) != inside[i]);
+
+		bool thrown = false;
+		try
+		{
+			x.Set(i, outside[i]);
+		}
+		catch(FPException const&)
+		{
+			thrown = true;
+		}
+		mismatches += !thrown;
+	}
+	std::cout << name << " range mismatches: " << mismatches << std::endl;
+}
+
+// Failed allocations and conversions leave the arrays as they were, without leaks
+template <class T>
+void FailureFP(char const* name)
+{
+	using FP = FixedPoint<T>;
+	using Array = FixedPointArray<T>;
+
+	size_t mismatches = 0;
+	{
+		FP values[] = { FP(false, 1, 0), FP(true, 2, 0), FP(false, 3, 0) };
+		Array small(Span<FP const>(values, 3));
+		Array large(5);
+		size_t before = liveBlocks;
+
+		bool thrown = false;
+		failNextAllocation = true;
+		try
+		{
+			small = large;
+		}
+		catch(std::bad_alloc const&)
+		{
+			thrown = true;
+		}
+		mismatches += !thrown + (small.Size() != 3) + (liveBlocks != before);
+		for(size_t i = 0; i < 3; i++)
+		{
+			mismatches += (small.Get(i) != values[i]);
+		}
+
+		small = large;
+		mismatches += (small.Size() != 5) + (small.Get(4) != FP(false, 0, 0)) + (liveBlocks != before);
+
+		thrown = false;
+		FP outside[] = { FP(false, 1, 0), FP(false, std::numeric_limits<T>::max()) };
+		try
+		{
+			Array x(Span<FP const>(outside, 2));
+		}
+		catch(FPException const&)
+		{
+			thrown = true;
+		}
+		mismatches += !thrown + (liveBlocks != before);
+	}
+	std::cout << name << " failure mismatches: " << mismatches << std::endl;
+}
+
+int main()
+{
+	std::cout << "Test 8.8 fixed point arrays" << std::endl;
+	ArrayFP<uint16_t>("Small", -10.0, 10.0, 0.013);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test 16.16 fixed point arrays" << std::endl;
+	ArrayFP<uint32_t>("Medium", -150.0, 150.0, 0.0173);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test 32.32 fixed point arrays" << std::endl;
+	ArrayFP<uint64_t>("Large", -1000.0, 1000.0, 0.0771);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test the range of the raw values" << std::endl;
+	RangeFP<uint16_t>("Small");
+	RangeFP<uint32_t>("Medium");
+	RangeFP<uint64_t>("Large");
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test saturated results" << std::endl;
+	SaturationFP<uint16_t>("Small");
+	SaturationFP<uint32_t>("Medium");
+	SaturationFP<uint64_t>("Large");
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test failed assignments and conversions" << std::endl;
+	FailureFP<uint16_t>("Small");
+	FailureFP<uint32_t>("Medium");
+	FailureFP<uint64_t>("Large");
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test run time kernel selection" << std::endl;
+	DispatchFP<uint16_t>("Small");
+	DispatchFP<uint32_t>("Medium");
+	DispatchFP<uint64_t>("Large");
+	std::cout << "Done" << std::endl;
+}
@@ -0,0 +1,159 @@
+// Conversions.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+
+#include <iostream>
+#include "..\..\src\SFPMLib.h"
+
+using namespace sfpmlib;
+
+template <class T, class U>
+void WidthFP(char const* name, U start, U end, U increment)
+{
+	std::string s("WidthFP");
+	s += name;
+	s += ".txt";
+
+	FILE* f = fopen(s.c_str(), "w");
+	if (f)
+	{
+		std::vector<U> source;
+		for(U arg = start; arg < end; arg += increment)
+		{
+			source.push_back(arg);
+		}
+
+		std::vector<T> destination(source.size());
+		Convert(source.data(), destination.data(), source.size());
+
+		size_t mismatches = 0;
+		for(size_t i = 0; i < source.size(); i++)
+		{
+			T val(source[i]);
+			if (val != destination[i])
+			{
+				++mismatches;
+			}
+			fprintf(f, "%s;%s\n", source[i].ToString().c_str(), val.ToString().c_str());
+		}
+		std::cout << "Bulk/scalar mismatches: " << mismatches << std::endl;
+
+		fclose(f);
+	}
+}
+
+template <class T>
+void FloatFP(double start, double end, double increment)
+{
+	std::string s("FloatFP");
+	if (sizeof(typename T::IntegerPart) == 1)
+	{
+		s += "Small";
+	}
+	else if (sizeof(typename T::IntegerPart) == 2)
+	{
+		s += "Medium";
+	}
+	else
+	{
+		s += "Large";
+	}
+	s += ".txt";
+
+	FILE* f = fopen(s.c_str(), "w");
+	if (f)
+	{
+		std::vector<float> source;
+		for(double arg = start; arg < end; arg += increment)
+		{
+			source.push_back(static_cast<float>(arg));
+		}
+
+		std::vector<T> destination(source.size());
+		std::vector<double> back(source.size());
+		T::FromFloat(source, destination);
+		T::ToDouble(destination, back);
+
+		size_t mismatches = 0;
+		for(size_t i = 0; i < source.size(); i++)
+		{
+			T val = T::FromFloat(source[i]);
+			if ((val != destination[i]) || (val.ToDouble() != back[i]))
+			{
+				++mismatches;
+			}
+			fprintf(f, "%.9g;%s;%.17g\n", source[i], val.ToString().c_str(), val.ToDouble());
+		}
+		std::cout << "Bulk/scalar mismatches: " << mismatches << std::endl;
+
+		fclose(f);
+	}
+}
+
+template <class T>
+void ParseFP(char const* name, T start, T end, T increment)
+{
+	std::string s("ParseFP");
+	s += name;
+	s += ".txt";
+
+	FILE* f = fopen(s.c_str(), "w");
+	if (f)
+	{
+		size_t mismatches = 0;
+		for(T arg = start; arg < end; arg += increment)
+		{
+			char buffer[T::MaxFormatLength];
+			FormatResult formatted = arg.Format(buffer, buffer + sizeof(buffer));
+
+			T val;
+			ParseResult parsed = T::Parse(buffer, formatted.ptr, val);
+			if ((parsed.ec != std::errc()) || (parsed.ptr != formatted.ptr) || (val != arg))
+			{
+				++mismatches;
+			}
+			fprintf(f, "%s;%s\n", std::string(buffer, formatted.ptr).c_str(), val.ToString().c_str());
+		}
+		std::cout << "Format/Parse mismatches: " << mismatches << std::endl;
+
+		fclose(f);
+	}
+}
+
+int main()
+{
+	std::cout << "Test Q8.8 => Q16.16 conversion" << std::endl;
+	WidthFP<FixedPointMedium>("SmallToMedium", FixedPointSmall::FromString("-100.0"), FixedPointSmall::FromString("100.0"), FixedPointSmall::FromString("0.01"));
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Q16.16 => Q8.8 conversion" << std::endl;
+	WidthFP<FixedPointSmall>("MediumToSmall", FixedPointMedium::FromString("-300.0"), FixedPointMedium::FromString("300.0"), FixedPointMedium::FromString("0.001"));
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Q16.16 => Q32.32 conversion" << std::endl;
+	WidthFP<FixedPointLarge>("MediumToLarge", FixedPointMedium::FromString("-100.0"), FixedPointMedium::FromString("100.0"), FixedPointMedium::FromString("0.001"));
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Q32.32 => Q16.16 conversion" << std::endl;
+	WidthFP<FixedPointMedium>("LargeToMedium", FixedPointLarge::FromString("-70000.0"), FixedPointLarge::FromString("70000.0"), FixedPointLarge::FromString("0.3"));
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test float <=> 8.8 fixed point numbers" << std::endl;
+	FloatFP<FixedPointSmall>(-300.0, 300.0, 0.0013);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test float <=> 16.16 fixed point numbers" << std::endl;
+	FloatFP<FixedPointMedium>(-70000.0, 70000.0, 0.17);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test float <=> 32.32 fixed point numbers" << std::endl;
+	FloatFP<FixedPointLarge>(-100.0, 100.0, 0.0007);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test text <=> 8.8 fixed point numbers" << std::endl;
+	ParseFP<FixedPointSmall>("Small", FixedPointSmall::FromString("-127.0"), FixedPointSmall::FromString("127.0"), FixedPointSmall::FromString("0.00390625"));
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test text <=> 16.16 fixed point numbers" << std::endl;
+	ParseFP<FixedPointMedium>("Medium", FixedPointMedium::FromString("-30000.0"), FixedPointMedium::FromString("30000.0"), FixedPointMedium::FromString("0.0173"));
+	std::cout << "Done" << std::endl;
+}
@@ -2,6 +2,7 @@
 //
 
 #include <iostream>
+#include <random>
 #include "..\..\src\SFPMLib.h"
 
 using namespace sfpmlib;
@@ -99,6 +100,178 @@ void ParabolicFP(T start, T end, T increment)
 	}
 }
 
+// Batch functions checked against the double precision ones
+// (the batch results are rounded to the nearest fixed point number)
+template <class T>
+void BatchFP(T start, T end, T increment)
+{
+	std::string s("BatchFP");
+	if (sizeof(typename T::IntegerPart) == 1)
+	{
+		s += "Small";
+	}
+	else if (sizeof(typename T::IntegerPart) == 2)
+	{
+		s += "Medium";
+	}
+	else
+	{
+		s += "Large";
+	}
+	s += ".txt";
+
+	FILE* f = fopen(s.c_str(), "w");
+	if (f)
+	{
+		std::vector<T> args;
+		for(T arg = start; arg < end; arg += increment)
+		{
+			args.push_back(arg);
+		}
+
+		std::vector<T> exponents(args.size(), T::FromDouble(1.5));
+		std::vector<T> exps(args.size());
+		std::vector<T> logs(args.size());
+		std::vector<T> logs2(args.size());
+		std::vector<T> pows(args.size());
+		T::Exp(args, exps);
+		T::Log(args, logs, T(false, 10, 0));
+		T::Log2(args, logs2);
+		T::Pow(args, exponents, pows);
+
+		const double epsilon = T(false, 0, 1).ToDouble() / 2.0;
+		size_t mismatches = 0;
+		for(size_t i = 0; i < args.size(); i++)
+		{
+			double x = args[i].ToDouble();
+			double expected[] = { exp(x), log10(x), log2(x), pow(x, 1.5) };
+			T const* results[] = { &exps[i], &logs[i], &logs2[i], &pows[i] };
+			for(size_t j = 0; j < 4; j++)
+			{
+				if (fabs(results[j]->ToDouble() - expected[j]) > epsilon)
+				{
+					++mismatches;
+				}
+			}
+			fprintf(f, "%s;%s;%s;%s;%s\n", args[i].ToString().c_str(), exps[i].ToString().c_str(), logs[i].ToString().c_str(), logs2[i].ToString().c_str(), pows[i].ToString().c_str());
+		}
+		std::cout << "Batch/double mismatches: " << mismatches << std::endl;
+
+		fclose(f);
+	}
+}
+
+// Batch square roots checked against the scalar ones (bit exact). Negative inputs
+// (and zero roots for RSqrt) give 0 and throw once the whole span is computed.
+// The magnitudes of the vectors are checked on the arguments whose squares fit.
+template <class T>
+void SqrtFP(char const* name, std::vector<T> const& args)
+{
+	std::string s("SqrtFP");
+	s += name;
+	s += ".txt";
+
+	FILE* f = fopen(s.c_str(), "w");
+	if (f)
+	{
+		const T bound(false, static_cast<typename T::IntegerPart>(1u << ((sizeof(typename T::IntegerPart) * 4) - 1)), 0);
+		std::vector<Vec<T, 3>> vectors;
+		for(T const& arg : args)
+		{
+			if ((T::Abs(arg) < bound) && !T::IsNegative(arg))
+			{
+				vectors.push_back(Vec<T, 3>{ arg, T(arg) / T(false, 2, 0), T(false, 1, 0) });
+			}
+		}
+
+		std::vector<T> roots(args.size());
+		std::vector<T> reciprocals(args.size());
+		std::vector<T> magnitudes(vectors.size());
+		try
+		{
+			T::Sqrt(args, roots);
+		}
+		catch(FPException const&)
+		{
+		}
+		try
+		{
+			T::RSqrt(args, reciprocals);
+		}
+		catch(FPException const&)
+		{
+		}
+		Vec<T, 3>::Mod(vectors, magnitudes);
+
+		size_t mismatches = 0;
+		for(size_t i = 0; i < args.size(); i++)
+		{
+			T root;
+			T reciprocal;
+			if (!T::IsNegative(args[i]))
+			{
+				root = T::Sqrt(args[i]);
+				reciprocal = (root != T()) ? (T(false, 1, 0) / root) : T();
+			}
+			if ((root != roots[i]) || (reciprocal != reciprocals[i]))
+			{
+				++mismatches;
+			}
+			fprintf(f, "%s;%s;%s\n", args[i].ToString().c_str(), roots[i].ToString().c_str(), reciprocals[i].ToString().c_str());
+		}
+		for(size_t i = 0; i < vectors.size(); i++)
+		{
+			if (vectors[i].Mod() != magnitudes[i])
+			{
+				++mismatches;
+			}
+		}
+		std::cout << name << " batch/scalar mismatches: " << mismatches << std::endl;
+
+		fclose(f);
+	}
+}
+
+// Every raw value, with both signs
+template <class T>
+std::vector<FixedPoint<T>> AllRawValues()
+{
+	std::vector<FixedPoint<T>> args;
+	for(uint64_t raw = 0; raw <= std::numeric_limits<T>::max(); raw++)
+	{
+		args.push_back(FixedPoint<T>(false, static_cast<T>(raw)));
+		args.push_back(FixedPoint<T>(true, static_cast<T>(raw)));
+	}
+	return args;
+}
+
+// The whole magnitude range: raw 1 to the largest value, the neighbours of every
+// power of two and random magnitudes spread over every power of two
+template <class T>
+std::vector<FixedPoint<T>> RawMagnitudes(size_t count)
+{
+	const int bits = static_cast<int>(sizeof(T) * 8);
+
+	std::vector<FixedPoint<T>> args;
+	args.push_back(FixedPoint<T>(false, static_cast<T>(0)));
+	args.push_back(FixedPoint<T>(false, std::numeric_limits<T>::max()));
+	args.push_back(FixedPoint<T>(false, static_cast<T>(std::numeric_limits<T>::max() - 1)));
+	for(int bit = 0; bit < bits; bit++)
+	{
+		T power = static_cast<T>(static_cast<T>(1) << bit);
+		args.push_back(FixedPoint<T>(false, static_cast<T>(power - 1)));
+		args.push_back(FixedPoint<T>(false, power));
+		args.push_back(FixedPoint<T>(false, static_cast<T>(power + 1)));
+	}
+
+	std::mt19937_64 generator(bits);
+	for(size_t i = 0; i < count; i++)
+	{
+		args.push_back(FixedPoint<T>(false, static_cast<T>(static_cast<T>(generator()) >> (generator() % bits))));
+	}
+	return args;
+}
+
 int main()
 {
 	// 8.8 fixed point numbers
@@ -124,6 +297,17 @@ int main()
 	ParabolicFP(startSmall, endSmall, incrementSmall);
 	std::cout << "Done" << std::endl;
 
+	startSmall = FixedPointSmall::FromString("0.01");
+	endSmall = FixedPointSmall::FromString("5.0");
+	incrementSmall = FixedPointSmall::FromString("0.01");
+	std::cout << "Test batch Exp/Log/Log2/Pow with 8.8 fixed point numbers" << std::endl;
+	BatchFP(startSmall, endSmall, incrementSmall);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test batch Sqrt/RSqrt with 8.8 fixed point numbers" << std::endl;
+	SqrtFP("Small", AllRawValues<uint16_t>());
+	std::cout << "Done" << std::endl;
+
 	// 16.16 fixed point numbers
 	FixedPointMedium startMedium = FixedPointMedium::FromString("0.0001");
 	FixedPointMedium endMedium = FixedPointMedium::FromString("10000.0");
@@ -147,6 +331,17 @@ int main()
 	ParabolicFP(startMedium, endMedium, incrementMedium);
 	std::cout << "Done" << std::endl;
 
+	startMedium = FixedPointMedium::FromString("0.01");
+	endMedium = FixedPointMedium::FromString("5.0");
+	incrementMedium = FixedPointMedium::FromString("0.001");
+	std::cout << "Test batch Exp/Log/Log2/Pow with 16.16 fixed point numbers" << std::endl;
+	BatchFP(startMedium, endMedium, incrementMedium);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test batch Sqrt/RSqrt with 16.16 fixed point numbers" << std::endl;
+	SqrtFP("Medium", RawMagnitudes<uint32_t>(100000));
+	std::cout << "Done" << std::endl;
+
 	// 32.32 fixed point numbers
 	FixedPointLarge startLarge = FixedPointLarge::FromString("0.0001");
 	FixedPointLarge endLarge = FixedPointLarge::FromString("10000.0");
@@ -169,4 +364,15 @@ int main()
 	std::cout << "Test x^2 with 16.16 fixed point numbers" << std::endl;
 	ParabolicFP(startLarge, endLarge, incrementLarge);
 	std::cout << "Done" << std::endl;
+
+	startLarge = FixedPointLarge::FromString("0.01");
+	endLarge = FixedPointLarge::FromString("5.0");
+	incrementLarge = FixedPointLarge::FromString("0.001");
+	std::cout << "Test batch Exp/Log/Log2/Pow with 32.32 fixed point numbers" << std::endl;
+	BatchFP(startLarge, endLarge, incrementLarge);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test batch Sqrt/RSqrt with 32.32 fixed point numbers" << std::endl;
+	SqrtFP("Large", RawMagnitudes<uint64_t>(20000));
+	std::cout << "Done" << std::endl;
 }
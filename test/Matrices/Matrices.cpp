@@ -0,0 +1,1195 @@
+// Matrices.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+
+#include <iostream>
+#include <random>
+#include <memory>
+#include <cmath>
+#include "..\..\src\SFPMLib.h"
+
+using namespace sfpmlib;
+
+static bool
+Same(FixedPointMedium const& a, FixedPointMedium const& b)
+{
+	// operator== is not enough: the sign of the zero results is checked too
+	return (a == b) && (FixedPointMedium::IsNegative(a) == FixedPointMedium::IsNegative(b));
+}
+
+// Random components: zeros, integers and magnitudes below range
+template <class T>
+static T
+Component(std::mt19937& generator, unsigned range)
+{
+	switch(generator() % 4)
+	{
+	case 0:
+		return T(false, 0, 0);
+	case 1:
+		return T((generator() % 2) != 0, static_cast<typename T::IntegerPart>(generator() % range), 0);
+	default:
+		return T((generator() % 2) != 0, static_cast<typename T::IntegerPart>(generator() % range), static_cast<typename T::FractionalPart>(generator()));
+	}
+}
+
+// Reference determinant: Laplace expansion along the 1st row
+template <class T>
+static T
+Laplace(std::vector<T> const& m, int n)
+{
+	if (n == 2)
+	{
+		T a = m[0];
+		T b = m[1];
+		return a * m[3] - b * m[2];
+	}
+
+	T result(false, 0, 0);
+	for(int i = 0; i < n; i++)
+	{
+		std::vector<T> minor;
+		for(int row = 1; row < n; row++)
+		{
+			for(int column = 0; column < n; column++)
+			{
+				if (column != i)
+				{
+					minor.push_back(m[(row * n) + column]);
+				}
+			}
+		}
+		T coeff(((i % 2) == 0) ? false : true, 1, 0);
+		result += coeff * m[i] * Laplace(minor, n - 1);
+	}
+
+	return result;
+}
+
+// Reference determinant: double precision Gaussian elimination
+static double
+Gauss(std::vector<double> m, int n)
+{
+	double result = 1.0;
+	for(int k = 0; k < n; k++)
+	{
+		int pivot = k;
+		for(int row = k + 1; row < n; row++)
+		{
+			if (std::fabs(m[(row * n) + k]) > std::fabs(m[(pivot * n) + k]))
+			{
+				pivot = row;
+			}
+		}
+		if (m[(pivot * n) + k] == 0.0)
+		{
+			return 0.0;
+		}
+		if (pivot != k)
+		{
+			for(int column = 0; column < n; column++)
+			{
+				std::swap(m[(k * n) + column], m[(pivot * n) + column]);
+			}
+			result = -result;
+		}
+		for(int row = k + 1; row < n; row++)
+		{
+			double factor = m[(row * n) + k] / m[(k * n) + k];
+			for(int column = k; column < n; column++)
+			{
+				m[(row * n) + column] -= factor * m[(k * n) + column];
+			}
+		}
+		result *= m[(k * n) + k];
+	}
+
+	return result;
+}
+
+// Reference solution: double precision Gaussian elimination (n x n matrix, n x k right hand sides)
+static std::vector<double>
+GaussSolve(std::vector<double> m, std::vector<double> b, size_t n, size_t k)
+{
+	for(size_t p = 0; p < n; p++)
+	{
+		size_t pivot = p;
+		for(size_t row = p + 1; row < n; row++)
+		{
+			if (std::fabs(m[(row * n) + p]) > std::fabs(m[(pivot * n) + p]))
+			{
+				pivot = row;
+			}
+		}
+		for(size_t column = 0; column < n; column++)
+		{
+			std::swap(m[(p * n) + column], m[(pivot * n) + column]);
+		}
+		for(size_t column = 0; column < k; column++)
+		{
+			std::swap(b[(p * k) + column], b[(pivot * k) + column]);
+		}
+		for(size_t row = p + 1; row < n; row++)
+		{
+			double factor = m[(row * n) + p] / m[(p * n) + p];
+			for(size_t column = p; column < n; column++)
+			{
+				m[(row * n) + column] -= factor * m[(p * n) + column];
+			}
+			for(size_t column = 0; column < k; column++)
+			{
+				b[(row * k) + column] -= factor * b[(p * k) + column];
+			}
+		}
+	}
+	for(size_t row = n; row-- > 0;)
+	{
+		for(size_t column = 0; column < k; column++)
+		{
+			double x = b[(row * k) + column];
+			for(size_t p = row + 1; p < n; p++)
+			{
+				x -= m[(row * n) + p] * b[(p * k) + column];
+			}
+			b[(row * k) + column] = x / m[(row * n) + row];
+		}
+	}
+
+	return b;
+}
+
+// Unrolled determinants (N <= 4) are checked against the Laplace expansion,
+// LU determinants (N > 4) against a double precision elimination
+template <int N>
+void DetFP(char const* name, int count, double tolerance)
+{
+	std::string s("DetFP");
+	s += name;
+	s += ".txt";
+
+	FILE* f = fopen(s.c_str(), "w");
+	if (f)
+	{
+		std::mt19937 generator(N);
+		size_t mismatches = 0;
+		for(int k = 0; k < count; k++)
+		{
+			std::vector<FixedPointMedium> values;
+			std::vector<double> doubles;
+			for(int i = 0; i < (N * N); i++)
+			{
+				values.push_back(Component<FixedPointMedium>(generator, (N <= 4) ? 8 : 2));
+				doubles.push_back(values.back().ToDouble());
+			}
+			if ((k % 8) == 0)
+			{
+				// Singular: 2 equal rows
+				for(int column = 0; column < N; column++)
+				{
+					values[N + column] = values[column];
+					doubles[N + column] = doubles[column];
+				}
+			}
+
+			Mat<FixedPointMedium, N> m(values);
+			FixedPointMedium det = m.Det();
+			if (N <= 4)
+			{
+				mismatches += !Same(det, Laplace(values, N));
+			}
+			else
+			{
+				mismatches += (std::fabs(det.ToDouble() - Gauss(doubles, N)) > tolerance);
+			}
+
+			fprintf(f, "%s;%s\n", m.ToString().c_str(), det.ToString().c_str());
+		}
+		std::cout << name << " determinant mismatches: " << mismatches << std::endl;
+
+		fclose(f);
+	}
+}
+
+// Unrolled inverses (N = 3, 4) are checked against the transposed cofactor matrix
+// scaled by 1 / det, Gauss-Jordan inverses (N > 4) by their product with the matrix
+template <int N>
+void InvFP(char const* name, int count, double tolerance)
+{
+	std::mt19937 generator(N);
+	size_t mismatches = 0;
+	for(int k = 0; k < count; k++)
+	{
+		std::vector<FixedPointMedium> values;
+		for(int i = 0; i < (N * N); i++)
+		{
+			values.push_back(Component<FixedPointMedium>(generator, 4));
+			if ((N > 4) && ((i % (N + 1)) == 0))
+			{
+				// Diagonally dominant: well conditioned
+				values.back() = FixedPointMedium(false, 4 * N, 0);
+			}
+		}
+		if ((k % 8) == 0)
+		{
+			// Singular: 2 equal rows
+			for(int column = 0; column < N; column++)
+			{
+				values[N + column] = values[column];
+			}
+		}
+
+		Mat<FixedPointMedium, N> m(values);
+		FixedPointMedium det = m.Det();
+		Mat<FixedPointMedium, N> inverse;
+		bool thrown = false;
+		try
+		{
+			inverse = Mat<FixedPointMedium, N>::Inv(m);
+		}
+		catch(FPException const&)
+		{
+			thrown = true;
+		}
+
+		if ((N <= 4) || thrown)
+		{
+			mismatches += (thrown != (static_cast<uint32_t>(det) == 0));
+		}
+		if (thrown)
+		{
+			continue;
+		}
+
+		if (N <= 4)
+		{
+			Mat<FixedPointMedium, N> expected(m);
+			expected = Mat<FixedPointMedium, N>::Transpose(expected.CoFactorMatrix());
+			expected *= FixedPointMedium(false, 1, 0) / det;
+			for(int row = 0; row < N; row++)
+			{
+				for(int column = 0; column < N; column++)
+				{
+					mismatches += !Same(inverse.Component(row, column), expected.Component(row, column));
+				}
+			}
+		}
+		else
+		{
+			Mat<FixedPointMedium, N> identity = m * inverse;
+			for(int row = 0; row < N; row++)
+			{
+				for(int column = 0; column < N; column++)
+				{
+					mismatches += (std::fabs(identity.Component(row, column).ToDouble() - ((row == column) ? 1.0 : 0.0)) > tolerance);
+				}
+			}
+		}
+	}
+	std::cout << name << " inverse mismatches: " << mismatches << std::endl;
+}
+
+// Batch inverses and determinants checked against Inv and Det (same bits, singular
+// matrices in the mask instead of exceptions), in place too; the count is not a
+// multiple of the 4 SSE2 lanes
+template <class T, int N>
+void InvManyFP(char const* name, size_t count)
+{
+	std::mt19937 generator(N);
+	std::vector<Mat<T, N>> matrices;
+	for(size_t k = 0; k < count; k++)
+	{
+		std::vector<T> values;
+		for(int i = 0; i < (N * N); i++)
+		{
+			values.push_back(Component<T>(generator, 4));
+		}
+		if ((k % 8) == 0)
+		{
+			// Singular: 2 equal rows
+			for(int column = 0; column < N; column++)
+			{
+				values[N + column] = values[column];
+			}
+		}
+		matrices.push_back(Mat<T, N>(values));
+	}
+
+	std::vector<Mat<T, N>> inverses(count);
+	std::vector<T> dets(count);
+	std::unique_ptr<bool[]> singular(new bool[count]);
+	bool any = InvMany(Span<Mat<T, N> const>(matrices), Span<Mat<T, N>>(inverses), Span<bool>(singular.get(), count));
+	DetMany(Span<Mat<T, N> const>(matrices), Span<T>(dets));
+
+	size_t mismatches = !any;
+	for(size_t k = 0; k < count; k++)
+	{
+		T det = matrices[k].Det();
+		mismatches += (dets[k] != det) || (T::IsNegative(dets[k]) != T::IsNegative(det));
+
+		Mat<T, N> expected;
+		bool thrown = false;
+		try
+		{
+			expected = Mat<T, N>::Inv(matrices[k]);
+		}
+		catch(FPException const&)
+		{
+			// InvMany gives a zero matrix
+			expected = Mat<T, N>();
+			thrown = true;
+		}
+		mismatches += (singular[k] != thrown);
+		for(int row = 0; row < N; row++)
+		{
+			for(int column = 0; column < N; column++)
+			{
+				T x = inverses[k].Component(row, column);
+				T y = expected.Component(row, column);
+				mismatches += (x != y) || (T::IsNegative(x) != T::IsNegative(y));
+			}
+		}
+	}
+
+	// In place
+	std::vector<Mat<T, N>> copy(matrices);
+	InvMany(Span<Mat<T, N> const>(copy), Span<Mat<T, N>>(copy), Span<bool>(singular.get(), count));
+	mismatches += (copy != inverses);
+
+	std::cout << name << " batch inverse/determinant mismatches: " << mismatches << std::endl;
+}
+
+// Rigid transforms: InvAffine compared with the general inverse
+void InvAffineFP(int count, double tolerance)
+{
+	std::mt19937 generator(count);
+	std::uniform_real_distribution<double> angle(-3.14159, 3.14159);
+	std::uniform_real_distribution<double> distance(-100.0, 100.0);
+	size_t mismatches = 0;
+	for(int k = 0; k < count; k++)
+	{
+		// Rotation around z then x, and a translation
+		double a = angle(generator);
+		double b = angle(generator);
+		double r[3][3] = { { std::cos(a), -std::sin(a), 0.0 },
+						   { std::cos(b) * std::sin(a), std::cos(b) * std::cos(a), -std::sin(b) },
+						   { std::sin(b) * std::sin(a), std::sin(b) * std::cos(a), std::cos(b) } };
+		std::vector<FixedPointMedium> values;
+		for(int row = 0; row < 4; row++)
+		{
+			for(int column = 0; column < 4; column++)
+			{
+				double x = (row == 3) ? ((column == 3) ? 1.0 : 0.0) : ((column == 3) ? distance(generator) : r[row][column]);
+				values.push_back(FixedPointMedium::FromDouble(x));
+			}
+		}
+
+		Mat4x4Medium m(values);
+		Mat4x4Medium fast = Mat4x4Medium::InvAffine(m);
+		Mat4x4Medium inverse = Mat4x4Medium::Inv(m);
+		for(int row = 0; row < 4; row++)
+		{
+			for(int column = 0; column < 4; column++)
+			{
+				mismatches += (std::fabs(fast.Component(row, column).ToDouble() - inverse.Component(row, column).ToDouble()) > tolerance);
+			}
+		}
+	}
+	std::cout << "InvAffine/Inv mismatches: " << mismatches << std::endl;
+}
+
+// DynMat product checked against the sums of the FixedPoint products (added in
+// order, the zero results compared without their sign), for every instruction
+// set and thread count
+template <class T>
+void DynMatFP(char const* name, size_t rows, size_t depth, size_t columns)
+{
+	std::mt19937 generator(static_cast<unsigned>(rows + depth + columns));
+	DynMat<T> a(rows, depth);
+	DynMat<T> b(depth, columns);
+	for(size_t i = 0; i < rows; i++)
+	{
+		for(size_t j = 0; j < depth; j++)
+		{
+			a(i, j) = Component<T>(generator, 4);
+		}
+	}
+	for(size_t i = 0; i < depth; i++)
+	{
+		for(size_t j = 0; j < columns; j++)
+		{
+			b(i, j) = Component<T>(generator, 4);
+		}
+	}
+
+	DynMat<T> product = a * b;
+	size_t mismatches = 0;
+	for(size_t i = 0; i < rows; i++)
+	{
+		for(size_t j = 0; j < columns; j++)
+		{
+			T expected(false, 0, 0);
+			for(size_t k = 0; k < depth; k++)
+			{
+				T x = a(i, k);
+				expected += x * b(k, j);
+			}
+			T zero(false, 0, 0);
+			mismatches += (product(i, j) != expected) && !((product(i, j) == zero) && (expected == T(true, 0, 0)));
+		}
+	}
+
+	// Same bits for every kernel and thread count
+	InstructionSet supported = SupportedInstructionSet();
+	size_t threads = GetThreadCount();
+	for(int set = 0; set <= static_cast<int>(supported); set++)
+	{
+		SetInstructionSet(static_cast<InstructionSet>(set));
+		for(size_t count = 1; count <= 4; count++)
+		{
+			SetThreadCount(count);
+			mismatches += (DynMat<T>::Multiply(a, b) != product);
+		}
+	}
+	SetInstructionSet(supported);
+	SetThreadCount(threads);
+
+	// Mat blocks
+	Mat<T, 4> block = a.template Block<4>(rows - 4, depth - 4);
+	DynMat<T> copy(rows, depth);
+	copy.SetBlock(rows - 4, depth - 4, block);
+	mismatches += (DynMat<T>(block) != DynMat<T>(copy.template Block<4>(rows - 4, depth - 4)));
+
+	std::cout << name << " DynMat product mismatches: " << mismatches << std::endl;
+}
+
+// Row and column views: the components themselves, writable, and usable as vectors
+template <class T, int N>
+void ViewFP(char const* name, int count)
+{
+	std::mt19937 generator(N);
+	size_t mismatches = 0;
+	for(int k = 0; k < count; k++)
+	{
+		std::vector<T> values;
+		for(int i = 0; i < (N * N); i++)
+		{
+			values.push_back(Component<T>(generator, 8));
+		}
+		Mat<T, N> m(values);
+		Mat<T, N> const& c = m;
+		Mat<T, N> n = Mat<T, N>::Transpose(m);
+		Mat<T, N> product = m * n;
+
+		for(int i = 0; i < N; i++)
+		{
+			for(int j = 0; j < N; j++)
+			{
+				mismatches += (&m[i][j] != &m.Component(i, j)) + (&c.Row(i).Component(j) != &m.Component(i, j)) + (&c.Column(j)[i] != &m.Component(i, j));
+				// Row by column products without copies
+				mismatches += ((m.Row(i) * n.Column(j)) != product.Component(i, j));
+			}
+
+			// Vec operations on views
+			Vec<T, N> row(m.Row(i));
+			Vec<T, N> sum = m.Row(i) + n.Column(i);
+			Vec<T, N> expected = row + Vec<T, N>(n.Column(i));
+			mismatches += (sum != expected);
+
+			// Read-only Vec members on views
+			char buffer[Vec<T, N>::MaxFormatLength];
+			Vec<T, N> column(n.Column(i));
+			mismatches += (m[i] != row) + !(m[i] == row) + (n.Column(i) != column) + (m[i].Mod() != row.Mod());
+			mismatches += (m[i].ToString() != row.ToString()) + (n.Column(i).ToString() != column.ToString());
+			mismatches += (std::string(buffer, m.Row(i).Format(buffer, buffer + sizeof(buffer)).ptr) != row.ToString());
+			if (row.Mod() != T())
+			{
+				mismatches += (m[i].Normalize() != row.Normalize());
+			}
+		}
+
+		// Writes through the views (the expression reads the same matrix)
+		Mat<T, N> copy(m);
+		copy.Row(1) = copy.Column(0) + copy.Row(1);
+		for(int j = 0; j < N; j++)
+		{
+			T x = m.Component(j, 0);
+			mismatches += (copy.Component(1, j) != (x + m.Component(1, j)));
+		}
+		copy = m;
+		copy.Column(N - 1) = copy.Row(0);
+		copy[0][0] = T(false, 1, 0);
+		for(int i = 0; i < N; i++)
+		{
+			mismatches += (copy.Component(i, N - 1) != m.Component(0, i));
+		}
+		mismatches += (copy.Component(0, 0) != T(false, 1, 0));
+
+		// Checked accessors
+		bool thrown = false;
+		try
+		{
+			c[N][0];
+		}
+		catch(FPException const&)
+		{
+			thrown = true;
+		}
+		mismatches += !thrown;
+		thrown = false;
+		try
+		{
+			m.Column(0)[N] = T(false, 1, 0);
+		}
+		catch(FPException const&)
+		{
+			thrown = true;
+		}
+		mismatches += !thrown;
+	}
+	std::cout << name << " view mismatches: " << mismatches << std::endl;
+}
+
+// Mat products (one by one and MultiplyMany) checked against the sums of the
+// FixedPoint products of rows by columns
+template <class T, int N>
+void MultiplyFP(char const* name, size_t count)
+{
+	std::mt19937 generator(N);
+	std::vector<Mat<T, N>> a;
+	std::vector<Mat<T, N>> b;
+	for(size_t k = 0; k < count; k++)
+	{
+		std::vector<T> values[2];
+		for(int i = 0; i < (N * N); i++)
+		{
+			values[0].push_back(Component<T>(generator, 8));
+			values[1].push_back(Component<T>(generator, 8));
+		}
+		a.push_back(Mat<T, N>(values[0]));
+		b.push_back(Mat<T, N>(values[1]));
+	}
+
+	std::vector<Mat<T, N>> products(count);
+	MultiplyMany(Span<Mat<T, N> const>(a), Span<Mat<T, N> const>(b), Span<Mat<T, N>>(products));
+
+	size_t mismatches = 0;
+	for(size_t k = 0; k < count; k++)
+	{
+		Mat<T, N> product = a[k] * b[k];
+		for(int row = 0; row < N; row++)
+		{
+			for(int column = 0; column < N; column++)
+			{
+				T expected(false, 0, 0);
+				for(int index = 0; index < N; index++)
+				{
+					T x = a[k].Component(row, index);
+					expected += x * b[k].Component(index, column);
+				}
+				mismatches += (product.Component(row, column) != expected);
+			}
+		}
+		mismatches += (products[k] != product);
+	}
+
+	// In place: the destination is the 2nd operand
+	MultiplyMany(Span<Mat<T, N> const>(a), Span<Mat<T, N> const>(b), Span<Mat<T, N>>(b));
+	mismatches += (b != products);
+
+	std::cout << name << " product mismatches: " << mismatches << std::endl;
+}
+
+// Affine3 products and transforms checked against the Mat<T, 4> operations on the
+// same transforms (same results), the batch functions against the single ones
+template <class T>
+void AffineFP(char const* name, size_t count)
+{
+	std::mt19937 generator(static_cast<unsigned>(count));
+	std::vector<Affine3<T>> a;
+	std::vector<Affine3<T>> b;
+	std::vector<Vec<T, 3>> vectors;
+	for(size_t k = 0; k < count; k++)
+	{
+		std::vector<T> values[2];
+		for(int i = 0; i < 16; i++)
+		{
+			bool bottom = (i >= 12);
+			values[0].push_back(bottom ? T(false, (i == 15) ? 1 : 0, 0) : Component<T>(generator, 8));
+			values[1].push_back(bottom ? T(false, (i == 15) ? 1 : 0, 0) : Component<T>(generator, 8));
+		}
+		a.push_back(Affine3<T>(Mat<T, 4>(values[0])));
+		b.push_back(Affine3<T>(Mat<T, 4>(values[1])));
+		vectors.push_back(Vec<T, 3>{ Component<T>(generator, 16), Component<T>(generator, 16), Component<T>(generator, 16) });
+	}
+
+	std::vector<Affine3<T>> products(count);
+	std::vector<Vec<T, 3>> points(count);
+	std::vector<Vec<T, 3>> directions(count);
+	MultiplyMany(Span<Affine3<T> const>(a), Span<Affine3<T> const>(b), Span<Affine3<T>>(products));
+	TransformPoints(a[0], Span<Vec<T, 3> const>(vectors), Span<Vec<T, 3>>(points));
+	TransformDirections(a[0], Span<Vec<T, 3> const>(vectors), Span<Vec<T, 3>>(directions));
+
+	size_t mismatches = 0;
+	Mat<T, 4> m = a[0].ToMat();
+	for(size_t k = 0; k < count; k++)
+	{
+		Affine3<T> product = a[k] * b[k];
+		mismatches += (product != Affine3<T>(a[k].ToMat() * b[k].ToMat()));
+		mismatches += (products[k] != product);
+
+		Vec<T, 3> v = vectors[k];
+		Vec<T, 4> point = m * Vec<T, 4>{ v[0], v[1], v[2], T(false, 1, 0) };
+		Vec<T, 4> direction = m * Vec<T, 4>{ v[0], v[1], v[2], T(false, 0, 0) };
+		Vec<T, 3> transformed = a[0].TransformPoint(v);
+		Vec<T, 3> rotated = a[0].TransformDirection(v);
+		for(int i = 0; i < 3; i++)
+		{
+			mismatches += (transformed[i] != point[i]) || (rotated[i] != direction[i]);
+		}
+		mismatches += (points[k] != transformed) || (directions[k] != rotated);
+	}
+
+	// In place: the destination is the 2nd operand
+	MultiplyMany(Span<Affine3<T> const>(a), Span<Affine3<T> const>(b), Span<Affine3<T>>(b));
+	mismatches += (b != products);
+
+	std::cout << name << " affine mismatches: " << mismatches << std::endl;
+}
+
+// Rotations, uniform scales and translations: InvRigid compared with Mat::InvAffine
+// (same results), InvUniformScale and Inv with the double precision inverse (errors
+// relative to the largest terms of the sums, up to 100 / 0.5 for the translations)
+void AffineInvFP(int count, double tolerance)
+{
+	std::mt19937 generator(count);
+	std::uniform_real_distribution<double> angle(-3.14159, 3.14159);
+	std::uniform_real_distribution<double> distance(-100.0, 100.0);
+	std::uniform_real_distribution<double> scaling(0.5, 4.0);
+	size_t mismatches = 0;
+	for(int k = 0; k < count; k++)
+	{
+		// Rotation around z then x, and a translation
+		double a = angle(generator);
+		double b = angle(generator);
+		double r[3][3] = { { std::cos(a), -std::sin(a), 0.0 },
+						   { std::cos(b) * std::sin(a), std::cos(b) * std::cos(a), -std::sin(b) },
+						   { std::sin(b) * std::sin(a), std::sin(b) * std::cos(a), std::cos(b) } };
+		double s = scaling(generator);
+		std::vector<FixedPointMedium> rigid;
+		std::vector<FixedPointMedium> scaled;
+		for(int row = 0; row < 4; row++)
+		{
+			for(int column = 0; column < 4; column++)
+			{
+				double x = (row == 3) ? ((column == 3) ? 1.0 : 0.0) : ((column == 3) ? distance(generator) : r[row][column]);
+				rigid.push_back(FixedPointMedium::FromDouble(x));
+				scaled.push_back(FixedPointMedium::FromDouble(((row < 3) && (column < 3)) ? (x * s) : x));
+			}
+		}
+
+		Mat4x4Medium m(rigid);
+		mismatches += (Affine3Medium::InvRigid(Affine3Medium(m)) != Affine3Medium(Mat4x4Medium::InvAffine(m)));
+
+		// Inverse of the rounded components: adjugate of L / det(L), and -L^-1 t
+		double l[3][3];
+		double t[3];
+		for(int row = 0; row < 3; row++)
+		{
+			for(int column = 0; column < 3; column++)
+			{
+				l[row][column] = scaled[(row * 4) + column].ToDouble();
+			}
+			t[row] = scaled[(row * 4) + 3].ToDouble();
+		}
+		double inverse[3][4];
+		double det = 0.0;
+		for(int column = 0; column < 3; column++)
+		{
+			for(int row = 0; row < 3; row++)
+			{
+				int r1 = (column + 1) % 3;
+				int r2 = (column + 2) % 3;
+				int c1 = (row + 1) % 3;
+				int c2 = (row + 2) % 3;
+				inverse[row][column] = (l[r1][c1] * l[r2][c2]) - (l[r1][c2] * l[r2][c1]);
+			}
+			det += l[0][column] * inverse[column][0];
+		}
+		for(int row = 0; row < 3; row++)
+		{
+			inverse[row][3] = 0.0;
+			for(int column = 0; column < 3; column++)
+			{
+				inverse[row][column] /= det;
+				inverse[row][3] -= inverse[row][column] * t[column];
+			}
+		}
+
+		Affine3Medium n = Affine3Medium(Mat4x4Medium(scaled));
+		Affine3Medium fast = Affine3Medium::InvUniformScale(n);
+		Affine3Medium general = Affine3Medium::Inv(n);
+		for(int row = 0; row < 3; row++)
+		{
+			for(int column = 0; column < 4; column++)
+			{
+				double expected = inverse[row][column];
+				double allowed = tolerance * (((column == 3) ? (100.0 / 0.5) : 1.0) + std::fabs(expected));
+				mismatches += (std::fabs(fast.Component(row, column).ToDouble() - expected) > allowed);
+				mismatches += (std::fabs(general.Component(row, column).ToDouble() - expected) > allowed);
+			}
+		}
+	}
+	std::cout << "Affine3 inverse mismatches: " << mismatches << std::endl;
+}
+
+// Linear systems of diagonally dominant (LU, QR) and symmetric positive definite
+// (Cholesky) matrices: the solutions checked against the double precision ones, the
+// batch solves against the single ones
+template <int N>
+void SolveFP(char const* name, int count, double tolerance)
+{
+	std::mt19937 generator(N);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	size_t mismatches = 0;
+	std::vector<Mat<FixedPointMedium, N>> matrices;
+	std::vector<Vec<FixedPointMedium, N>> vectors;
+	for(int k = 0; k < count; k++)
+	{
+		double a[N][N];
+		for(int row = 0; row < N; row++)
+		{
+			for(int column = 0; column < N; column++)
+			{
+				a[row][column] = unit(generator) + ((row == column) ? (N + 1) : 0.0);
+			}
+		}
+		std::vector<FixedPointMedium> general;
+		std::vector<FixedPointMedium> symmetric;
+		std::vector<double> b;
+		for(int row = 0; row < N; row++)
+		{
+			for(int column = 0; column < N; column++)
+			{
+				double sum = 0.0;
+				for(int index = 0; index < N; index++)
+				{
+					sum += a[row][index] * a[column][index];
+				}
+				general.push_back(FixedPointMedium::FromDouble(a[row][column]));
+				symmetric.push_back(FixedPointMedium::FromDouble(sum / N));
+			}
+			b.push_back(FixedPointMedium::FromDouble(unit(generator) * 10.0).ToDouble());
+		}
+
+		Mat<FixedPointMedium, N> m(general);
+		Mat<FixedPointMedium, N> s(symmetric);
+		Vec<FixedPointMedium, N> v{};
+		std::vector<double> quantized[2];
+		for(int row = 0; row < N; row++)
+		{
+			for(int column = 0; column < N; column++)
+			{
+				quantized[0].push_back(general[(row * N) + column].ToDouble());
+				quantized[1].push_back(symmetric[(row * N) + column].ToDouble());
+			}
+		}
+		std::vector<FixedPointMedium> components;
+		for(double x : b)
+		{
+			components.push_back(FixedPointMedium::FromDouble(x));
+		}
+		v = Vec<FixedPointMedium, N>(components);
+		std::vector<double> expected = GaussSolve(quantized[0], b, N, 1);
+		std::vector<double> expectedSymmetric = GaussSolve(quantized[1], b, N, 1);
+
+		Vec<FixedPointMedium, N> x = m.Solve(v);
+		Vec<FixedPointMedium, N> y = QR<FixedPointMedium, N>(m).Solve(v);
+		Vec<FixedPointMedium, N> z = Cholesky<FixedPointMedium, N>(s).Solve(v);
+		for(int i = 0; i < N; i++)
+		{
+			mismatches += (std::fabs(x[i].ToDouble() - expected[i]) > tolerance);
+			mismatches += (std::fabs(y[i].ToDouble() - expected[i]) > tolerance);
+			mismatches += (std::fabs(z[i].ToDouble() - expectedSymmetric[i]) > tolerance);
+		}
+		if (N <= 4)
+		{
+			// Larger determinants are out of the Q16.16 range
+			double det = Gauss(quantized[0], N);
+			mismatches += (std::fabs(LU<FixedPointMedium, N>(m).Det().ToDouble() - det) > (tolerance * std::fabs(det)));
+		}
+
+		matrices.push_back(m);
+		vectors.push_back(v);
+	}
+
+	// One factorization, many right hand sides (in place)
+	LU<FixedPointMedium, N> lu(matrices[0]);
+	Cholesky<FixedPointMedium, N> cholesky(Mat<FixedPointMedium, N>(matrices[0] + Mat<FixedPointMedium, N>::Transpose(matrices[0])));
+	QR<FixedPointMedium, N> qr(matrices[0]);
+	std::vector<Vec<FixedPointMedium, N>> solutions[3] = { vectors, vectors, vectors };
+	lu.Solve(Span<Vec<FixedPointMedium, N> const>(solutions[0]), Span<Vec<FixedPointMedium, N>>(solutions[0]));
+	cholesky.Solve(Span<Vec<FixedPointMedium, N> const>(solutions[1]), Span<Vec<FixedPointMedium, N>>(solutions[1]));
+	qr.Solve(Span<Vec<FixedPointMedium, N> const>(solutions[2]), Span<Vec<FixedPointMedium, N>>(solutions[2]));
+
+	// One system per matrix
+	std::vector<Vec<FixedPointMedium, N>> many(vectors.size());
+	SolveMany(Span<Mat<FixedPointMedium, N> const>(matrices), Span<Vec<FixedPointMedium, N> const>(vectors), Span<Vec<FixedPointMedium, N>>(many));
+	for(size_t k = 0; k < vectors.size(); k++)
+	{
+		mismatches += (solutions[0][k] != lu.Solve(vectors[k]));
+		mismatches += (solutions[1][k] != cholesky.Solve(vectors[k]));
+		mismatches += (solutions[2][k] != qr.Solve(vectors[k]));
+		mismatches += (many[k] != matrices[k].Solve(vectors[k]));
+	}
+
+	// Singular systems: (0, ..., 0), reported once
+	matrices[1] = Mat<FixedPointMedium, N>();
+	bool thrown = false;
+	try
+	{
+		SolveMany(Span<Mat<FixedPointMedium, N> const>(matrices), Span<Vec<FixedPointMedium, N> const>(vectors), Span<Vec<FixedPointMedium, N>>(many));
+	}
+	catch(FPException const&)
+	{
+		thrown = true;
+	}
+	mismatches += !thrown || (many[1] != Vec<FixedPointMedium, N>()) || (many[0] != matrices[0].Solve(vectors[0]));
+
+	std::cout << name << " solve mismatches: " << mismatches << std::endl;
+}
+
+// DynMat systems (blocked LU and Cholesky, least squares QR) checked against the
+// double precision solutions (errors relative to their magnitude), with the same
+// bits for every thread count
+template <class T>
+void DynSolveFP(char const* name, size_t n, size_t k, double tolerance)
+{
+	std::mt19937 generator(static_cast<unsigned>(n));
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	size_t extra = n / 8;
+	double shift = 2.0 * std::sqrt(static_cast<double>(n));
+	std::vector<double> a((n + extra) * n);
+	for(size_t row = 0; row < (n + extra); row++)
+	{
+		for(size_t column = 0; column < n; column++)
+		{
+			a[(row * n) + column] = unit(generator) + ((row == column) ? shift : 0.0);
+		}
+	}
+
+	// Rounded components: A (n x n), the rows of A and extra rows (least squares), A A^T / n and B
+	DynMat<T> general(n, n);
+	DynMat<T> tall(n + extra, n);
+	DynMat<T> symmetric(n, n);
+	DynMat<T> b(n, k);
+	DynMat<T> c(n + extra, k);
+	std::vector<double> quantized[3];
+	std::vector<double> rhs[2];
+	for(size_t row = 0; row < (n + extra); row++)
+	{
+		for(size_t column = 0; column < n; column++)
+		{
+			tall(row, column) = T::FromDouble(a[(row * n) + column]);
+			if (row < n)
+			{
+				double sum = 0.0;
+				for(size_t index = 0; index < n; index++)
+				{
+					sum += a[(row * n) + index] * a[(column * n) + index];
+				}
+				general(row, column) = tall(row, column);
+				symmetric(row, column) = T::FromDouble(sum / n);
+				quantized[0].push_back(general(row, column).ToDouble());
+				quantized[1].push_back(symmetric(row, column).ToDouble());
+			}
+		}
+		for(size_t column = 0; column < k; column++)
+		{
+			c(row, column) = T::FromDouble(unit(generator) * 10.0);
+			rhs[1].push_back(c(row, column).ToDouble());
+			if (row < n)
+			{
+				b(row, column) = c(row, column);
+				rhs[0].push_back(c(row, column).ToDouble());
+			}
+		}
+	}
+
+	// Least squares: normal equations A^T A x = A^T c in double precision
+	std::vector<double> normal(n * n, 0.0);
+	std::vector<double> projected(n * k, 0.0);
+	for(size_t row = 0; row < (n + extra); row++)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			double x = tall(row, i).ToDouble();
+			for(size_t j = 0; j < n; j++)
+			{
+				normal[(i * n) + j] += x * tall(row, j).ToDouble();
+			}
+			for(size_t j = 0; j < k; j++)
+			{
+				projected[(i * k) + j] += x * rhs[1][(row * k) + j];
+			}
+		}
+	}
+
+	std::vector<double> expected[3] = { GaussSolve(quantized[0], rhs[0], n, k), GaussSolve(quantized[1], rhs[0], n, k), GaussSolve(normal, projected, n, k) };
+	DynMat<T> solutions[3] = { general.Solve(b), DynCholesky<T>(symmetric).Solve(b), DynQR<T>(tall).Solve(c) };
+	size_t mismatches = 0;
+	for(int i = 0; i < 3; i++)
+	{
+		for(size_t row = 0; row < n; row++)
+		{
+			for(size_t column = 0; column < k; column++)
+			{
+				double x = expected[i][(row * k) + column];
+				mismatches += (std::fabs(solutions[i](row, column).ToDouble() - x) > (tolerance * (1.0 + std::fabs(x))));
+			}
+		}
+	}
+
+	// Same bits for every thread count
+	size_t threads = GetThreadCount();
+	for(size_t count = 1; count <= 4; count++)
+	{
+		SetThreadCount(count);
+		mismatches += (DynLU<T>(general).Solve(b) != solutions[0]);
+		mismatches += (DynCholesky<T>(symmetric).Solve(b) != solutions[1]);
+		mismatches += (DynQR<T>(tall).Solve(c) != solutions[2]);
+	}
+	SetThreadCount(threads);
+
+	std::cout << name << " DynMat solve mismatches: " << mismatches << std::endl;
+}
+
+// Largest difference between the components of a Q16.16 matrix and a double one
+static double
+Distance(Mat3x3Medium const& m, double const (&expected)[3][3])
+{
+	double largest = 0.0;
+	for(int row = 0; row < 3; row++)
+	{
+		for(int column = 0; column < 3; column++)
+		{
+			largest = std::max(largest, std::fabs(m.Component(row, column).ToDouble() - expected[row][column]));
+		}
+	}
+	return largest;
+}
+
+// Product a diag(d) transposed(b) of Q16.16 matrices, in double precision
+static void
+Reconstruct(Mat3x3Medium const& a, Vec3Medium const& d, Mat3x3Medium const& b, double (&product)[3][3])
+{
+	FixedPointMedium const* diagonal = reinterpret_cast<FixedPointMedium const*>(&d);
+	for(int row = 0; row < 3; row++)
+	{
+		for(int column = 0; column < 3; column++)
+		{
+			product[row][column] = 0.0;
+			for(int index = 0; index < 3; index++)
+			{
+				product[row][column] += a.Component(row, index).ToDouble() * diagonal[index].ToDouble() * b.Component(column, index).ToDouble();
+			}
+		}
+	}
+}
+
+// Rotations: transposed(r) r = I and det(r) = 1
+static bool
+IsRotation(Mat3x3Medium const& r, double tolerance)
+{
+	Vec3Medium ones{ FixedPointMedium(false, 1, 0), FixedPointMedium(false, 1, 0), FixedPointMedium(false, 1, 0) };
+	double product[3][3];
+	Reconstruct(Mat3x3Medium::Transpose(r), ones, Mat3x3Medium::Transpose(r), product);
+	return (Distance(Mat3x3Medium(true), product) <= tolerance) && (std::fabs(r.Det().ToDouble() - 1.0) <= tolerance);
+}
+
+// Symmetric eigen-decompositions and SVDs of random matrices (magnitudes from 0.1 to
+// 100) checked by reconstruction, polar decompositions of rotated stretches and best
+// fit rotations of rotated point sets checked against the rotations, and the batch
+// decompositions against the single ones
+void DecompositionFP(int count, double tolerance)
+{
+	std::mt19937 generator(count);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	std::uniform_real_distribution<double> exponent(-1.0, 2.0);
+	std::uniform_real_distribution<double> angle(-3.14159, 3.14159);
+	std::uniform_real_distribution<double> stretch(0.5, 3.0);
+	size_t mismatches = 0;
+	std::vector<Mat3x3Medium> symmetric;
+	std::vector<Mat3x3Medium> general;
+	for(int k = 0; k < count; k++)
+	{
+		double scale = std::pow(10.0, exponent(generator));
+		double a[3][3];
+		for(int row = 0; row < 3; row++)
+		{
+			for(int column = 0; column < 3; column++)
+			{
+				a[row][column] = unit(generator) * scale;
+			}
+		}
+		std::vector<FixedPointMedium> s;
+		std::vector<FixedPointMedium> g;
+		for(int row = 0; row < 3; row++)
+		{
+			for(int column = 0; column < 3; column++)
+			{
+				s.push_back(FixedPointMedium::FromDouble((a[row][column] + a[column][row]) / 2.0));
+				g.push_back(FixedPointMedium::FromDouble(a[row][column]));
+			}
+		}
+		symmetric.push_back(Mat3x3Medium(s));
+		general.push_back(Mat3x3Medium(g));
+
+		// S = V diag(values) transposed(V), values in descending order
+		double product[3][3];
+		Eigen3<FixedPointMedium> eigen = EigenSymmetric(symmetric.back());
+		Reconstruct(eigen.vectors, eigen.values, eigen.vectors, product);
+		mismatches += !IsRotation(eigen.vectors, tolerance) || (Distance(symmetric.back(), product) > (tolerance * scale));
+		mismatches += (eigen.values[0] < eigen.values[1]) || (eigen.values[1] < eigen.values[2]);
+
+		// A = U diag(singular) transposed(V), non-negative singular values but the last
+		SVD3<FixedPointMedium> svd = SVD(general.back());
+		Reconstruct(svd.u, svd.singular, svd.v, product);
+		mismatches += !IsRotation(svd.u, tolerance) || !IsRotation(svd.v, tolerance) || (Distance(general.back(), product) > (tolerance * scale));
+		mismatches += FixedPointMedium::IsNegative(svd.singular[0]) || FixedPointMedium::IsNegative(svd.singular[1]);
+		mismatches += (svd.singular[0].ToDouble() < (svd.singular[1].ToDouble() - (tolerance * scale))) || (svd.singular[1].ToDouble() < (std::fabs(svd.singular[2].ToDouble()) - (tolerance * scale)));
+
+		// Rotation around z then x
+		double b = angle(generator);
+		double c = angle(generator);
+		double r[3][3] = { { std::cos(b), -std::sin(b), 0.0 },
+						   { std::cos(c) * std::sin(b), std::cos(c) * std::cos(b), -std::sin(c) },
+						   { std::sin(c) * std::sin(b), std::sin(c) * std::cos(b), std::cos(c) } };
+
+		// Polar decomposition of R diag(stretch)
+		double d[3] = { stretch(generator), stretch(generator), stretch(generator) };
+		std::vector<FixedPointMedium> stretched;
+		for(int row = 0; row < 3; row++)
+		{
+			for(int column = 0; column < 3; column++)
+			{
+				stretched.push_back(FixedPointMedium::FromDouble(r[row][column] * d[column]));
+			}
+		}
+		mismatches += (Distance(NearestRotation(Mat3x3Medium(stretched)), r) > tolerance);
+
+		// Best fit rotation of 20 centered points (magnitudes below 10) onto their rotations
+		std::vector<std::vector<double>> p(20, std::vector<double>(3));
+		double center[3] = {};
+		for(auto& point : p)
+		{
+			for(int i = 0; i < 3; i++)
+			{
+				point[i] = unit(generator) * 10.0;
+				center[i] += point[i] / 20.0;
+			}
+		}
+		Mat3x3Medium covariance;
+		for(auto& point : p)
+		{
+			double q[3];
+			for(int row = 0; row < 3; row++)
+			{
+				point[row] -= center[row];
+			}
+			for(int row = 0; row < 3; row++)
+			{
+				q[row] = (r[row][0] * point[0]) + (r[row][1] * point[1]) + (r[row][2] * point[2]);
+			}
+			Mat3x3Medium outer(false);
+			for(int row = 0; row < 3; row++)
+			{
+				for(int column = 0; column < 3; column++)
+				{
+					outer[row][column] = FixedPointMedium::FromDouble(q[row]) * FixedPointMedium::FromDouble(point[column]);
+				}
+			}
+			covariance += outer;
+		}
+		mismatches += (Distance(NearestRotation(covariance), r) > tolerance);
+	}
+
+	// Batches
+	std::vector<Eigen3<FixedPointMedium>> eigen(symmetric.size());
+	std::vector<SVD3<FixedPointMedium>> svd(general.size());
+	std::vector<Mat3x3Medium> rotations(general.size());
+	EigenSymmetricMany(Span<Mat3x3Medium const>(symmetric), Span<Eigen3<FixedPointMedium>>(eigen));
+	SVDMany(Span<Mat3x3Medium const>(general), Span<SVD3<FixedPointMedium>>(svd));
+	NearestRotationMany(Span<Mat3x3Medium const>(general), Span<Mat3x3Medium>(rotations));
+	for(size_t k = 0; k < general.size(); k++)
+	{
+		Eigen3<FixedPointMedium> e = EigenSymmetric(symmetric[k]);
+		SVD3<FixedPointMedium> s = SVD(general[k]);
+		mismatches += (eigen[k].values != e.values) || (eigen[k].vectors != e.vectors);
+		mismatches += (svd[k].u != s.u) || (svd[k].singular != s.singular) || (svd[k].v != s.v);
+		mismatches += (rotations[k] != NearestRotation(general[k]));
+	}
+
+	std::cout << "Decomposition mismatches: " << mismatches << std::endl;
+}
+
+int main()
+{
+	std::cout << "Test Mat determinants" << std::endl;
+	DetFP<2>("Medium2", 100000, 0.0);
+	DetFP<3>("Medium3", 100000, 0.0);
+	DetFP<4>("Medium4", 100000, 0.0);
+	DetFP<5>("Medium5", 10000, 0.5);
+	DetFP<6>("Medium6", 10000, 2.0);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Mat inverses" << std::endl;
+	InvFP<3>("Medium3", 100000, 0.0);
+	InvFP<4>("Medium4", 100000, 0.0);
+	InvFP<5>("Medium5", 10000, 0.01);
+	InvFP<6>("Medium6", 10000, 0.01);
+	InvAffineFP(10000, 0.01);
+	InvManyFP<FixedPointMedium, 2>("Medium2", 10001);
+	InvManyFP<FixedPointMedium, 3>("Medium3", 100003);
+	InvManyFP<FixedPointMedium, 4>("Medium4", 100003);
+	InvManyFP<FixedPointLarge, 4>("Large4", 10001);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Mat row and column views" << std::endl;
+	ViewFP<FixedPointSmall, 2>("Small 2", 10000);
+	ViewFP<FixedPointMedium, 3>("Medium 3", 10000);
+	ViewFP<FixedPointMedium, 4>("Medium 4", 10000);
+	ViewFP<FixedPointLarge, 4>("Large 4", 10000);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Mat products" << std::endl;
+	MultiplyFP<FixedPointSmall, 2>("Small 2", 10000);
+	MultiplyFP<FixedPointMedium, 3>("Medium 3", 100000);
+	MultiplyFP<FixedPointMedium, 4>("Medium 4", 100000);
+	MultiplyFP<FixedPointLarge, 4>("Large 4", 10000);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test DynMat products" << std::endl;
+	DynMatFP<FixedPointSmall>("Small", 37, 19, 41);
+	DynMatFP<FixedPointMedium>("Medium", 301, 517, 263);
+	DynMatFP<FixedPointLarge>("Large", 67, 131, 45);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Affine3 transforms" << std::endl;
+	AffineFP<FixedPointSmall>("Small", 1000);
+	AffineFP<FixedPointMedium>("Medium", 100003);
+	AffineFP<FixedPointLarge>("Large", 10000);
+	AffineInvFP(10000, 0.001);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test linear systems" << std::endl;
+	SolveFP<2>("Medium2", 10000, 0.001);
+	SolveFP<3>("Medium3", 10000, 0.001);
+	SolveFP<4>("Medium4", 10000, 0.001);
+	SolveFP<6>("Medium6", 10000, 0.001);
+	DynSolveFP<FixedPointMedium>("Medium", 300, 16, 0.005);
+	DynSolveFP<FixedPointLarge>("Large", 150, 4, 0.000001);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test eigen-decompositions and SVD" << std::endl;
+	DecompositionFP(10000, 0.001);
+	std::cout << "Done" << std::endl;
+}
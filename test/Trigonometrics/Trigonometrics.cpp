@@ -2,6 +2,7 @@
 //
 
 #include <iostream>
+#include <random>
 #include "..\..\src\SFPMLib.h"
 
 using namespace sfpmlib;
@@ -123,6 +124,169 @@ void TanFP(T startAngle, T endAngle, T increment)
 	}
 }
 
+template <class T>
+void SinCosFP(T startAngle, T endAngle, T increment)
+{
+	std::string s("SinCosFP");
+	if (sizeof(typename T::IntegerPart) == 1)
+	{
+		s += "Short";
+	}
+	else if (sizeof(typename T::IntegerPart) == 2)
+	{
+		s += "Medium";
+	}
+	else
+	{
+		s += "Large";
+	}
+	s += ".txt";
+
+	FILE* f = fopen(s.c_str(), "w");
+	if (f)
+	{
+		std::vector<T> angles;
+		for(T arg = startAngle; arg < endAngle; arg += increment)
+		{
+			angles.push_back(arg);
+		}
+
+		std::vector<T> sines(angles.size());
+		std::vector<T> cosines(angles.size());
+		T::SinCos(angles, sines, cosines);
+
+		// The batch results are rounded to the nearest fixed point number
+		const double epsilon = T(false, 0, 1).ToDouble() / 2.0;
+		size_t mismatches = 0;
+		for(size_t i = 0; i < angles.size(); i++)
+		{
+			double angle = angles[i].ToDouble();
+			if ((fabs(sines[i].ToDouble() - sin(angle)) > epsilon) || (fabs(cosines[i].ToDouble() - cos(angle)) > epsilon))
+			{
+				++mismatches;
+			}
+			fprintf(f, "%s;%s;%s\n", angles[i].ToString().c_str(), sines[i].ToString().c_str(), cosines[i].ToString().c_str());
+		}
+		std::cout << "Batch/double mismatches: " << mismatches << std::endl;
+
+		fclose(f);
+	}
+}
+
+// Batch Sin/Cos of Q32.32 angles over the whole range (up to +/-2^32): the reference
+// splits the angle in its integer part n (exact in a double, reduced by the library
+// sin/cos) and its fraction f, sin(n + f) = sin(n) cos(f) + cos(n) sin(f).
+// Returns the number of results that differ between Scalar and the best instruction set
+size_t SinCosLargeFP(size_t count)
+{
+	std::mt19937_64 generator(count);
+	std::vector<FixedPointLarge> angles;
+	double const magnitudes[] = { 1.0e7, 1.0e8, 1.0e9, 4.0e9, 4294967295.999 };
+	for(double magnitude : magnitudes)
+	{
+		angles.push_back(FixedPointLarge::FromDouble(magnitude));
+		angles.push_back(FixedPointLarge::FromDouble(-magnitude));
+	}
+	angles.push_back(FixedPointLarge(false, std::numeric_limits<uint64_t>::max()));
+	angles.push_back(FixedPointLarge(true, std::numeric_limits<uint64_t>::max()));
+	for(size_t i = 0; i < count; i++)
+	{
+		// Random raw values, with magnitudes spread over every power of two
+		uint64_t raw = generator() >> (generator() % 64);
+		angles.push_back(FixedPointLarge((generator() % 2) != 0, raw));
+	}
+
+	// Best instruction set and Scalar
+	std::vector<FixedPointLarge> sines[2] = { std::vector<FixedPointLarge>(angles.size()), std::vector<FixedPointLarge>(angles.size()) };
+	std::vector<FixedPointLarge> cosines[2] = { std::vector<FixedPointLarge>(angles.size()), std::vector<FixedPointLarge>(angles.size()) };
+	FixedPointLarge::SinCos(angles, sines[0], cosines[0]);
+	SetInstructionSet(InstructionSet::Scalar);
+	FixedPointLarge::SinCos(angles, sines[1], cosines[1]);
+	SetInstructionSet(SupportedInstructionSet());
+
+	// Half a unit, plus the error of the reference
+	const double epsilon = (FixedPointLarge(false, 0, 1).ToDouble() / 2.0) + 1.0e-14;
+	size_t mismatches = 0;
+	size_t kernelMismatches = 0;
+	for(size_t i = 0; i < angles.size(); i++)
+	{
+		kernelMismatches += (sines[0][i] != sines[1][i]) || (cosines[0][i] != cosines[1][i]);
+
+		FixedPointLarge::Number number = angles[i];
+		double sign = number.sign ? -1.0 : 1.0;
+		double n = static_cast<double>(number.value.fixedPoint >> 32);
+		double f = static_cast<double>(number.value.fixedPoint & 0xFFFFFFFFu) / 4294967296.0;
+		double sine = sign * ((sin(n) * cos(f)) + (cos(n) * sin(f)));
+		double cosine = (cos(n) * cos(f)) - (sin(n) * sin(f));
+		for(int kernel = 0; kernel < 2; kernel++)
+		{
+			if ((fabs(sines[kernel][i].ToDouble() - sine) > epsilon) || (fabs(cosines[kernel][i].ToDouble() - cosine) > epsilon))
+			{
+				++mismatches;
+			}
+		}
+	}
+	std::cout << "Batch/double mismatches (whole range): " << mismatches << std::endl;
+	std::cout << "Instruction set/scalar mismatches (whole range): " << kernelMismatches << std::endl;
+	return kernelMismatches;
+}
+
+// Batch Sin/Cos on every supported instruction set against the Scalar one, which
+// must give exactly the same results, and against the scalar Sin/Cos on their domain
+// [0, 2 Pi]. Returns the number of results that differ between instruction sets
+template <class T>
+size_t SinCosKernelsFP(char const* name, double units)
+{
+	std::vector<T> angles;
+	for(double angle = -100.0; angle < 100.0; angle += 0.0007)
+	{
+		angles.push_back(T::FromDouble(angle));
+	}
+
+	InstructionSet supported = SupportedInstructionSet();
+	SetInstructionSet(InstructionSet::Scalar);
+	std::vector<T> sines(angles.size());
+	std::vector<T> cosines(angles.size());
+	T::SinCos(angles, sines, cosines);
+
+	size_t mismatches = 0;
+	InstructionSet sets[] = { InstructionSet::Sse2, InstructionSet::Avx2, InstructionSet::Avx512 };
+	for(InstructionSet set : sets)
+	{
+		if (set > supported)
+		{
+			break;
+		}
+
+		SetInstructionSet(set);
+		std::vector<T> otherSines(angles.size());
+		std::vector<T> otherCosines(angles.size());
+		T::SinCos(angles, otherSines, otherCosines);
+		for(size_t i = 0; i < angles.size(); i++)
+		{
+			mismatches += (otherSines[i] != sines[i]) || (otherCosines[i] != cosines[i]);
+		}
+	}
+	SetInstructionSet(supported);
+
+	const double tolerance = units * T(false, 0, 1).ToDouble();
+	const double pi2 = 6.283185307;
+	size_t scalarMismatches = 0;
+	for(size_t i = 0; i < angles.size(); i++)
+	{
+		double angle = angles[i].ToDouble();
+		if ((angle >= 0.0) && (angle <= pi2))
+		{
+			T sine = T::Sin(angles[i]);
+			T cosine = T::Cos(angles[i]);
+			scalarMismatches += (fabs(sine.ToDouble() - sines[i].ToDouble()) > tolerance) || (fabs(cosine.ToDouble() - cosines[i].ToDouble()) > tolerance);
+		}
+	}
+	std::cout << name << " instruction set/scalar mismatches: " << mismatches << std::endl;
+	std::cout << name << " batch/scalar Sin/Cos mismatches: " << scalarMismatches << std::endl;
+	return mismatches;
+}
+
 int main()
 {
 	// 8.8 fixed point numbers
@@ -142,6 +306,10 @@ int main()
 	TanFP(startAngleSmall, endAngleSmall, incrementSmall);
 	std::cout << "Done" << std::endl;
 
+	std::cout << "Test batch Sin/Cos with 8.8 fixed point numbers" << std::endl;
+	SinCosFP(FixedPointSmall::FromString("-100.0"), FixedPointSmall::FromString("100.0"), incrementSmall);
+	std::cout << "Done" << std::endl;
+
 	// 16.16 fixed point numbers
 	FixedPointMedium startAngleMedium = FixedPointMedium::FromString("0.0");
 	FixedPointMedium endAngleMedium = FixedPointMedium::FromString("6.283185307");
@@ -159,6 +327,10 @@ int main()
 	TanFP(startAngleMedium, endAngleMedium, incrementMedium);
 	std::cout << "Done" << std::endl;
 
+	std::cout << "Test batch Sin/Cos with 16.16 fixed point numbers" << std::endl;
+	SinCosFP(FixedPointMedium::FromString("-100.0"), FixedPointMedium::FromString("100.0"), incrementMedium);
+	std::cout << "Done" << std::endl;
+
 	// 32.32 fixed point numbers
 	FixedPointLarge startAngleLarge = FixedPointLarge::FromString("0.0");
 	FixedPointLarge endAngleLarge = FixedPointLarge::FromString("6.283185307");
@@ -176,5 +348,23 @@ int main()
 	TanFP(startAngleLarge, endAngleLarge, incrementLarge);
 	std::cout << "Done" << std::endl;
 
+	std::cout << "Test batch Sin/Cos with 32.32 fixed point numbers" << std::endl;
+	SinCosFP(FixedPointLarge::FromString("-100.0"), FixedPointLarge::FromString("100.0"), incrementLarge);
+	size_t kernelMismatches = SinCosLargeFP(100000);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test the batch Sin/Cos kernels" << std::endl;
+	kernelMismatches += SinCosKernelsFP<FixedPointSmall>("Small", 1.0);
+	kernelMismatches += SinCosKernelsFP<FixedPointMedium>("Medium", 1.0);
+	kernelMismatches += SinCosKernelsFP<FixedPointLarge>("Large", 256.0);
+	std::cout << "Done" << std::endl;
+
+	// The instruction sets must agree exactly
+	if (kernelMismatches != 0)
+	{
+		std::cout << "FAILED: the instruction sets give different batch Sin/Cos results" << std::endl;
+		return 1;
+	}
+
 	return 0;
 }
@@ -0,0 +1,564 @@
+// Vectors.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+
+#include <iostream>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+#include "..\..\src\SFPMLib.h"
+
+using namespace sfpmlib;
+
+// Allocation counting hook: every heap allocation of the program (scalar, array and
+// aligned forms of operator new) goes through Allocate and every deallocation through
+// Release, so malloc and free are always paired. The block returned by malloc is
+// stored just before the aligned block.
+static size_t allocations = 0;
+
+static void*
+Allocate(size_t size, size_t alignment)
+{
+	++allocations;
+	void* block = malloc(size + alignment + sizeof(void*));
+	if (!block)
+	{
+		throw std::bad_alloc();
+	}
+	uintptr_t aligned = (reinterpret_cast<uintptr_t>(block) + sizeof(void*) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+	reinterpret_cast<void**>(aligned)[-1] = block;
+	return reinterpret_cast<void*>(aligned);
+}
+
+static void
+Release(void* aligned) noexcept
+{
+	if (aligned)
+	{
+		free(reinterpret_cast<void**>(aligned)[-1]);
+	}
+}
+
+void*
+operator new(size_t size)
+{
+	return Allocate(size, alignof(std::max_align_t));
+}
+
+void*
+operator new[](size_t size)
+{
+	return Allocate(size, alignof(std::max_align_t));
+}
+
+void
+operator delete(void* block) noexcept
+{
+	Release(block);
+}
+
+void
+operator delete[](void* block) noexcept
+{
+	Release(block);
+}
+
+void
+operator delete(void* block, size_t) noexcept
+{
+	Release(block);
+}
+
+void
+operator delete[](void* block, size_t) noexcept
+{
+	Release(block);
+}
+
+#if defined(__cpp_aligned_new)
+void*
+operator new(size_t size, std::align_val_t alignment)
+{
+	return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void*
+operator new[](size_t size, std::align_val_t alignment)
+{
+	return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void
+operator delete(void* block, std::align_val_t) noexcept
+{
+	Release(block);
+}
+
+void
+operator delete[](void* block, std::align_val_t) noexcept
+{
+	Release(block);
+}
+
+void
+operator delete(void* block, size_t, std::align_val_t) noexcept
+{
+	Release(block);
+}
+
+void
+operator delete[](void* block, size_t, std::align_val_t) noexcept
+{
+	Release(block);
+}
+#endif
+
+static bool
+Same(FixedPointMedium const& a, FixedPointMedium const& b)
+{
+	// operator== is not enough: the sign of the zero results is checked too
+	return (a == b) && (FixedPointMedium::IsNegative(a) == FixedPointMedium::IsNegative(b));
+}
+
+// Random components: zeros, integers, small and full range magnitudes
+static FixedPointMedium
+Component(std::mt19937& generator)
+{
+	uint32_t magnitude = generator();
+	switch(generator() % 4)
+	{
+	case 0:
+		magnitude = 0;
+		break;
+	case 1:
+		magnitude &= 0x000F0000;
+		break;
+	case 2:
+		magnitude &= 0x0003FFFF;
+		break;
+	}
+
+	return FixedPointMedium((generator() % 2) != 0, magnitude);
+}
+
+// Vec3Medium/Vec4Medium (packed kernels) checked against the FixedPoint operators
+template <int N>
+void PackedFP(char const* name, int count)
+{
+	std::string s("PackedFP");
+	s += name;
+	s += ".txt";
+
+	FILE* f = fopen(s.c_str(), "w");
+	if (f)
+	{
+		std::mt19937 generator(N);
+		size_t mismatches = 0;
+		for(int k = 0; k < count; k++)
+		{
+			std::vector<FixedPointMedium> a;
+			std::vector<FixedPointMedium> b;
+			for(int i = 0; i < N; i++)
+			{
+				a.push_back(Component(generator));
+				b.push_back(((generator() % 4) == 0) ? FixedPointMedium(!FixedPointMedium::IsNegative(a[i]), static_cast<uint32_t>(a[i])) : Component(generator));
+			}
+
+			Vec<FixedPointMedium, N> first(a);
+			Vec<FixedPointMedium, N> second(b);
+			Vec<FixedPointMedium, N> sum = first + second;
+			Vec<FixedPointMedium, N> difference = first - second;
+			Vec<FixedPointMedium, N> scaled = first * b[0];
+			FixedPointMedium dot = first * second;
+
+			FixedPointMedium expectedDot(false, 0);
+			FixedPointMedium squares(false, 0);
+			for(int i = 0; i < N; i++)
+			{
+				FixedPointMedium x = a[i];
+				mismatches += !Same(sum[i], x + b[i]);
+				mismatches += !Same(difference[i], x - b[i]);
+				mismatches += !Same(scaled[i], x * b[0]);
+				expectedDot += x * b[i];
+				squares += FixedPointMedium::Pow(x, 2);
+			}
+			mismatches += !Same(dot, expectedDot);
+
+			FixedPointMedium mod = FixedPointMedium::Sqrt(squares);
+			mismatches += !Same(first.Mod(), mod);
+			if (static_cast<uint32_t>(mod) != 0)
+			{
+				Vec<FixedPointMedium, N> normalized = first.Normalize();
+				for(int i = 0; i < N; i++)
+				{
+					FixedPointMedium x = a[i];
+					mismatches += !Same(normalized[i], x / mod);
+				}
+			}
+
+			if (N == 3)
+			{
+				Vec<FixedPointMedium, N> cross = Vec<FixedPointMedium, N>::Cross(first, second);
+				FixedPointMedium x = a[1] * b[2];
+				x -= a[2] * b[1];
+				FixedPointMedium y = a[0] * b[2];
+				y -= a[2] * b[0];
+				y *= FixedPointMedium(true, 1, 0);
+				FixedPointMedium z = a[0] * b[1];
+				z -= a[1] * b[0];
+				mismatches += !Same(cross[0], x) + !Same(cross[1], y) + !Same(cross[2], z);
+			}
+
+			fprintf(f, "%s;%s;%s;%s\n", first.ToString().c_str(), second.ToString().c_str(), sum.ToString().c_str(), dot.ToString().c_str());
+		}
+		std::cout << "Packed/scalar mismatches: " << mismatches << std::endl;
+
+		fclose(f);
+	}
+}
+
+// Vec and Mat operations must not allocate
+template <class T, int N>
+void AllocationsFP(char const* name)
+{
+	T first[] = { T(false, 1, 0), T(false, 2, 0), T(true, 1, 0), T(false, 0, 0x40) };
+	T second[] = { T(true, 0, 0x80), T(false, 1, 0), T(false, 3, 0), T(false, 2, 0) };
+	std::vector<T> values;
+	for(int i = 0; i < (N * N); i++)
+	{
+		values.push_back(((i % (N + 1)) == 0) ? T(false, 2, 0) : T((i % 2) != 0, 0, static_cast<uint8_t>(i * 8)));
+	}
+	Vec<T, N> a(std::vector<T>(first, first + N));
+	Vec<T, N> b(std::vector<T>(second, second + N));
+	Mat<T, N> m(true);
+	Mat<T, N> n(values);
+
+	size_t before = allocations;
+	Vec<T, N> sum = a + b;
+	sum += a;
+	Vec<T, N> difference = a - b;
+	difference -= b;
+	Vec<T, N> scaled = a * T(false, 1, 0x80);
+	scaled *= T(false, 0, 0x80);
+	T dot = a * b;
+	T mod = a.Mod();
+	Vec<T, N> normalized = a.Normalize();
+	T angle = Vec<T, N>::Angle(a, b);
+	Vec<T, N> row = n[N - 1];
+	Mat<T, N> product = n * m;
+	product += n;
+	product -= m;
+	product *= T(false, 0, 0x80);
+	T det = n.Det();
+	Mat<T, N> inverse = Mat<T, N>::Inv(n);
+	Mat<T, N> transposed = Mat<T, N>::Transpose(n);
+	bool equal = (inverse == transposed) || (sum != difference) || (row == normalized);
+	char buffer[Mat<T, N>::MaxFormatLength];
+	product.Format(buffer, buffer + sizeof(buffer));
+	size_t count = allocations - before;
+
+	std::cout << name << " allocation mismatches: " << (count != 0) << " (" << dot.ToString() << ", " << mod.ToString() << ", " << angle.ToString() << ", " << det.ToString() << ", " << equal << ")" << std::endl;
+}
+
+// Fused expressions checked against the FixedPoint operators, component by component
+template <class T, int N>
+void ExpressionFP(char const* name, int count)
+{
+	std::mt19937 generator(N);
+	size_t mismatches = 0;
+	for(int k = 0; k < count; k++)
+	{
+		T values[3][N * N];
+		for(int i = 0; i < (N * N); i++)
+		{
+			for(int j = 0; j < 3; j++)
+			{
+				values[j][i] = T((generator() % 2) != 0, static_cast<typename T::IntegerPart>(generator() % 100), static_cast<typename T::FractionalPart>(generator()));
+			}
+		}
+		T number((generator() % 2) != 0, static_cast<typename T::IntegerPart>(generator() % 4), static_cast<typename T::FractionalPart>(generator()));
+
+		Vec<T, N> a(std::vector<T>(values[0], values[0] + N));
+		Vec<T, N> b(std::vector<T>(values[1], values[1] + N));
+		Vec<T, N> c(std::vector<T>(values[2], values[2] + N));
+		Vec<T, N> v = a + b * number - c;
+		auto kept = a + b * number - c;
+		Vec<T, N> w(a);
+		(w += b) -= c * number;
+		T dot = (a - b) * (c + a);
+
+		Mat<T, N> m(std::vector<T>(values[0], values[0] + (N * N)));
+		Mat<T, N> n(std::vector<T>(values[1], values[1] + (N * N)));
+		Mat<T, N> p = m + n * number - m;
+		auto keptMat = m + n * number - m;
+		auto keptRow = m[0] + a;
+		Mat<T, N> q(m);
+		(q -= n) *= number;
+
+		// Expressions kept with auto hold their inner nodes and views
+		mismatches += (Vec<T, N>(kept) != v) + (Mat<T, N>(keptMat) != p) + (Vec<T, N>(keptRow) != (Vec<T, N>(m[0]) + a));
+
+		T expectedDot(false, 0);
+		for(int i = 0; i < N; i++)
+		{
+			T x = values[0][i];
+			T y = values[1][i];
+			T z = values[2][i];
+			mismatches += (v[i] != ((x + (y * number)) - z));
+			mismatches += (w[i] != ((x + y) - (z * number)));
+			T difference = x - y;
+			expectedDot += difference * (z + x);
+			for(int j = 0; j < N; j++)
+			{
+				x = values[0][(i * N) + j];
+				y = values[1][(i * N) + j];
+				mismatches += (p[i][j] != ((x + (y * number)) - x));
+				mismatches += (q[i][j] != ((x - y) * number));
+			}
+		}
+		mismatches += (dot != expectedDot);
+	}
+	std::cout << name << " expression/scalar mismatches: " << mismatches << std::endl;
+}
+
+// Matrix by vector products and batch point transforms checked against the FixedPoint operators
+template <class T>
+void TransformFP(char const* name, size_t count, bool affine)
+{
+	std::mt19937 generator(static_cast<unsigned>(count));
+	std::vector<T> values;
+	for(int i = 0; i < 16; i++)
+	{
+		bool bottom = affine && (i >= 12);
+		values.push_back(bottom ? T(false, (i == 15) ? 1 : 0, 0) : T((generator() % 2) != 0, static_cast<typename T::IntegerPart>(generator() % 4), static_cast<typename T::FractionalPart>(generator())));
+	}
+	Mat<T, 4> m(values);
+
+	std::vector<Vec<T, 3>> points;
+	for(size_t i = 0; i < count; i++)
+	{
+		T coordinates[3];
+		for(auto& coordinate : coordinates)
+		{
+			coordinate = T((generator() % 2) != 0, static_cast<typename T::IntegerPart>(generator() % 100), static_cast<typename T::FractionalPart>(generator()));
+		}
+		points.push_back(Vec<T, 3>{ coordinates[0], coordinates[1], coordinates[2] });
+	}
+
+	std::vector<Vec<T, 3>> transformed(count);
+	bool thrown = false;
+	try
+	{
+		TransformPoints(m, Span<Vec<T, 3> const>(points), Span<Vec<T, 3>>(transformed));
+	}
+	catch(FPException const&)
+	{
+		thrown = true;
+	}
+
+	size_t mismatches = 0;
+	bool expectedThrown = false;
+	for(size_t i = 0; i < count; i++)
+	{
+		Vec<T, 4> point{ points[i][0], points[i][1], points[i][2], T(false, 1, 0) };
+		Vec<T, 4> h = m * point;
+
+		T expected[4];
+		for(int row = 0; row < 4; row++)
+		{
+			expected[row] = T(false, 0);
+			for(int column = 0; column < 4; column++)
+			{
+				T x = values[(row * 4) + column];
+				expected[row] += x * point[column];
+			}
+			mismatches += (h[row] != expected[row]);
+		}
+
+		if (expected[3] == T(false, 0))
+		{
+			expectedThrown = true;
+			mismatches += (transformed[i] != Vec<T, 3>());
+			continue;
+		}
+		for(int k = 0; k < 3; k++)
+		{
+			mismatches += (transformed[i][k] != (expected[k] / expected[3]));
+		}
+	}
+	mismatches += (thrown != expectedThrown);
+	std::cout << name << " transform/scalar mismatches: " << mismatches << std::endl;
+}
+
+// Quaternions checked against double precision rotations; the batch functions
+// against the functions on a single quaternion
+template <class T>
+void QuatFP(char const* name, size_t count, double tolerance)
+{
+	std::mt19937 generator(static_cast<unsigned>(count));
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	auto random = [&](double q[4])
+	{
+		double mod = 0.0;
+		for(int i = 0; i < 4; i++)
+		{
+			q[i] = unit(generator);
+			mod += q[i] * q[i];
+		}
+		for(int i = 0; i < 4; i++)
+		{
+			q[i] /= std::sqrt(mod);
+		}
+		return Quat<T>(T::FromDouble(q[3]), T::FromDouble(q[0]), T::FromDouble(q[1]), T::FromDouble(q[2]));
+	};
+	auto near = [tolerance](T x, double y, double scale = 1.0)
+	{
+		return std::fabs(x.ToDouble() - y) <= (tolerance * scale);
+	};
+
+	std::vector<Quat<T>> first;
+	std::vector<Quat<T>> second;
+	std::vector<T> weights;
+	std::vector<Vec<T, 3>> vectors;
+	size_t mismatches = 0;
+	for(size_t k = 0; k < count; k++)
+	{
+		double a[4];
+		double b[4];
+		first.push_back(random(a));
+		second.push_back(random(b));
+		double t = (unit(generator) + 1.0) / 2.0;
+		weights.push_back(T::FromDouble(t));
+		double v[3] = { unit(generator) * 10.0, unit(generator) * 10.0, unit(generator) * 10.0 };
+		vectors.push_back(Vec<T, 3>{ T::FromDouble(v[0]), T::FromDouble(v[1]), T::FromDouble(v[2]) });
+
+		// Product (x, y, z, w)
+		double p[4] = { (a[3] * b[0]) + (a[0] * b[3]) + (a[1] * b[2]) - (a[2] * b[1]),
+						(a[3] * b[1]) - (a[0] * b[2]) + (a[1] * b[3]) + (a[2] * b[0]),
+						(a[3] * b[2]) + (a[0] * b[1]) - (a[1] * b[0]) + (a[2] * b[3]),
+						(a[3] * b[3]) - (a[0] * b[0]) - (a[1] * b[1]) - (a[2] * b[2]) };
+		Quat<T> product = first[k] * second[k];
+		mismatches += !near(product.W(), p[3]);
+		for(int i = 0; i < 3; i++)
+		{
+			mismatches += !near(product.V()[i], p[i]);
+		}
+
+		// Rotation: v + 2w (u x v) + 2u x (u x v), errors growing with the vectors (up to 10)
+		double c[3] = { (a[1] * v[2]) - (a[2] * v[1]), (a[2] * v[0]) - (a[0] * v[2]), (a[0] * v[1]) - (a[1] * v[0]) };
+		double cc[3] = { (a[1] * c[2]) - (a[2] * c[1]), (a[2] * c[0]) - (a[0] * c[2]), (a[0] * c[1]) - (a[1] * c[0]) };
+		Vec<T, 3> rotated = first[k].Rotate(vectors[k]);
+		Vec<T, 3> transformed = first[k].ToMat() * vectors[k];
+		for(int i = 0; i < 3; i++)
+		{
+			double expected = v[i] + (2.0 * a[3] * c[i]) + (2.0 * cc[i]);
+			mismatches += !near(rotated[i], expected, 10.0) || !near(transformed[i], expected, 10.0);
+		}
+
+		// Same rotation (q or -q) back from the matrix
+		Quat<T> back = Quat<T>::FromMat(first[k].ToMat());
+		double sign = (back.W().ToDouble() * a[3] < 0.0) ? -1.0 : 1.0;
+		mismatches += !near(back.W(), sign * a[3]);
+		for(int i = 0; i < 3; i++)
+		{
+			mismatches += !near(back.V()[i], sign * a[i]);
+		}
+
+		// Slerp along the shortest path
+		double cosine = (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]) + (a[3] * b[3]);
+		double direction = (cosine < 0.0) ? -1.0 : 1.0;
+		double angle = std::acos(std::min(1.0, std::fabs(cosine)));
+		double wa = (angle > 1e-6) ? (std::sin((1.0 - t) * angle) / std::sin(angle)) : (1.0 - t);
+		double wb = direction * ((angle > 1e-6) ? (std::sin(t * angle) / std::sin(angle)) : t);
+		Quat<T> interpolated = Quat<T>::Slerp(first[k], second[k], weights[k]);
+		mismatches += !near(interpolated.W(), (wa * a[3]) + (wb * b[3]));
+		for(int i = 0; i < 3; i++)
+		{
+			mismatches += !near(interpolated.V()[i], (wa * a[i]) + (wb * b[i]));
+		}
+	}
+
+	std::vector<Quat<T>> products(count);
+	std::vector<Quat<T>> normalized(count);
+	std::vector<Quat<T>> interpolated(count);
+	std::vector<Vec<T, 3>> rotated(count);
+	std::vector<Vec<T, 3>> rotatedByFirst(count);
+	Quat<T>::Multiply(Span<Quat<T> const>(first), Span<Quat<T> const>(second), Span<Quat<T>>(products));
+	Quat<T>::Normalize(Span<Quat<T> const>(products), Span<Quat<T>>(normalized));
+	Quat<T>::Slerp(Span<Quat<T> const>(first), Span<Quat<T> const>(second), Span<T const>(weights), Span<Quat<T>>(interpolated));
+	Quat<T>::Rotate(Span<Quat<T> const>(first), Span<Vec<T, 3> const>(vectors), Span<Vec<T, 3>>(rotated));
+	Quat<T>::Rotate(first[0], Span<Vec<T, 3> const>(vectors), Span<Vec<T, 3>>(rotatedByFirst));
+	for(size_t k = 0; k < count; k++)
+	{
+		mismatches += (products[k] != (first[k] * second[k]));
+		mismatches += (normalized[k] != products[k].Normalize());
+		mismatches += (interpolated[k] != Quat<T>::Slerp(first[k], second[k], weights[k]));
+		mismatches += (rotated[k] != first[k].Rotate(vectors[k]));
+		mismatches += (rotatedByFirst[k] != first[0].Rotate(vectors[k]));
+	}
+	std::cout << name << " quaternion mismatches: " << mismatches << std::endl;
+}
+
+// The hook sees the array and aligned forms of operator new too. The over-aligned
+// blocks are only built with aligned new (C++17): before it, std::allocator does not
+// align them beyond max_align_t
+#if defined(__cpp_aligned_new)
+struct alignas(64) AlignedBlock
+{
+	char data[64];
+};
+#endif
+
+void HookFP()
+{
+	size_t mismatches = 0;
+	size_t before = allocations;
+	delete[] new char[16];
+	delete new int(0);
+	mismatches += (allocations - before) != 2;
+#if defined(__cpp_aligned_new)
+	before = allocations;
+	std::vector<AlignedBlock> blocks(4);
+	mismatches += (allocations - before) != 1;
+	mismatches += (reinterpret_cast<uintptr_t>(blocks.data()) % alignof(AlignedBlock)) != 0;
+#endif
+	std::cout << "Hook mismatches: " << mismatches << std::endl;
+}
+
+int main()
+{
+	std::cout << "Test allocation free Vec/Mat operations" << std::endl;
+	HookFP();
+	AllocationsFP<FixedPointSmall, 3>("Small 3");
+	AllocationsFP<FixedPointMedium, 3>("Medium 3");
+	AllocationsFP<FixedPointMedium, 4>("Medium 4");
+	AllocationsFP<FixedPointLarge, 4>("Large 4");
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Vec/Mat expressions" << std::endl;
+	ExpressionFP<FixedPointSmall, 2>("Small 2", 10000);
+	ExpressionFP<FixedPointMedium, 3>("Medium 3", 10000);
+	ExpressionFP<FixedPointMedium, 4>("Medium 4", 10000);
+	ExpressionFP<FixedPointLarge, 4>("Large 4", 10000);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Mat * Vec and TransformPoints" << std::endl;
+	TransformFP<FixedPointSmall>("Small", 1000, false);
+	TransformFP<FixedPointMedium>("Medium", 100003, false);
+	TransformFP<FixedPointMedium>("Medium affine", 100003, true);
+	TransformFP<FixedPointLarge>("Large", 10000, false);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Vec3Medium packed operations" << std::endl;
+	PackedFP<3>("Vec3Medium", 100000);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Vec4Medium packed operations" << std::endl;
+	PackedFP<4>("Vec4Medium", 100000);
+	std::cout << "Done" << std::endl;
+
+	std::cout << "Test Quat operations" << std::endl;
+	QuatFP<FixedPointMedium>("Medium", 10000, 0.001);
+	QuatFP<FixedPointLarge>("Large", 10000, 0.0001);
+	std::cout << "Done" << std::endl;
+}